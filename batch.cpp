@@ -0,0 +1,156 @@
+#include "batch.hpp"
+#include "pool.hpp"
+#include "lexer.hpp"
+#include <chrono>
+#include <fstream>
+
+namespace batch
+{
+
+// everything in the settings that changes the output
+static std::string GetCacheOptions( const Settings &settings )
+{
+	std::string options = "frontend=" + std::to_string( static_cast<int32_t>( settings.frontend ) );
+	for( optimizer::Pass pass : settings.passes.pipeline )
+		options += std::string( " " ) + optimizer::GetName( pass );
+
+	options += settings.passes.noreorder ? " noreorder" : "";
+	options += settings.elf ? " elf" : "";
+	return options;
+}
+
+bool CompileSource( compiler::Compiler &compiler, const char *data, size_t size, const Settings &settings, std::string &output )
+{
+	std::string key;
+	if( settings.cache != nullptr )
+	{
+		key = settings.cache->GetKey( data, size, GetCacheOptions( settings ) );
+		if( settings.cache->Load( key, output ) )
+			return true;
+	}
+
+	if( !compiler.Parse( data, size, settings.frontend ) )
+		return false;
+
+	const compiler::Passes &passes = settings.passes;
+	compiler.RunTreePasses( passes );
+	if( settings.elf )
+	{
+		compiler.Generate( );
+		if( !compiler.RunPasses( passes ) )
+			return false;
+
+		std::vector<uint8_t> object;
+		if( !compiler.GetObject( passes.noreorder, object ) )
+			return false;
+
+		output.assign( object.begin( ), object.end( ) );
+	}
+	else if( !optimizer::HasInstructionPasses( passes.pipeline ) && !passes.noreorder )
+		output = compiler.GenerateAssembly( );
+	else
+	{
+		compiler.Generate( );
+		if( !compiler.RunPasses( passes ) )
+			return false;
+
+		output = compiler.GetAssembly( );
+	}
+
+	if( settings.cache != nullptr )
+		settings.cache->Store( key, output );
+
+	return true;
+}
+
+static bool CompileFile( const std::string &path, const Settings &settings, size_t &bytes, std::string &error )
+{
+	lexer::Source source;
+	if( !source.Open( path ) )
+	{
+		error = "can't read the file";
+		return false;
+	}
+
+	bytes = source.GetSize( );
+
+	compiler::Compiler compiler;
+	std::string output;
+	if( !CompileSource( compiler, source.GetData( ), source.GetSize( ), settings, output ) )
+	{
+		error = compiler.GetError( );
+		return false;
+	}
+
+	std::string outputPath = path + ( settings.elf ? ".o" : ".asm" );
+	std::ofstream file( outputPath, std::ios::binary );
+	file.write( output.data( ), static_cast<std::streamsize>( output.size( ) ) );
+	if( !file )
+	{
+		error = "can't write " + outputPath;
+		return false;
+	}
+
+	return true;
+}
+
+bool ReadManifest( const std::string &path, std::vector<std::string> &paths )
+{
+	std::ifstream file( path );
+	if( !file )
+		return false;
+
+	std::string line;
+	while( std::getline( file, line ) )
+	{
+		while( !line.empty( ) && ( line.back( ) == '\r' || line.back( ) == ' ' || line.back( ) == '\t' ) )
+			line.pop_back( );
+
+		if( !line.empty( ) )
+			paths.push_back( line );
+	}
+
+	return true;
+}
+
+Statistics CompileFiles( const std::vector<std::string> &paths, const Settings &settings )
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+	// every task only touches its own slots
+	std::vector<std::string> errors( paths.size( ) );
+	std::vector<size_t> sizes( paths.size( ), 0 );
+	std::vector<uint8_t> failed( paths.size( ), 0 );
+
+	Statistics stats;
+	{
+		pool::ThreadPool threads( settings.jobs );
+		for( size_t i = 0; i < paths.size( ); ++i )
+		{
+			threads.Submit( [&, i]( )
+			{
+				failed[i] = !CompileFile( paths[i], settings, sizes[i], errors[i] );
+			} );
+		}
+
+		threads.Wait( );
+		stats.threads = threads.GetSize( );
+		stats.steals = threads.GetSteals( );
+	}
+
+	stats.files = paths.size( );
+	for( size_t i = 0; i < paths.size( ); ++i )
+	{
+		stats.bytes += sizes[i];
+		if( failed[i] )
+		{
+			stats.failed++;
+			stats.errors.push_back( paths[i] + ": " + errors[i] );
+		}
+	}
+
+	stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+	return stats;
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "compiler.hpp"
+#include "cache.hpp"
+
+namespace batch
+{
+
+struct Settings
+{
+	compiler::Frontend frontend = compiler::Frontend::Flex;
+	compiler::Passes passes;
+	// write relocatable objects instead of assembly
+	bool elf = false;
+	// 0 for one per hardware thread
+	uint32_t jobs = 0;
+	// outputs are looked up here before parsing and stored after compiling when set
+	cache::Cache *cache = nullptr;
+};
+
+struct Statistics
+{
+	size_t files = 0;
+	size_t failed = 0;
+	size_t bytes = 0;
+	double seconds = 0.0;
+	uint32_t threads = 0;
+	uint64_t steals = 0;
+	// "path: message" for every failed file, in input order
+	std::vector<std::string> errors;
+};
+
+// parses, generates and runs the passes on one source, output is the
+// assembly or the ELF object, false with the error left in the compiler
+// (failed compilations aren't cached, so their errors are reported again)
+bool CompileSource( compiler::Compiler &compiler, const char *data, size_t size, const Settings &settings, std::string &output );
+
+// one path per line, blank lines are skipped
+bool ReadManifest( const std::string &path, std::vector<std::string> &paths );
+
+// compiles every file on its own into path + ".asm" (or ".o") on a work
+// stealing pool, the outputs only depend on their input and the settings
+Statistics CompileFiles( const std::vector<std::string> &paths, const Settings &settings );
+
+}
@@ -0,0 +1,399 @@
+#include "bytecode.hpp"
+#include <limits>
+
+namespace bytecode
+{
+
+static const std::map<node::BinaryOperator::Code, Opcode> operator_to_opcode = {
+	{ node::BinaryOperator::Addition, Opcode::Add },
+	{ node::BinaryOperator::Subtraction, Opcode::Subtract },
+	{ node::BinaryOperator::Multiplication, Opcode::Multiply },
+	{ node::BinaryOperator::Division, Opcode::Divide },
+	{ node::BinaryOperator::Modulo, Opcode::Modulo },
+
+	{ node::BinaryOperator::Equal, Opcode::Equal },
+	{ node::BinaryOperator::NotEqual, Opcode::NotEqual },
+	{ node::BinaryOperator::LessThan, Opcode::LessThan },
+	{ node::BinaryOperator::LessEqual, Opcode::LessEqual },
+	{ node::BinaryOperator::GreaterThan, Opcode::GreaterThan },
+	{ node::BinaryOperator::GreaterEqual, Opcode::GreaterEqual },
+
+	{ node::BinaryOperator::And, Opcode::And },
+	{ node::BinaryOperator::Or, Opcode::Or }
+};
+
+class Compiler
+{
+public:
+	Compiler( const symbol::Table &symTable, Program &program ) :
+		symTable( symTable ),
+		program( program )
+	{
+		program.variables = static_cast<uint32_t>( symTable.GetNames( ).size( ) );
+		program.frame = program.variables;
+	}
+
+	// on a stack instead of recursing, so any nesting fits: a statement
+	// pushes what comes after it in reverse, the first part on top
+	void Statement( const node::Base *root )
+	{
+		stack.push_back( { Item::Statement, root, 0, 0 } );
+		while( !stack.empty( ) )
+		{
+			Item item = stack.back( );
+			stack.pop_back( );
+			switch( item.kind )
+			{
+				case Item::Statement:
+					Visit( item.node );
+					break;
+
+				// the test failed, the success block jumps over the failure one
+				case Item::Else:
+				{
+					size_t jump = Emit( Opcode::Jump );
+					program.code[item.position].b = Here( );
+					stack.push_back( { Item::Patch, nullptr, jump, 0 } );
+					stack.push_back( { Item::Statement, static_cast<const node::IfThenElse *>( item.node )->failureBlock, 0, 0 } );
+					break;
+				}
+
+				case Item::Patch:
+					program.code[item.position].a = Here( );
+					break;
+
+				case Item::PatchBranch:
+					program.code[item.position].b = Here( );
+					break;
+
+				case Item::Test:
+					program.code[item.position].a = Here( );
+					Emit( Opcode::JumpIfTrue, Condition( static_cast<const node::WhileLoop *>( item.node )->testExpr ), item.body );
+					break;
+			}
+		}
+	}
+
+private:
+	struct Operator
+	{
+		const node::BinaryOperator *binop;
+		int32_t target;
+		int32_t temporary;
+		// the slot of the left operand once right is set
+		int32_t left;
+		bool right;
+	};
+
+	struct Item
+	{
+		enum Kind
+		{
+			Statement,
+			Else,
+			Patch,
+			PatchBranch,
+			Test
+		};
+
+		Kind kind;
+		const node::Base *node;
+		// the jump to patch, and where a loop's body starts
+		size_t position;
+		int32_t body;
+	};
+
+	// what a statement does before its children, which it pushes with the rest
+	void Visit( const node::Base *stmt )
+	{
+		if( const node::Block *block = dynamic_cast<const node::Block *>( stmt ) )
+		{
+			for( auto child = block->statements.rbegin( ); child != block->statements.rend( ); ++child )
+				stack.push_back( { Item::Statement, *child, 0, 0 } );
+		}
+		else if( const node::Assignment *assignment = dynamic_cast<const node::Assignment *>( stmt ) )
+			Store( assignment->lhs, assignment->rhs );
+		else if( const node::IntegerDeclaration *declaration = dynamic_cast<const node::IntegerDeclaration *>( stmt ) )
+		{
+			if( declaration->assignmentExpr != nullptr )
+				Store( declaration->id, declaration->assignmentExpr );
+		}
+		else if( const node::BooleanDeclaration *declaration = dynamic_cast<const node::BooleanDeclaration *>( stmt ) )
+		{
+			if( declaration->assignmentExpr != nullptr )
+				Store( declaration->id, declaration->assignmentExpr );
+		}
+		else if( const node::ExpressionStatement *expression = dynamic_cast<const node::ExpressionStatement *>( stmt ) )
+			Expression( expression->expression, program.variables, program.variables );
+		else if( const node::IfThenElse *ifthenelse = dynamic_cast<const node::IfThenElse *>( stmt ) )
+		{
+			size_t branch = Emit( Opcode::JumpIfFalse, Condition( ifthenelse->testExpr ) );
+			if( ifthenelse->failureBlock != nullptr )
+				stack.push_back( { Item::Else, ifthenelse, branch, 0 } );
+			else
+				stack.push_back( { Item::PatchBranch, nullptr, branch, 0 } );
+
+			stack.push_back( { Item::Statement, ifthenelse->successBlock, 0, 0 } );
+		}
+		else if( const node::WhileLoop *whileloop = dynamic_cast<const node::WhileLoop *>( stmt ) )
+		{
+			// the test goes at the bottom so every iteration only takes one branch
+			size_t jump = Emit( Opcode::Jump );
+			stack.push_back( { Item::Test, whileloop, jump, Here( ) } );
+			stack.push_back( { Item::Statement, whileloop->successBlock, 0, 0 } );
+		}
+	}
+
+	int32_t Slot( const node::Identifier *id ) const
+	{
+		return symTable.GetIndex( id->name );
+	}
+
+	size_t Emit( Opcode opcode, int32_t a = 0, int32_t b = 0, int32_t c = 0 )
+	{
+		program.code.push_back( { opcode, a, b, c } );
+		return program.code.size( ) - 1;
+	}
+
+	int32_t Here( ) const
+	{
+		return static_cast<int32_t>( program.code.size( ) );
+	}
+
+	void Reserve( int32_t slot )
+	{
+		if( static_cast<uint32_t>( slot ) >= program.frame )
+			program.frame = static_cast<uint32_t>( slot ) + 1;
+	}
+
+	// a leaf: variables are used in place, literals go to target
+	int32_t Leaf( const node::Expression *expr, int32_t target )
+	{
+		if( const node::Identifier *id = dynamic_cast<const node::Identifier *>( expr ) )
+			return Slot( id );
+
+		Reserve( target );
+		if( const node::Integer *integer = dynamic_cast<const node::Integer *>( expr ) )
+			Emit( Opcode::Constant, target, integer->value );
+		else
+			Emit( Opcode::Constant, target, static_cast<const node::Boolean *>( expr )->value ? 1 : 0 );
+
+		return target;
+	}
+
+	// returns the slot holding the value of the expression, variables are used
+	// in place, computed values go to target and subexpressions use the
+	// temporaries from temporary onwards; the operators waiting for their
+	// right operand are kept on a stack
+	int32_t Expression( const node::Expression *expr, int32_t target, int32_t temporary )
+	{
+		for( ;; )
+		{
+			while( const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( expr ) )
+			{
+				Reserve( target );
+				operators.push_back( { binop, target, temporary, 0, false } );
+				expr = binop->lhs;
+				target = temporary;
+				temporary++;
+			}
+
+			int32_t value = Leaf( expr, target );
+			while( !operators.empty( ) && operators.back( ).right )
+			{
+				const Operator &done = operators.back( );
+				Emit( operator_to_opcode.at( done.binop->op ), done.target, done.left, value );
+				value = done.target;
+				operators.pop_back( );
+			}
+
+			if( operators.empty( ) )
+				return value;
+
+			Operator &pending = operators.back( );
+			pending.left = value;
+			pending.right = true;
+			expr = pending.binop->rhs;
+			target = pending.temporary + 1;
+			temporary = pending.temporary + 2;
+		}
+	}
+
+	// the value is computed straight into the variable's slot when possible
+	void Store( const node::Identifier *id, const node::Expression *expr )
+	{
+		int32_t slot = Slot( id );
+		int32_t value = Expression( expr, slot, program.variables );
+		if( value != slot )
+			Emit( Opcode::Move, slot, value );
+	}
+
+	int32_t Condition( const node::Expression *expr )
+	{
+		return Expression( expr, program.variables, program.variables );
+	}
+
+	const symbol::Table &symTable;
+	Program &program;
+	std::vector<Item> stack;
+	std::vector<Operator> operators;
+};
+
+Program Compile( const node::Block *block, const symbol::Table &symTable )
+{
+	Program program;
+	Compiler compiler( symTable, program );
+	compiler.Statement( block );
+	program.code.push_back( { Opcode::Halt, 0, 0, 0 } );
+	return program;
+}
+
+// same semantics as the MIPS backend: wrapping arithmetic and no traps
+static inline int32_t Divide( int32_t left, int32_t right )
+{
+	if( right == 0 )
+		return 0;
+
+	if( left == std::numeric_limits<int32_t>::min( ) && right == -1 )
+		return left;
+
+	return left / right;
+}
+
+static inline int32_t Modulo( int32_t left, int32_t right )
+{
+	if( right == 0 || right == -1 )
+		return 0;
+
+	return left % right;
+}
+
+static inline int32_t Wrap( uint32_t value )
+{
+	return static_cast<int32_t>( value );
+}
+
+#if defined __GNUC__
+
+// direct threading: every instruction holds the address of its handler
+struct Threaded
+{
+	const void *handler;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+#define OPCODE( name ) name:
+#define NEXT( ) ++ip; goto *ip->handler
+#define JUMP( target ) ip = code.data( ) + ( target ); goto *ip->handler
+
+#else
+
+typedef Instruction Threaded;
+
+#define OPCODE( name ) case Opcode::name:
+#define NEXT( ) ++ip; continue
+#define JUMP( target ) ip = code.data( ) + ( target ); continue
+
+#endif
+
+#define BINARY( name, expression ) \
+	OPCODE( name ) \
+	{ \
+		int32_t left = slots[ip->b]; \
+		int32_t right = slots[ip->c]; \
+		slots[ip->a] = ( expression ); \
+		NEXT( ); \
+	}
+
+bool Run( const Program &program, std::vector<int32_t> &frame, uint64_t maxJumps )
+{
+	frame.assign( program.frame, 0 );
+	int32_t *slots = frame.data( );
+	uint64_t jumps = 0;
+
+#if defined __GNUC__
+	// in the same order as Opcode
+	static const void *handlers[] = {
+		&&Constant, &&Move,
+		&&Add, &&Subtract, &&Multiply, &&Divide, &&Modulo,
+		&&Equal, &&NotEqual, &&LessThan, &&LessEqual, &&GreaterThan, &&GreaterEqual,
+		&&And, &&Or,
+		&&Jump, &&JumpIfFalse, &&JumpIfTrue, &&Halt
+	};
+
+	std::vector<Threaded> code( program.code.size( ) );
+	for( size_t i = 0; i < code.size( ); ++i )
+	{
+		const Instruction &inst = program.code[i];
+		code[i] = { handlers[static_cast<size_t>( inst.opcode )], inst.a, inst.b, inst.c };
+	}
+
+	const Threaded *ip = code.data( );
+	goto *ip->handler;
+#else
+	const std::vector<Threaded> &code = program.code;
+	const Threaded *ip = code.data( );
+	for( ;; )
+	switch( ip->opcode )
+	{
+#endif
+
+	OPCODE( Constant )
+		slots[ip->a] = ip->b;
+		NEXT( );
+
+	OPCODE( Move )
+		slots[ip->a] = slots[ip->b];
+		NEXT( );
+
+	BINARY( Add, Wrap( static_cast<uint32_t>( left ) + static_cast<uint32_t>( right ) ) )
+	BINARY( Subtract, Wrap( static_cast<uint32_t>( left ) - static_cast<uint32_t>( right ) ) )
+	BINARY( Multiply, Wrap( static_cast<uint32_t>( left ) * static_cast<uint32_t>( right ) ) )
+	BINARY( Divide, bytecode::Divide( left, right ) )
+	BINARY( Modulo, bytecode::Modulo( left, right ) )
+	BINARY( Equal, left == right )
+	BINARY( NotEqual, left != right )
+	BINARY( LessThan, left < right )
+	BINARY( LessEqual, left <= right )
+	BINARY( GreaterThan, left > right )
+	BINARY( GreaterEqual, left >= right )
+	BINARY( And, left & right )
+	BINARY( Or, left | right )
+
+	OPCODE( Jump )
+		JUMP( ip->a );
+
+	OPCODE( JumpIfFalse )
+		if( slots[ip->a] == 0 )
+		{
+			JUMP( ip->b );
+		}
+		NEXT( );
+
+	// loops always close with this one, so it's the only place the budget is checked
+	OPCODE( JumpIfTrue )
+		if( slots[ip->a] != 0 )
+		{
+			if( ++jumps > maxJumps )
+				return false;
+
+			JUMP( ip->b );
+		}
+		NEXT( );
+
+	OPCODE( Halt )
+		return true;
+
+#if !defined __GNUC__
+	}
+#endif
+}
+
+#undef BINARY
+#undef JUMP
+#undef NEXT
+#undef OPCODE
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "node.hpp"
+#include "symbol.hpp"
+
+namespace bytecode
+{
+
+// operands are slots of a flat frame: variables first (indexed by symbol id),
+// expression temporaries after them
+enum class Opcode : uint8_t
+{
+	Constant, // a = b
+	Move, // a = [b]
+
+	Add, // a = [b] op [c]
+	Subtract,
+	Multiply,
+	Divide,
+	Modulo,
+	Equal,
+	NotEqual,
+	LessThan,
+	LessEqual,
+	GreaterThan,
+	GreaterEqual,
+	And,
+	Or,
+
+	Jump, // goto a
+	JumpIfFalse, // if [a] == 0 goto b
+	JumpIfTrue, // if [a] != 0 goto b
+	Halt
+};
+
+struct Instruction
+{
+	Opcode opcode;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+struct Program
+{
+	std::vector<Instruction> code;
+	uint32_t variables = 0;
+	uint32_t frame = 0;
+};
+
+Program Compile( const node::Block *block, const symbol::Table &symTable );
+
+// runs the program with a direct-threaded interpreter, frame ends up with the
+// final value of every slot, returns false if the jump budget ran out
+bool Run( const Program &program, std::vector<int32_t> &frame, uint64_t maxJumps = 1000000000 );
+
+}
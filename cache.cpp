@@ -0,0 +1,246 @@
+#include "cache.hpp"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cache
+{
+
+static const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t Rotate( uint64_t value, uint32_t bits )
+{
+	return ( value << bits ) | ( value >> ( 64 - bits ) );
+}
+
+// little endian on the hosts we run on, memcpy for unaligned input
+static uint64_t Read64( const uint8_t *bytes )
+{
+	uint64_t value;
+	std::memcpy( &value, bytes, sizeof( value ) );
+	return value;
+}
+
+static uint32_t Read32( const uint8_t *bytes )
+{
+	uint32_t value;
+	std::memcpy( &value, bytes, sizeof( value ) );
+	return value;
+}
+
+static uint64_t Round( uint64_t accumulator, uint64_t input )
+{
+	accumulator += input * prime2;
+	return Rotate( accumulator, 31 ) * prime1;
+}
+
+static uint64_t Merge( uint64_t hash, uint64_t accumulator )
+{
+	hash ^= Round( 0, accumulator );
+	return hash * prime1 + prime4;
+}
+
+uint64_t Hash( const void *data, size_t size, uint64_t seed )
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>( data );
+	const uint8_t *end = bytes + size;
+	uint64_t hash;
+
+	if( size >= 32 )
+	{
+		uint64_t v1 = seed + prime1 + prime2;
+		uint64_t v2 = seed + prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - prime1;
+		for( ; bytes + 32 <= end; bytes += 32 )
+		{
+			v1 = Round( v1, Read64( bytes ) );
+			v2 = Round( v2, Read64( bytes + 8 ) );
+			v3 = Round( v3, Read64( bytes + 16 ) );
+			v4 = Round( v4, Read64( bytes + 24 ) );
+		}
+
+		hash = Rotate( v1, 1 ) + Rotate( v2, 7 ) + Rotate( v3, 12 ) + Rotate( v4, 18 );
+		hash = Merge( hash, v1 );
+		hash = Merge( hash, v2 );
+		hash = Merge( hash, v3 );
+		hash = Merge( hash, v4 );
+	}
+	else
+		hash = seed + prime5;
+
+	hash += size;
+
+	for( ; bytes + 8 <= end; bytes += 8 )
+		hash = Rotate( hash ^ Round( 0, Read64( bytes ) ), 27 ) * prime1 + prime4;
+
+	if( bytes + 4 <= end )
+	{
+		hash = Rotate( hash ^ ( Read32( bytes ) * prime1 ), 23 ) * prime2 + prime3;
+		bytes += 4;
+	}
+
+	for( ; bytes < end; ++bytes )
+		hash = Rotate( hash ^ ( *bytes * prime5 ), 11 ) * prime1;
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// the running binary stands for the compiler version, any rebuild starts a new cache
+static uint64_t GetVersion( )
+{
+	std::ifstream file( "/proc/self/exe", std::ios::binary );
+	std::stringstream binary;
+	binary << file.rdbuf( );
+	std::string bytes = binary.str( );
+	return Hash( bytes.data( ), bytes.size( ) );
+}
+
+Cache::Cache( const std::string &directory, uint64_t limit ) :
+	directory( directory ),
+	limit( limit ),
+	version( GetVersion( ) ),
+	total( 0 ),
+	scanned( false ),
+	hits( 0 ),
+	misses( 0 ),
+	stores( 0 ),
+	evictions( 0 ),
+	temporaries( 0 )
+{
+	mkdir( directory.c_str( ), 0755 );
+}
+
+std::string Cache::GetKey( const char *data, size_t size, const std::string &options ) const
+{
+	uint64_t seed = Hash( options.data( ), options.size( ), version );
+	char key[64];
+	std::snprintf( key, sizeof( key ), "%016llx-%llx",
+		static_cast<unsigned long long>( Hash( data, size, seed ) ), static_cast<unsigned long long>( size ) );
+	return key;
+}
+
+bool Cache::Load( const std::string &key, std::string &output )
+{
+	std::string path = directory + "/" + key;
+	std::ifstream file( path, std::ios::binary );
+	std::stringstream contents;
+	if( !file || !( contents << file.rdbuf( ) ) )
+	{
+		misses++;
+		return false;
+	}
+
+	output = contents.str( );
+	utimensat( AT_FDCWD, path.c_str( ), nullptr, 0 );
+	hits++;
+	return true;
+}
+
+void Cache::Store( const std::string &key, const std::string &output )
+{
+	std::string path = directory + "/" + key;
+	std::string temporary = path + ".tmp" + std::to_string( getpid( ) ) + "." + std::to_string( temporaries++ );
+	{
+		std::ofstream file( temporary, std::ios::binary );
+		file.write( output.data( ), static_cast<std::streamsize>( output.size( ) ) );
+		if( !file.flush( ) )
+		{
+			std::remove( temporary.c_str( ) );
+			return;
+		}
+	}
+
+	if( std::rename( temporary.c_str( ), path.c_str( ) ) != 0 )
+	{
+		std::remove( temporary.c_str( ) );
+		return;
+	}
+
+	stores++;
+
+	std::lock_guard<std::mutex> lock( mutex );
+	total += output.size( );
+	if( !scanned || total > limit )
+		Evict( );
+}
+
+Statistics Cache::GetStatistics( ) const
+{
+	Statistics stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.stores = stores;
+	stats.evictions = evictions;
+	return stats;
+}
+
+// rescans the directory, other processes may have added entries since
+void Cache::Evict( )
+{
+	struct Entry
+	{
+		std::string path;
+		timespec time;
+		uint64_t size;
+	};
+
+	std::vector<Entry> entries;
+	total = 0;
+	scanned = true;
+
+	DIR *dir = opendir( directory.c_str( ) );
+	if( dir == nullptr )
+		return;
+
+	while( dirent *entry = readdir( dir ) )
+	{
+		std::string path = directory + "/" + entry->d_name;
+		struct stat status;
+		if( stat( path.c_str( ), &status ) != 0 || !S_ISREG( status.st_mode ) )
+			continue;
+
+		entries.push_back( { path, status.st_mtim, static_cast<uint64_t>( status.st_size ) } );
+		total += status.st_size;
+	}
+
+	closedir( dir );
+
+	if( total <= limit )
+		return;
+
+	std::sort( entries.begin( ), entries.end( ), []( const Entry &a, const Entry &b )
+	{
+		return a.time.tv_sec != b.time.tv_sec ? a.time.tv_sec < b.time.tv_sec : a.time.tv_nsec < b.time.tv_nsec;
+	} );
+
+	for( const Entry &entry : entries )
+	{
+		if( total <= limit )
+			break;
+
+		if( std::remove( entry.path.c_str( ) ) == 0 )
+		{
+			total -= entry.size;
+			evictions++;
+		}
+	}
+}
+
+}
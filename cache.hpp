@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace cache
+{
+
+// xxHash64
+uint64_t Hash( const void *data, size_t size, uint64_t seed = 0 );
+
+struct Statistics
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t stores = 0;
+	uint64_t evictions = 0;
+};
+
+// compiler outputs in a local directory, one file per entry named after the
+// hash of the source, its size, the options and the compiler binary, so a
+// changed input, flag or compiler never hits an old entry. Entries are
+// written to a temporary file and renamed into place, so concurrent
+// compilers (and processes) never see half an entry, and hits refresh the
+// modification time, which orders the least recently used entries evicted
+// when the directory grows past its limit. Safe to share between threads
+class Cache
+{
+public:
+	// limit in bytes, the directory is created when it doesn't exist
+	Cache( const std::string &directory, uint64_t limit );
+
+	Cache( const Cache & ) = delete;
+	Cache &operator=( const Cache & ) = delete;
+
+	// options has to describe everything that changes the output
+	std::string GetKey( const char *data, size_t size, const std::string &options ) const;
+	bool Load( const std::string &key, std::string &output );
+	// failures are ignored, the output just isn't cached
+	void Store( const std::string &key, const std::string &output );
+
+	Statistics GetStatistics( ) const;
+
+private:
+	void Evict( );
+
+	std::string directory;
+	uint64_t limit;
+	uint64_t version;
+
+	// size of the directory as last scanned plus what was stored since
+	std::mutex mutex;
+	uint64_t total;
+	bool scanned;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> stores;
+	std::atomic<uint64_t> evictions;
+	std::atomic<uint64_t> temporaries;
+};
+
+}
@@ -0,0 +1,313 @@
+#include "compiler.hpp"
+#include <algorithm>
+#include "pratt.hpp"
+#include "parser.hpp"
+#include "object.hpp"
+
+extern void *CreateFlexScanner( compiler::Compiler *compiler, const char *data, size_t size );
+extern void DestroyFlexScanner( void *scanner );
+
+namespace compiler
+{
+
+void Passes::Add( optimizer::Pass pass )
+{
+	if( std::find( pipeline.begin( ), pipeline.end( ), pass ) == pipeline.end( ) )
+		pipeline.push_back( pass );
+}
+
+Compiler::Compiler( ) :
+	program( nullptr ),
+	flexScanner( nullptr ),
+	stream( nullptr ),
+	memoize( false )
+{ }
+
+Compiler::~Compiler( )
+{
+	Reset( );
+}
+
+void Compiler::Reset( )
+{
+	if( flexScanner != nullptr )
+		DestroyFlexScanner( flexScanner );
+
+	flexScanner = nullptr;
+	scanner.reset( );
+
+	delete program;
+	program = nullptr;
+	tree.Clear( );
+
+	for( instruction::Base *inst : list )
+		delete inst;
+
+	list = instruction::List( );
+	symTable.Clear( );
+	error.clear( );
+	stream = nullptr;
+}
+
+void Compiler::SetMemoize( bool memoize )
+{
+	this->memoize = memoize;
+	if( !memoize )
+		memo.Clear( );
+}
+
+void Compiler::SetStream( std::ostream *text )
+{
+	stream = text;
+	if( stream != nullptr )
+		*stream << instruction::Section( ".text" ).ToString( );
+}
+
+bool Compiler::Parse( const char *data, size_t size, Frontend frontend )
+{
+	switch( frontend )
+	{
+		case Frontend::Pratt:
+		{
+			std::string message;
+			if( !pratt::Parse( data, size, &program, symTable, message ) )
+				Error( message );
+
+			break;
+		}
+
+		case Frontend::Flat:
+		{
+			std::string message;
+			if( !pratt::Parse( data, size, tree, symTable, message ) )
+				Error( message );
+
+			break;
+		}
+
+		case Frontend::Simd:
+			scanner.reset( new lexer::Scanner( data, size ) );
+			if( yyparse( *this ) != 0 )
+				Error( "parse failed" );
+
+			break;
+
+		case Frontend::Flex:
+			flexScanner = CreateFlexScanner( this, data, size );
+			if( flexScanner == nullptr )
+				Error( "can't create the scanner" );
+			else if( yyparse( *this ) != 0 )
+				Error( "parse failed" );
+
+			break;
+	}
+
+	return error.empty( ) && ( program != nullptr || !tree.Empty( ) );
+}
+
+void Compiler::Generate( uint32_t threads )
+{
+	if( threads == 1 )
+	{
+		if( program != nullptr )
+			program->GenerateInstructions( list, symTable );
+		else
+			flat::Generate( tree, list, symTable );
+
+		return;
+	}
+
+	pool::ThreadPool pool( threads );
+	if( program != nullptr )
+		program->GenerateInstructions( list, symTable, pool );
+	else
+		flat::Generate( tree, list, symTable, pool );
+}
+
+std::string Compiler::GenerateAssembly( )
+{
+	// the memo table keys node:: statements
+	if( !memoize || program == nullptr )
+	{
+		Generate( );
+		return GetAssembly( );
+	}
+
+	std::string assembly;
+	memo.Generate( program, symTable, assembly );
+	return assembly;
+}
+
+void Compiler::RunTreePasses( const Passes &passes, std::ostream *log )
+{
+	for( optimizer::Pass pass : passes.pipeline )
+	{
+		if( optimizer::IsTreePass( pass ) && program != nullptr )
+			Log( optimizer::Run( pass, program, list ), passes, log );
+	}
+}
+
+bool Compiler::RunPasses( const Passes &passes, std::ostream *log )
+{
+	std::vector<optimizer::Pass> pipeline;
+	for( optimizer::Pass pass : passes.pipeline )
+	{
+		if( !optimizer::IsTreePass( pass ) )
+			pipeline.push_back( pass );
+	}
+
+	if( passes.noreorder )
+		pipeline.push_back( optimizer::Pass::DelaySlots );
+
+	if( pipeline.empty( ) )
+		return true;
+
+	if( !Verify( "code generation" ) )
+		return false;
+
+	for( optimizer::Pass pass : pipeline )
+	{
+		Log( optimizer::Run( pass, program, list ), passes, log );
+		if( !Verify( std::string( "pass " ) + optimizer::GetName( pass ) ) )
+			return false;
+	}
+
+	return true;
+}
+
+void Compiler::Log( const optimizer::Statistics &stats, const Passes &passes, std::ostream *log ) const
+{
+	if( log == nullptr )
+		return;
+
+	*log << stats.details << std::endl;
+	if( passes.statistics )
+		*log << optimizer::ToString( stats ) << std::endl;
+}
+
+// only in debug builds, after what changed the instructions last
+bool Compiler::Verify( const std::string &producer )
+{
+#ifndef NDEBUG
+	std::string message;
+	if( !optimizer::Verify( list, message ) )
+	{
+		Error( producer + " broke the instructions, " + message );
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+std::string Compiler::GetAssembly( ) const
+{
+	std::string assembly;
+	for( const instruction::Base *inst : list )
+		assembly += inst->ToString( );
+
+	return assembly;
+}
+
+std::string Compiler::GetData( ) const
+{
+	std::string data;
+	if( symTable.Empty( ) )
+		return data;
+
+	data += instruction::Section( ".data" ).ToString( );
+	for( const std::string &name : symTable.GetNames( ) )
+		data += instruction::Word( name ).ToString( );
+
+	return data;
+}
+
+bool Compiler::GetObject( bool delaySlots, std::vector<uint8_t> &bytes )
+{
+	object::Encoder encoder( delaySlots );
+	std::string message;
+	if( !encoder.Encode( list, bytes, message ) )
+	{
+		Error( "can't encode " + message );
+		return false;
+	}
+
+	return true;
+}
+
+const node::Block *Compiler::GetProgram( ) const
+{
+	return program;
+}
+
+const flat::Tree &Compiler::GetTree( ) const
+{
+	return tree;
+}
+
+symbol::Table &Compiler::GetSymbols( )
+{
+	return symTable;
+}
+
+const symbol::Table &Compiler::GetSymbols( ) const
+{
+	return symTable;
+}
+
+instruction::List &Compiler::GetInstructions( )
+{
+	return list;
+}
+
+const std::string &Compiler::GetError( ) const
+{
+	return error;
+}
+
+void Compiler::SetProgram( node::Block *block )
+{
+	program = block;
+}
+
+void Compiler::AddStatement( node::Block *block, node::Statement *statement )
+{
+	if( stream == nullptr )
+	{
+		block->statements.push_back( statement );
+		return;
+	}
+
+	// the statement numbers its labels from zero, appending it to list moves
+	// them after the ones already written, which list keeps counting
+	instruction::List instructions;
+	statement->GenerateInstructions( instructions, symTable );
+	delete statement;
+
+	list.Append( instructions );
+	for( instruction::Base *inst : list )
+	{
+		*stream << inst->ToString( );
+		delete inst;
+	}
+
+	list.clear( );
+}
+
+void Compiler::Error( const std::string &message )
+{
+	if( error.empty( ) )
+		error = message;
+}
+
+lexer::Scanner *Compiler::GetScanner( )
+{
+	return scanner.get( );
+}
+
+void *Compiler::GetFlexScanner( )
+{
+	return flexScanner;
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "node.hpp"
+#include "flat.hpp"
+#include "symbol.hpp"
+#include "instruction.hpp"
+#include "lexer.hpp"
+#include "memo.hpp"
+#include "optimizer.hpp"
+
+namespace compiler
+{
+
+enum class Frontend
+{
+	// Bison parser on the Flex scanner
+	Flex,
+	// Bison parser on lexer::Scanner
+	Simd,
+	// pratt::Parse on lexer::Scanner
+	Pratt,
+	// pratt::Parse into a flat::Tree instead of node:: objects
+	Flat
+};
+
+// optional passes, the tree passes of the pipeline run before code
+// generation, the others after it in order, the delay slots are filled last
+struct Passes
+{
+	std::vector<optimizer::Pass> pipeline;
+	bool noreorder = false;
+	// optimizer::ToString for every pass in the log
+	bool statistics = false;
+
+	// appends pass unless the pipeline has it already
+	void Add( optimizer::Pass pass );
+};
+
+// everything one compilation needs (scanner, parser state, symbols, labels
+// and the generated instructions), so separate instances can run at the same
+// time on different threads, one source at a time per instance
+class Compiler
+{
+public:
+	Compiler( );
+	~Compiler( );
+
+	Compiler( const Compiler & ) = delete;
+	Compiler &operator=( const Compiler & ) = delete;
+
+	// back to the state of a new instance for the next source, keeping the
+	// allocated tables and the memoized code
+	void Reset( );
+	// GenerateAssembly reuses the code of the top-level statements that
+	// haven't changed since the last program, for resident compilers
+	void SetMemoize( bool memoize );
+
+	// streaming mode for the Bison frontends: every top-level statement is
+	// generated, written to text and freed as soon as it's reduced, so the
+	// program stays empty and memory depends on the largest statement instead
+	// of the input; the variables are only known at the end, see GetData
+	void SetStream( std::ostream *text );
+	// false on syntax or type errors, with the message in GetError
+	bool Parse( const char *data, size_t size, Frontend frontend = Frontend::Flex );
+	// instructions for the parsed program, the passes work on GetInstructions;
+	// more than one thread splits the top-level statements between them, 0
+	// means one per hardware thread
+	void Generate( uint32_t threads = 1 );
+	// same as Generate and GetAssembly without passes, without keeping the instructions
+	std::string GenerateAssembly( );
+	// the tree passes, before Generate; nothing without a node:: program
+	void RunTreePasses( const Passes &passes, std::ostream *log = nullptr );
+	// pass statistics are written to log when it isn't null; without NDEBUG the
+	// instructions are verified after code generation and every pass, false
+	// with the error when a pass broke them
+	bool RunPasses( const Passes &passes, std::ostream *log = nullptr );
+	std::string GetAssembly( ) const;
+	// .data section of a streamed program, written after its .text
+	std::string GetData( ) const;
+	// relocatable ELF object for the instructions, false with the error on unsupported ones
+	bool GetObject( bool delaySlots, std::vector<uint8_t> &bytes );
+
+	// nullptr with Frontend::Flat
+	const node::Block *GetProgram( ) const;
+	// the program with Frontend::Flat
+	const flat::Tree &GetTree( ) const;
+	symbol::Table &GetSymbols( );
+	const symbol::Table &GetSymbols( ) const;
+	instruction::List &GetInstructions( );
+	const std::string &GetError( ) const;
+
+	// used by the parser and the scanners, only the first error is kept
+	void SetProgram( node::Block *block );
+	void AddStatement( node::Block *block, node::Statement *statement );
+	void Error( const std::string &message );
+	lexer::Scanner *GetScanner( );
+	void *GetFlexScanner( );
+
+private:
+	void Log( const optimizer::Statistics &stats, const Passes &passes, std::ostream *log ) const;
+	bool Verify( const std::string &producer );
+
+	node::Block *program;
+	// the program with Frontend::Flat
+	flat::Tree tree;
+	symbol::Table symTable;
+	instruction::List list;
+	std::string error;
+	std::unique_ptr<lexer::Scanner> scanner;
+	void *flexScanner;
+	std::ostream *stream;
+	memo::Table memo;
+	bool memoize;
+};
+
+}
@@ -0,0 +1,94 @@
+#!/bin/sh
+# deep.sh [parser [depth]]: runs programs nested depth (1000000) levels deep
+# through every front end and fails unless each one exits with 0, and unless
+# the simulator, the VM and the JIT get the right sum for the operators nested
+# on the right (more than there are temporaries); the edit bench reparses the
+# whole statement on every edit, so it gets depth / 10
+
+parser=${1:-./parser}
+depth=${2:-1000000}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+generate( )
+{
+	awk -v n="$1" -v shape="$2" 'BEGIN {
+		if( shape == "paren" ) {
+			printf "int x = "
+			for( i = 0; i < n; i++ ) printf "("
+			printf "1"
+			for( i = 0; i < n; i++ ) printf ")"
+			print ";"
+		} else if( shape == "nested" ) {
+			printf "int x = 1;\nx = "
+			for( i = 0; i < n; i++ ) printf "x + ( "
+			printf "1"
+			for( i = 0; i < n; i++ ) printf " )"
+			print ";"
+		} else if( shape == "sum" ) {
+			printf "int x = 1;\nx = x"
+			for( i = 0; i < n; i++ ) printf " + x"
+			print ";"
+		} else if( shape == "ifs" ) {
+			print "bool b = true;"
+			for( i = 0; i < n; i++ ) printf "if( b ) "
+			print "b = false;"
+		} else if( shape == "else" ) {
+			print "bool b = true;"
+			for( i = 0; i < n; i++ ) printf "if( b ) b = false; else "
+			print "b = true;"
+		} else if( shape == "braces" ) {
+			print "bool b = true;"
+			for( i = 0; i < n; i++ ) printf "if( b ) { "
+			printf "b = false; "
+			for( i = 0; i < n; i++ ) printf "} "
+			print ""
+		} else if( shape == "whiles" ) {
+			print "bool b = false;"
+			for( i = 0; i < n; i++ ) printf "while( b ) { "
+			printf "b = false; "
+			for( i = 0; i < n; i++ ) printf "} "
+			print ""
+		}
+	}' > "$dir/$2.txt"
+}
+
+failed=0
+run( )
+{
+	"$parser" $2 < "$dir/$1.txt" > "$dir/output" 2>&1
+	status=$?
+	if [ $status -ne 0 ]; then
+		echo "$1 $2: exit status $status" >&2
+		grep -m 1 Error "$dir/output" >&2
+		failed=1
+	fi
+}
+
+# the value too where a miscompile would still exit with 0
+check( )
+{
+	run $1 "$2"
+	if ! grep -q "^  x = $3\$" "$dir/output"; then
+		echo "$1 $2: x isn't $3" >&2
+		failed=1
+	fi
+}
+
+for shape in paren nested sum ifs else braces whiles; do
+	generate "$depth" $shape
+	for options in "" "--lexer=simd" "--parser=pratt" "--ast=flat" "--pipeline" "--stream" "--stream --lexer=simd" "--vm" "--jit"; do
+		run $shape "$options"
+	done
+done
+
+check nested "--run" $(( depth + 1 ))
+check nested "--ast=flat --run" $(( depth + 1 ))
+check nested "--vm" $(( depth + 1 ))
+check nested "--jit" $(( depth + 1 ))
+
+generate $(( depth / 10 )) paren
+run paren "--edit-bench"
+
+[ $failed -eq 0 ] && echo "$depth levels deep: every front end passed"
+exit $failed
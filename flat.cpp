@@ -0,0 +1,552 @@
+#include "flat.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace flat
+{
+
+Tree::Tree( )
+{
+	Clear( );
+}
+
+void Tree::Clear( )
+{
+	kinds.clear( );
+	first.clear( );
+	second.clear( );
+	third.clear( );
+	statements.clear( );
+	symbols.clear( );
+	symbolIndices.clear( );
+	open.clear( );
+	root = 0;
+
+	Add( Kind::None );
+}
+
+bool Tree::Empty( ) const
+{
+	return root == 0;
+}
+
+Index Tree::Add( Kind kind, uint32_t first, uint32_t second, uint32_t third )
+{
+	kinds.push_back( kind );
+	this->first.push_back( first );
+	this->second.push_back( second );
+	this->third.push_back( third );
+	return static_cast<Index>( kinds.size( ) - 1 );
+}
+
+uint32_t Tree::AddSymbol( const std::string &name )
+{
+	auto it = symbolIndices.find( name );
+	if( it != symbolIndices.end( ) )
+		return it->second;
+
+	uint32_t symbol = static_cast<uint32_t>( symbols.size( ) );
+	symbols.push_back( name );
+	symbolIndices.emplace( name, symbol );
+	return symbol;
+}
+
+size_t Tree::BeginBlock( ) const
+{
+	return open.size( );
+}
+
+void Tree::Append( Index statement )
+{
+	open.push_back( statement );
+}
+
+// a nested block ends before the one around it, so its statements are the last ones open
+Index Tree::EndBlock( size_t begin )
+{
+	uint32_t start = static_cast<uint32_t>( statements.size( ) );
+	statements.insert( statements.end( ), open.begin( ) + begin, open.end( ) );
+	open.resize( begin );
+	return Add( Kind::Block, start, static_cast<uint32_t>( statements.size( ) - start ) );
+}
+
+// the walks keep what's still to do on a stack, like the ones of node.cpp: a
+// node adds what it's made of in order and the walk pushes that in reverse,
+// so nesting takes memory instead of native stack
+
+std::string Tree::ToString( Index node ) const
+{
+	static const char *operators[] = {
+		" + ", " - ", " * ", " / ", " % ",
+		" == ", " != ", " < ", " <= ", " > ", " >= ",
+		" && ", " || "
+	};
+
+	// a node, or text when it's 0
+	struct Item
+	{
+		Index node;
+		const char *text;
+	};
+
+	std::string text;
+	std::vector<Item> stack( 1, { node, "" } );
+	std::vector<Item> parts;
+	while( !stack.empty( ) )
+	{
+		Item item = stack.back( );
+		stack.pop_back( );
+		if( item.node == 0 )
+		{
+			text += item.text;
+			continue;
+		}
+
+		Index current = item.node;
+		parts.clear( );
+		switch( kinds[current] )
+		{
+			case Kind::Boolean:
+				text += first[current] != 0 ? "true" : "false";
+				continue;
+
+			case Kind::Integer:
+				text += std::to_string( static_cast<int32_t>( first[current] ) );
+				continue;
+
+			case Kind::Identifier:
+				text += symbols[first[current]];
+				continue;
+
+			case Kind::BinaryOperator:
+				parts = { { first[current], "" }, { 0, operators[third[current]] }, { second[current], "" } };
+				break;
+
+			case Kind::Assignment:
+				parts = { { first[current], "" }, { 0, " = " }, { second[current], "" } };
+				break;
+
+			case Kind::IntegerDeclaration:
+			case Kind::BooleanDeclaration:
+				parts = { { 0, kinds[current] == Kind::IntegerDeclaration ? "int " : "bool " }, { first[current], "" } };
+				if( second[current] != 0 )
+					parts.insert( parts.end( ), { { 0, " = " }, { second[current], "" } } );
+
+				break;
+
+			case Kind::IfThenElse:
+				parts = { { 0, "if( " }, { first[current], "" }, { 0, " )\n" }, { second[current], "" } };
+				if( third[current] != 0 )
+					parts.insert( parts.end( ), { { 0, "\nelse\n" }, { third[current], "" } } );
+
+				break;
+
+			case Kind::WhileLoop:
+				parts = { { 0, "while( " }, { first[current], "" }, { 0, " )\n" }, { second[current], "" } };
+				break;
+
+			case Kind::Block:
+				parts.push_back( { 0, "{\n" } );
+				for( uint32_t i = first[current]; i < first[current] + second[current]; ++i )
+					parts.insert( parts.end( ), { { statements[i], "" }, { 0, ";\n" } } );
+
+				parts.push_back( { 0, "}" } );
+				break;
+
+			default:
+				continue;
+		}
+
+		stack.insert( stack.end( ), parts.rbegin( ), parts.rend( ) );
+	}
+
+	return text;
+}
+
+static instruction::Temporary NextTemporary( instruction::Temporary temporary )
+{
+	if( temporary == instruction::Temporary::None )
+		return instruction::Temporary( );
+
+	if( temporary == instruction::Temporary::Nine )
+		return instruction::Temporary::None;
+
+	return static_cast<instruction::Temporary>( static_cast<int32_t>( temporary ) + 1 );
+}
+
+// the only statement of the block if it is an assignment, 0 otherwise
+static Index GetSoleAssignment( const Tree &tree, Index block )
+{
+	if( block == 0 || tree.second[block] != 1 )
+		return 0;
+
+	Index statement = tree.statements[tree.first[block]];
+	return tree.kinds[statement] == Kind::Assignment ? statement : 0;
+}
+
+// same rules as node.cpp: leaves, or one cheap operator over leaves
+static bool IsSpeculatable( const Tree &tree, Index node, bool allowOperator = true )
+{
+	switch( tree.kinds[node] )
+	{
+		case Kind::Boolean:
+		case Kind::Integer:
+		case Kind::Identifier:
+			return true;
+
+		case Kind::BinaryOperator:
+			break;
+
+		default:
+			return false;
+	}
+
+	if( !allowOperator )
+		return false;
+
+	switch( static_cast<node::BinaryOperator::Code>( tree.third[node] ) )
+	{
+		case node::BinaryOperator::Addition:
+		case node::BinaryOperator::Subtraction:
+		case node::BinaryOperator::Multiplication:
+		case node::BinaryOperator::LessThan:
+		case node::BinaryOperator::And:
+		case node::BinaryOperator::Or:
+			return IsSpeculatable( tree, tree.first[node], false ) && IsSpeculatable( tree, tree.second[node], false );
+
+		default:
+			return false;
+	}
+}
+
+// the instructions of node.cpp's Generator for the statements of a tree
+class Generator
+{
+public:
+	Generator( const Tree &tree, instruction::List &list ) :
+		tree( tree ),
+		list( list )
+	{ }
+
+	void Run( Index statement )
+	{
+		stack.push_back( { Item::Statement, statement, instruction::Temporary::None, nullptr } );
+		while( !stack.empty( ) )
+		{
+			Item item = stack.back( );
+			stack.pop_back( );
+			switch( item.kind )
+			{
+				case Item::Expression:
+					Expression( item.node, item.temporary );
+					break;
+
+				case Item::Statement:
+					Statement( item.node );
+					break;
+
+				case Item::Instruction:
+					list.push_back( item.inst );
+					break;
+
+				// what is generated for a variable is its address, operands need the value
+				case Item::Load:
+					if( list.back( )->GetType( ) == instruction::Type::Address )
+						list.push_back( new instruction::Load( item.temporary, item.temporary ) );
+
+					break;
+			}
+
+			stack.insert( stack.end( ), pending.rbegin( ), pending.rend( ) );
+			pending.clear( );
+		}
+	}
+
+private:
+	struct Item
+	{
+		enum Kind
+		{
+			Expression,
+			Statement,
+			Instruction,
+			Load
+		};
+
+		Kind kind;
+		Index node;
+		instruction::Temporary temporary;
+		instruction::Base *inst;
+	};
+
+	void AddExpression( Index node, instruction::Temporary temporary )
+	{
+		pending.push_back( { Item::Expression, node, temporary, nullptr } );
+	}
+
+	void AddStatement( Index node )
+	{
+		pending.push_back( { Item::Statement, node, instruction::Temporary::None, nullptr } );
+	}
+
+	void Add( instruction::Base *inst )
+	{
+		pending.push_back( { Item::Instruction, 0, instruction::Temporary::None, inst } );
+	}
+
+	void AddLoad( instruction::Temporary temporary )
+	{
+		pending.push_back( { Item::Load, 0, temporary, nullptr } );
+	}
+
+	void Expression( Index node, instruction::Temporary temporary );
+	bool Select( Index node );
+	void Statement( Index node );
+
+	const Tree &tree;
+	instruction::List &list;
+	std::vector<Item> stack;
+	std::vector<Item> pending;
+};
+
+void Generator::Expression( Index node, instruction::Temporary temporary )
+{
+	switch( tree.kinds[node] )
+	{
+		case Kind::Boolean:
+			list.push_back( new instruction::Constant( tree.first[node] != 0, temporary ) );
+			return;
+
+		case Kind::Integer:
+			list.push_back( new instruction::Constant( static_cast<int32_t>( tree.first[node] ), temporary ) );
+			return;
+
+		case Kind::Identifier:
+			list.push_back( new instruction::Address( tree.symbols[tree.first[node]], temporary ) );
+			return;
+
+		default:
+			break;
+	}
+
+	instruction::Temporary left = temporary;
+	instruction::Temporary right = NextTemporary( temporary );
+	AddExpression( tree.first[node], temporary );
+	AddLoad( temporary );
+
+	// same spill as node.cpp, an operator on the right of one in $t8 is
+	// evaluated in $t8 again and the left operand comes back in $t9
+	if( right == instruction::Temporary::Nine && tree.kinds[tree.second[node]] == Kind::BinaryOperator )
+	{
+		Add( new instruction::Push( temporary ) );
+		AddExpression( tree.second[node], temporary );
+		Add( new instruction::Pop( right ) );
+		left = right;
+		right = temporary;
+	}
+	else
+	{
+		AddExpression( tree.second[node], right );
+		AddLoad( right );
+	}
+
+	switch( static_cast<node::BinaryOperator::Code>( tree.third[node] ) )
+	{
+		case node::BinaryOperator::Addition:
+			Add( new instruction::Add( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Subtraction:
+			Add( new instruction::Subtract( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Multiplication:
+			Add( new instruction::Multiply( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Division:
+			Add( new instruction::Divide( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Modulo:
+			Add( new instruction::Modulo( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Equal:
+			Add( new instruction::Equal( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::NotEqual:
+			Add( new instruction::NotEqual( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::LessThan:
+			Add( new instruction::LessThan( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::LessEqual:
+			Add( new instruction::LessEqual( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::GreaterThan:
+			Add( new instruction::GreaterThan( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::GreaterEqual:
+			Add( new instruction::GreaterEqual( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::And:
+			Add( new instruction::And( left, right, temporary ) );
+			break;
+
+		case node::BinaryOperator::Or:
+			Add( new instruction::Or( left, right, temporary ) );
+			break;
+	}
+}
+
+// the if-conversion of node.cpp
+bool Generator::Select( Index node )
+{
+	Index success = GetSoleAssignment( tree, tree.second[node] );
+	if( success == 0 || !IsSpeculatable( tree, tree.second[success] ) )
+		return false;
+
+	Index failure = 0;
+	if( tree.third[node] != 0 )
+	{
+		failure = GetSoleAssignment( tree, tree.third[node] );
+		if( failure == 0 || tree.first[tree.first[failure]] != tree.first[tree.first[success]] || !IsSpeculatable( tree, tree.second[failure] ) )
+			return false;
+	}
+
+	AddExpression( tree.first[node], instruction::Temporary::Zero );
+	AddLoad( instruction::Temporary::Zero );
+	AddExpression( tree.second[success], instruction::Temporary::One );
+	AddLoad( instruction::Temporary::One );
+
+	// without an else block the variable keeps its current value
+	AddExpression( failure != 0 ? tree.second[failure] : tree.first[success], instruction::Temporary::Two );
+	AddLoad( instruction::Temporary::Two );
+
+	Add( new instruction::MoveIfZero( instruction::Temporary::Two, instruction::Temporary::Zero, instruction::Temporary::One ) );
+	AddExpression( tree.first[success], instruction::Temporary::Zero );
+	Add( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+	return true;
+}
+
+void Generator::Statement( Index node )
+{
+	switch( tree.kinds[node] )
+	{
+		case Kind::Assignment:
+		case Kind::IntegerDeclaration:
+		case Kind::BooleanDeclaration:
+			if( tree.second[node] == 0 )
+				return;
+
+			AddExpression( tree.second[node], instruction::Temporary::One );
+			AddLoad( instruction::Temporary::One );
+			AddExpression( tree.first[node], instruction::Temporary::Zero );
+			Add( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+			return;
+
+		case Kind::Block:
+			for( uint32_t i = tree.first[node]; i < tree.first[node] + tree.second[node]; ++i )
+				AddStatement( tree.statements[i] );
+
+			return;
+
+		case Kind::IfThenElse:
+		{
+			if( Select( node ) )
+				return;
+
+			uint32_t labelfail = list.NewLabel( );
+			uint32_t labelend = list.NewLabel( );
+
+			AddExpression( tree.first[node], instruction::Temporary::Zero );
+			AddLoad( instruction::Temporary::Zero );
+			Add( new instruction::BranchEqual( instruction::Temporary::Zero, 0, tree.third[node] == 0 ? labelend : labelfail ) );
+			AddStatement( tree.second[node] );
+
+			if( tree.third[node] != 0 )
+			{
+				Add( new instruction::Jump( labelend ) );
+				Add( new instruction::Label( labelfail ) );
+				AddStatement( tree.third[node] );
+			}
+
+			Add( new instruction::Label( labelend ) );
+			return;
+		}
+
+		case Kind::WhileLoop:
+		{
+			uint32_t labelstart = list.NewLabel( );
+			uint32_t labelend = list.NewLabel( );
+
+			Add( new instruction::Label( labelstart ) );
+			AddExpression( tree.first[node], instruction::Temporary::Zero );
+			AddLoad( instruction::Temporary::Zero );
+			Add( new instruction::BranchEqual( instruction::Temporary::Zero, 0, labelend ) );
+			AddStatement( tree.second[node] );
+			Add( new instruction::Jump( labelstart ) );
+			Add( new instruction::Label( labelend ) );
+			return;
+		}
+
+		default:
+			return;
+	}
+}
+
+void Generate( const Tree &tree, instruction::List &list, const symbol::Table &symTable )
+{
+	if( list.empty( ) )
+		node::GeneratePrologue( list, symTable );
+
+	Generator generator( tree, list );
+	generator.Run( tree.root );
+}
+
+void Generate( const Tree &tree, instruction::List &list, const symbol::Table &symTable, pool::ThreadPool &pool )
+{
+	// below this many statements per chunk the threads cost more than they save
+	const uint32_t minimumChunk = 256;
+
+	uint32_t begin = tree.first[tree.root];
+	uint32_t count = tree.second[tree.root];
+	uint32_t chunks = std::min<uint32_t>( pool.GetSize( ) * 4, count / minimumChunk );
+	if( chunks < 2 )
+	{
+		Generate( tree, list, symTable );
+		return;
+	}
+
+	if( list.empty( ) )
+		node::GeneratePrologue( list, symTable );
+
+	// numbered from zero in each chunk and moved after the ones before by Append, like node::Block
+	std::vector<instruction::List> buffers( chunks );
+	for( uint32_t i = 0; i < chunks; i++ )
+	{
+		uint32_t first = begin + static_cast<uint32_t>( ( static_cast<uint64_t>( count ) * i ) / chunks );
+		uint32_t last = begin + static_cast<uint32_t>( ( static_cast<uint64_t>( count ) * ( i + 1 ) ) / chunks );
+		instruction::List *buffer = &buffers[i];
+		pool.Submit( [&tree, first, last, buffer]( )
+		{
+			Generator generator( tree, *buffer );
+			for( uint32_t statement = first; statement < last; ++statement )
+				generator.Run( tree.statements[statement] );
+		} );
+	}
+
+	pool.Wait( );
+
+	for( instruction::List &buffer : buffers )
+		list.Append( buffer );
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.hpp"
+#include "symbol.hpp"
+#include "instruction.hpp"
+#include "pool.hpp"
+
+namespace flat
+{
+
+// the node:: classes the Pratt parser builds
+enum class Kind : uint8_t
+{
+	None,
+	Boolean,
+	Integer,
+	Identifier,
+	BinaryOperator,
+	Assignment,
+	Block,
+	IntegerDeclaration,
+	BooleanDeclaration,
+	IfThenElse,
+	WhileLoop
+};
+
+// position of a node in the arrays, 0 stands for no node
+typedef uint32_t Index;
+
+// the same tree as node::Block and its children without an object per node:
+// every node is an entry of parallel arrays, its kind and three 32-bit fields
+// whose meaning depends on it
+//   Boolean, Integer      first: the value
+//   Identifier            first: the symbol
+//   BinaryOperator        first, second: the operands, third: node::BinaryOperator::Code
+//   Assignment            first: the identifier, second: the value
+//   Integer/BooleanDeclaration  first: the identifier, second: the value or 0
+//   IfThenElse            first: the test, second, third: the blocks (third 0 without else)
+//   WhileLoop             first: the test, second: the block
+//   Block                 first: where its statements start in statements, second: how many
+// so a node takes 13 bytes instead of a heap object with a vtable, the
+// statements of a block are contiguous and walking the tree reads arrays
+class Tree
+{
+public:
+	Tree( );
+
+	// keeps the allocated arrays
+	void Clear( );
+	bool Empty( ) const;
+
+	Index Add( Kind kind, uint32_t first = 0, uint32_t second = 0, uint32_t third = 0 );
+	// the same name always gets the same symbol
+	uint32_t AddSymbol( const std::string &name );
+	// statements are appended between BeginBlock and EndBlock, blocks may nest
+	size_t BeginBlock( ) const;
+	void Append( Index statement );
+	Index EndBlock( size_t begin );
+
+	// same text as node::Base::ToString
+	std::string ToString( Index node ) const;
+
+	std::vector<Kind> kinds;
+	std::vector<uint32_t> first;
+	std::vector<uint32_t> second;
+	std::vector<uint32_t> third;
+	std::vector<Index> statements;
+	std::vector<std::string> symbols;
+	// the program, a Block
+	Index root;
+
+private:
+	std::unordered_map<std::string, uint32_t> symbolIndices;
+	// statements of the blocks being parsed
+	std::vector<Index> open;
+};
+
+// same instructions as node::Block::GenerateInstructions for the root
+void Generate( const Tree &tree, instruction::List &list, const symbol::Table &symTable );
+// with the top-level statements split into chunks generated on pool
+void Generate( const Tree &tree, instruction::List &list, const symbol::Table &symTable, pool::ThreadPool &pool );
+
+}
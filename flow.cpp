@@ -0,0 +1,236 @@
+#include "flow.hpp"
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace flow
+{
+
+static bool IsLabel( const instruction::Base *inst )
+{
+	return inst->GetType( ) == instruction::Type::Label;
+}
+
+static bool IsJump( const instruction::Base *inst )
+{
+	return inst->GetType( ) == instruction::Type::Jump;
+}
+
+static bool IsBranch( const instruction::Base *inst )
+{
+	return inst->GetType( ) == instruction::Type::Branch;
+}
+
+static uint32_t GetTarget( const instruction::Base *inst )
+{
+	if( IsJump( inst ) )
+		return static_cast<const instruction::Jump *>( inst )->GetLabel( );
+
+	return static_cast<const instruction::Branch *>( inst )->GetLabel( );
+}
+
+static void SetTarget( instruction::Base *inst, uint32_t label )
+{
+	if( IsJump( inst ) )
+		static_cast<instruction::Jump *>( inst )->SetLabel( label );
+	else
+		static_cast<instruction::Branch *>( inst )->SetLabel( label );
+}
+
+static uint32_t GetLabel( const instruction::Base *inst )
+{
+	return static_cast<const instruction::Label *>( inst )->GetLabel( );
+}
+
+// every run of adjacent labels becomes its first label, labels nobody
+// references are dropped
+static bool MergeLabels( instruction::List &list, BranchStatistics &stats )
+{
+	std::unordered_map<uint32_t, uint32_t> aliases;
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); )
+	{
+		if( !IsLabel( *it ) )
+		{
+			++it;
+			continue;
+		}
+
+		uint32_t label = GetLabel( *it );
+		for( ++it; it != list.end( ) && IsLabel( *it ); ++it )
+			aliases[GetLabel( *it )] = label;
+	}
+
+	std::unordered_set<uint32_t> referenced;
+	for( instruction::Base *inst : list )
+	{
+		if( !IsJump( inst ) && !IsBranch( inst ) )
+			continue;
+
+		auto alias = aliases.find( GetTarget( inst ) );
+		if( alias != aliases.end( ) )
+			SetTarget( inst, alias->second );
+
+		referenced.insert( GetTarget( inst ) );
+	}
+
+	bool changed = false;
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); )
+	{
+		if( IsLabel( *it ) && referenced.find( GetLabel( *it ) ) == referenced.end( ) )
+		{
+			delete *it;
+			it = list.erase( it );
+			++stats.merged;
+			changed = true;
+		}
+		else
+			++it;
+	}
+
+	return changed;
+}
+
+// jumps and branches to a label that's immediately followed by a jump go
+// straight to that jump's target; every chain is followed once, the labels on
+// it remember where it ends, and a cycle ends where it was entered
+static bool ThreadJumps( instruction::List &list, BranchStatistics &stats )
+{
+	std::unordered_map<uint32_t, uint32_t> forward;
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); ++it )
+	{
+		if( !IsLabel( *it ) )
+			continue;
+
+		instruction::List::iterator next = std::next( it );
+		if( next != list.end( ) && IsJump( *next ) && GetTarget( *next ) != GetLabel( *it ) )
+			forward[GetLabel( *it )] = GetTarget( *next );
+	}
+
+	// labels on the chain being followed map to UINT32_MAX until it ends
+	std::unordered_map<uint32_t, uint32_t> resolved;
+	std::vector<uint32_t> path;
+	auto resolve = [&]( uint32_t label )
+	{
+		path.clear( );
+		uint32_t target = label;
+		for( ;; )
+		{
+			auto known = resolved.find( target );
+			if( known != resolved.end( ) )
+			{
+				if( known->second != UINT32_MAX )
+					target = known->second;
+
+				break;
+			}
+
+			auto it = forward.find( target );
+			if( it == forward.end( ) )
+				break;
+
+			resolved[target] = UINT32_MAX;
+			path.push_back( target );
+			target = it->second;
+		}
+
+		for( uint32_t hop : path )
+			resolved[hop] = target;
+
+		return target;
+	};
+
+	bool changed = false;
+	for( instruction::Base *inst : list )
+	{
+		if( !IsJump( inst ) && !IsBranch( inst ) )
+			continue;
+
+		uint32_t target = resolve( GetTarget( inst ) );
+		if( target != GetTarget( inst ) )
+		{
+			SetTarget( inst, target );
+			++stats.threaded;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+// nothing after an unconditional jump is reachable until the next label
+static bool RemoveUnreachable( instruction::List &list, BranchStatistics &stats )
+{
+	bool changed = false;
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); ++it )
+	{
+		if( !IsJump( *it ) )
+			continue;
+
+		instruction::List::iterator next = std::next( it );
+		while( next != list.end( ) && !IsLabel( *next ) && ( *next )->GetReadMask( ) != instruction::AllMask )
+		{
+			delete *next;
+			next = list.erase( next );
+			++stats.unreachable;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+// a jump or branch whose target directly follows it does nothing
+static bool RemoveJumpsToNext( instruction::List &list, BranchStatistics &stats )
+{
+	bool changed = false;
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); )
+	{
+		bool fallthrough = false;
+		if( IsJump( *it ) || IsBranch( *it ) )
+		{
+			uint32_t target = GetTarget( *it );
+			for( instruction::List::iterator next = std::next( it ); next != list.end( ) && IsLabel( *next ); ++next )
+				if( GetLabel( *next ) == target )
+					fallthrough = true;
+		}
+
+		// the jump or branch before may go to the next instruction now too
+		if( fallthrough )
+		{
+			delete *it;
+			it = list.erase( it );
+			if( it != list.begin( ) )
+				--it;
+
+			++stats.removed;
+			changed = true;
+		}
+		else
+			++it;
+	}
+
+	return changed;
+}
+
+BranchStatistics SimplifyBranches( instruction::List &list )
+{
+	BranchStatistics stats;
+
+	// every step finishes what it exposes for itself, a round only catches what
+	// the steps expose for each other (two do on real code), and the bound
+	// keeps contrived code linear
+	bool changed = true;
+	for( uint32_t round = 0; changed && round < 4; ++round )
+	{
+		changed = MergeLabels( list, stats );
+		changed |= ThreadJumps( list, stats );
+		changed |= RemoveUnreachable( list, stats );
+		changed |= RemoveJumpsToNext( list, stats );
+	}
+
+	return stats;
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "instruction.hpp"
+
+namespace flow
+{
+
+struct BranchStatistics
+{
+	uint32_t threaded = 0;
+	uint32_t merged = 0;
+	uint32_t unreachable = 0;
+	uint32_t removed = 0;
+};
+
+// branch simplification over labels, in linear rounds until nothing changes:
+// merges adjacent labels (dropping unreferenced ones), threads jumps and
+// branches whose target is an unconditional jump, removes unreachable code
+// after unconditional jumps and deletes jumps and branches to the next
+// instruction
+BranchStatistics SimplifyBranches( instruction::List &list );
+
+}
@@ -0,0 +1,175 @@
+#include "globals.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace globals
+{
+
+static bool IsBarrier( const instruction::Base *inst )
+{
+	instruction::Type type = inst->GetType( );
+	return type == instruction::Type::Label || type == instruction::Type::Jump || type == instruction::Type::Branch ||
+		inst->GetReadMask( ) == instruction::AllMask || inst->GetWriteMask( ) == instruction::AllMask;
+}
+
+static bool IsRegister( const instruction::Variable &variable, instruction::Temporary temporary )
+{
+	return variable.GetType( ) == instruction::Variable::Type::Register && variable.GetTemporary( ) == temporary;
+}
+
+// whether the register still holds something useful after the instruction,
+// temporaries are never live across labels or branches
+static bool IsLiveAfter( const instruction::List &list, instruction::List::const_iterator it, uint32_t mask )
+{
+	for( ++it; it != list.end( ); ++it )
+	{
+		if( ( ( *it )->GetReadMask( ) & mask ) != 0 && ( *it )->GetReadMask( ) != instruction::AllMask )
+			return true;
+
+		if( IsBarrier( *it ) || ( ( *it )->GetWriteMask( ) & mask ) != 0 )
+			return false;
+	}
+
+	return false;
+}
+
+// static reference count of every variable, each loop nesting level weighs 8 times more
+static std::unordered_map<std::string, uint64_t> GetWeights( const instruction::List &list )
+{
+	std::unordered_map<uint32_t, size_t> labels;
+	std::vector<const instruction::Base *> insts( list.begin( ), list.end( ) );
+	for( size_t i = 0; i < insts.size( ); ++i )
+		if( insts[i]->GetType( ) == instruction::Type::Label )
+			labels[static_cast<const instruction::Label *>( insts[i] )->GetLabel( )] = i;
+
+	std::vector<int32_t> depth( insts.size( ) + 1, 0 );
+	for( size_t i = 0; i < insts.size( ); ++i )
+	{
+		if( insts[i]->GetType( ) != instruction::Type::Jump )
+			continue;
+
+		auto it = labels.find( static_cast<const instruction::Jump *>( insts[i] )->GetLabel( ) );
+		if( it != labels.end( ) && it->second < i )
+		{
+			++depth[it->second];
+			--depth[i + 1];
+		}
+	}
+
+	std::unordered_map<std::string, uint64_t> weights;
+	int32_t current = 0;
+	for( size_t i = 0; i < insts.size( ); ++i )
+	{
+		current += depth[i];
+		if( insts[i]->GetType( ) == instruction::Type::Address )
+		{
+			const instruction::Address *address = static_cast<const instruction::Address *>( insts[i] );
+			weights[address->GetAddress( ).GetAddress( )] += uint64_t( 1 ) << std::min( 3 * current, 48 );
+		}
+	}
+
+	return weights;
+}
+
+// $gp points 0x7ff0 bytes into .sdata like the linker sets it, so a signed
+// 16-bit %gp_rel offset reaches its first 0xfff0 bytes
+static const size_t SmallDataWords = 0xFFF0 / 4;
+
+// fills .sdata with the heaviest variables, the rest stay in .data, and
+// returns the ones that went to .sdata
+static std::unordered_set<std::string> LayoutSmallData( instruction::List &list, const std::unordered_map<std::string, uint64_t> &weights )
+{
+	std::unordered_set<std::string> small;
+
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); ++it )
+	{
+		if( ( *it )->GetType( ) != instruction::Type::Section )
+			continue;
+
+		instruction::Section *section = static_cast<instruction::Section *>( *it );
+		if( section->GetName( ) != ".data" )
+			continue;
+
+		section->SetName( ".sdata" );
+
+		instruction::List::iterator first = std::next( it );
+		instruction::List::iterator last = first;
+		while( last != list.end( ) && ( *last )->GetType( ) == instruction::Type::Word )
+			++last;
+
+		std::vector<instruction::Base *> words( first, last );
+		std::stable_sort( words.begin( ), words.end( ), [&weights]( const instruction::Base *a, const instruction::Base *b )
+		{
+			auto left = weights.find( static_cast<const instruction::Word *>( a )->GetLabel( ) );
+			auto right = weights.find( static_cast<const instruction::Word *>( b )->GetLabel( ) );
+			return ( left != weights.end( ) ? left->second : 0 ) > ( right != weights.end( ) ? right->second : 0 );
+		} );
+		std::copy( words.begin( ), words.end( ), first );
+
+		size_t count = std::min( words.size( ), SmallDataWords );
+		for( size_t i = 0; i < count; ++i )
+			small.insert( static_cast<const instruction::Word *>( words[i] )->GetLabel( ) );
+
+		if( count < words.size( ) )
+			list.insert( std::next( first, count ), new instruction::Section( ".data" ) );
+
+		break;
+	}
+
+	return small;
+}
+
+GlobalPointerStatistics UseGlobalPointer( instruction::List &list )
+{
+	GlobalPointerStatistics stats;
+
+	std::unordered_set<std::string> small = LayoutSmallData( list, GetWeights( list ) );
+
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); ++it )
+	{
+		if( ( *it )->GetType( ) != instruction::Type::Address )
+			continue;
+
+		instruction::List::iterator next = std::next( it );
+		if( next == list.end( ) )
+			break;
+
+		const instruction::Address *address = static_cast<const instruction::Address *>( *it );
+		instruction::Temporary temporary = address->GetResult( ).GetTemporary( );
+		const std::string &label = address->GetAddress( ).GetAddress( );
+		if( small.count( label ) == 0 )
+			continue;
+
+		instruction::Base *folded = nullptr;
+		if( ( *next )->GetType( ) == instruction::Type::Load )
+		{
+			const instruction::Load *load = static_cast<const instruction::Load *>( *next );
+			if( IsRegister( load->GetAddress( ), temporary ) &&
+				( IsRegister( load->GetResult( ), temporary ) || !IsLiveAfter( list, next, address->GetWriteMask( ) ) ) )
+				folded = new instruction::Load( label, load->GetResult( ) );
+		}
+		else if( ( *next )->GetType( ) == instruction::Type::Save )
+		{
+			const instruction::Save *save = static_cast<const instruction::Save *>( *next );
+			if( IsRegister( save->GetAddress( ), temporary ) && !IsRegister( save->GetValue( ), temporary ) &&
+				!IsLiveAfter( list, next, address->GetWriteMask( ) ) )
+				folded = new instruction::Save( save->GetValue( ), label );
+		}
+
+		if( folded == nullptr )
+			continue;
+
+		delete *it;
+		delete *next;
+		*next = folded;
+		it = list.erase( it );
+		++stats.folded;
+	}
+
+	return stats;
+}
+
+}
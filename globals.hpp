@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include "instruction.hpp"
+
+namespace globals
+{
+
+struct GlobalPointerStatistics
+{
+	uint32_t folded = 0;
+};
+
+// moves the variables to the small data section, ordered by how often they're
+// referenced (references inside loops weigh more, ties keep declaration order)
+// so hot variables share cache lines, and folds every "LA + LW/SW 0(reg)" pair
+// on them into a single $gp relative LW/SW; the ones that don't fit in the
+// 64 KB $gp reaches stay in .data behind LA
+GlobalPointerStatistics UseGlobalPointer( instruction::List &list );
+
+}
@@ -0,0 +1,767 @@
+#include "image.hpp"
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace image
+{
+
+// bytes per record of each section
+static const uint64_t recordSizes[SectionCount] = {
+	sizeof( Range ),
+	1,
+	sizeof( Symbol ),
+	sizeof( Node ),
+	sizeof( uint32_t ),
+	sizeof( Instruction )
+};
+
+static uint64_t Align( uint64_t offset )
+{
+	return ( offset + 7 ) & ~static_cast<uint64_t>( 7 );
+}
+
+Writer::Writer( )
+{
+	std::memset( &header, 0, sizeof( header ) );
+	header.magic = Magic;
+	header.version = Version;
+
+	// index 0 stands for no node
+	nodes.push_back( Node( ) );
+}
+
+void Writer::AddSymbols( const symbol::Table &symTable )
+{
+	for( const std::string &name : symTable.GetNames( ) )
+		symbols.push_back( { AddString( name ), static_cast<int32_t>( symTable.Get( name ) ) } );
+}
+
+// preorder on a stack, so every child gets an index after its parent's
+void Writer::AddProgram( const node::Block *program )
+{
+	struct Pending
+	{
+		const node::Base *node;
+		// the field of the parent or the entry of statements the index goes to
+		uint32_t parent;
+		uint32_t field;
+	};
+
+	const uint32_t Statement = 3;
+
+	std::vector<Pending> stack;
+	stack.push_back( { program, 0, 0 } );
+	while( !stack.empty( ) )
+	{
+		Pending pending = stack.back( );
+		stack.pop_back( );
+
+		uint32_t index = static_cast<uint32_t>( nodes.size( ) );
+		nodes.push_back( Node( ) );
+		if( pending.field == Statement )
+			statements[pending.parent] = index;
+		else if( pending.parent != 0 )
+		{
+			Node &parent = nodes[pending.parent];
+			( pending.field == 0 ? parent.first : pending.field == 1 ? parent.second : parent.third ) = index;
+		}
+
+		// pushed last to first, so the first child is visited next
+		std::vector<Pending> children;
+		Node &record = nodes[index];
+		if( const node::Boolean *boolean = dynamic_cast<const node::Boolean *>( pending.node ) )
+		{
+			record.kind = Kind::Boolean;
+			record.first = boolean->value ? 1 : 0;
+		}
+		else if( const node::Integer *integer = dynamic_cast<const node::Integer *>( pending.node ) )
+		{
+			record.kind = Kind::Integer;
+			record.first = static_cast<uint32_t>( integer->value );
+		}
+		else if( const node::Identifier *id = dynamic_cast<const node::Identifier *>( pending.node ) )
+		{
+			record.kind = Kind::Identifier;
+			record.first = AddString( id->name );
+		}
+		else if( const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( pending.node ) )
+		{
+			record.kind = Kind::BinaryOperator;
+			record.third = static_cast<uint32_t>( binop->op );
+			children.push_back( { binop->lhs, index, 0 } );
+			children.push_back( { binop->rhs, index, 1 } );
+		}
+		else if( const node::Assignment *assignment = dynamic_cast<const node::Assignment *>( pending.node ) )
+		{
+			record.kind = Kind::Assignment;
+			children.push_back( { assignment->lhs, index, 0 } );
+			children.push_back( { assignment->rhs, index, 1 } );
+		}
+		else if( const node::Block *block = dynamic_cast<const node::Block *>( pending.node ) )
+		{
+			record.kind = Kind::Block;
+			record.first = static_cast<uint32_t>( statements.size( ) );
+			record.second = static_cast<uint32_t>( block->statements.size( ) );
+			for( const node::Statement *stmt : block->statements )
+			{
+				children.push_back( { stmt, static_cast<uint32_t>( statements.size( ) ), Statement } );
+				statements.push_back( 0 );
+			}
+		}
+		else if( const node::ExpressionStatement *expression = dynamic_cast<const node::ExpressionStatement *>( pending.node ) )
+		{
+			record.kind = Kind::ExpressionStatement;
+			children.push_back( { expression->expression, index, 0 } );
+		}
+		else if( const node::IntegerDeclaration *declaration = dynamic_cast<const node::IntegerDeclaration *>( pending.node ) )
+		{
+			record.kind = Kind::IntegerDeclaration;
+			children.push_back( { declaration->id, index, 0 } );
+			if( declaration->assignmentExpr != nullptr )
+				children.push_back( { declaration->assignmentExpr, index, 1 } );
+		}
+		else if( const node::BooleanDeclaration *declaration = dynamic_cast<const node::BooleanDeclaration *>( pending.node ) )
+		{
+			record.kind = Kind::BooleanDeclaration;
+			children.push_back( { declaration->id, index, 0 } );
+			if( declaration->assignmentExpr != nullptr )
+				children.push_back( { declaration->assignmentExpr, index, 1 } );
+		}
+		else if( const node::IfThenElse *ifthenelse = dynamic_cast<const node::IfThenElse *>( pending.node ) )
+		{
+			record.kind = Kind::IfThenElse;
+			children.push_back( { ifthenelse->testExpr, index, 0 } );
+			children.push_back( { ifthenelse->successBlock, index, 1 } );
+			if( ifthenelse->failureBlock != nullptr )
+				children.push_back( { ifthenelse->failureBlock, index, 2 } );
+		}
+		else if( const node::WhileLoop *whileloop = dynamic_cast<const node::WhileLoop *>( pending.node ) )
+		{
+			record.kind = Kind::WhileLoop;
+			children.push_back( { whileloop->testExpr, index, 0 } );
+			children.push_back( { whileloop->successBlock, index, 1 } );
+		}
+
+		stack.insert( stack.end( ), children.rbegin( ), children.rend( ) );
+	}
+
+	header.root = 1;
+	header.contents |= HasProgram;
+}
+
+void Writer::AddInstructions( const instruction::List &list )
+{
+	for( const instruction::Base *inst : list )
+		inst->Store( *this );
+
+	header.labels = list.GetLabelCount( );
+	header.contents |= HasInstructions;
+}
+
+bool Writer::Write( const std::string &path, std::string &error ) const
+{
+	const void *sections[SectionCount] = {
+		strings.data( ),
+		text.data( ),
+		symbols.data( ),
+		nodes.data( ),
+		statements.data( ),
+		instructions.data( )
+	};
+
+	Header layout = header;
+	layout.sections[Strings].count = strings.size( );
+	layout.sections[Text].count = text.size( );
+	layout.sections[Symbols].count = symbols.size( );
+	layout.sections[Nodes].count = nodes.size( );
+	layout.sections[Statements].count = statements.size( );
+	layout.sections[Instructions].count = instructions.size( );
+
+	uint64_t offset = Align( sizeof( layout ) );
+	for( uint32_t i = 0; i < SectionCount; ++i )
+	{
+		layout.sections[i].offset = offset;
+		offset = Align( offset + layout.sections[i].count * recordSizes[i] );
+	}
+
+	std::ofstream file( path, std::ios::binary );
+	const char zeros[8] = { };
+	file.write( reinterpret_cast<const char *>( &layout ), sizeof( layout ) );
+	file.write( zeros, static_cast<std::streamsize>( Align( sizeof( layout ) ) - sizeof( layout ) ) );
+	for( uint32_t i = 0; i < SectionCount; ++i )
+	{
+		uint64_t bytes = layout.sections[i].count * recordSizes[i];
+		file.write( static_cast<const char *>( sections[i] ), static_cast<std::streamsize>( bytes ) );
+		file.write( zeros, static_cast<std::streamsize>( Align( bytes ) - bytes ) );
+	}
+
+	if( !file.flush( ) )
+	{
+		error = "can't write " + path;
+		return false;
+	}
+
+	return true;
+}
+
+void Writer::Add( Opcode opcode, const instruction::Variable &first, const instruction::Variable &second, const instruction::Variable &third )
+{
+	const instruction::Variable *variables[3] = { &first, &second, &third };
+
+	Instruction inst;
+	std::memset( &inst, 0, sizeof( inst ) );
+	inst.opcode = opcode;
+	for( uint32_t i = 0; i < 3; ++i )
+	{
+		inst.types[i] = static_cast<uint8_t>( static_cast<int32_t>( variables[i]->GetType( ) ) + 1 );
+		switch( variables[i]->GetType( ) )
+		{
+			case instruction::Variable::Type::Constant:
+				inst.operands[i] = static_cast<uint32_t>( variables[i]->GetInteger( ) );
+				break;
+
+			case instruction::Variable::Type::Register:
+				inst.operands[i] = static_cast<uint32_t>( variables[i]->GetTemporary( ) );
+				break;
+
+			case instruction::Variable::Type::Memory:
+				inst.operands[i] = AddString( variables[i]->GetAddress( ) );
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	instructions.push_back( inst );
+}
+
+uint32_t Writer::AddString( const std::string &text )
+{
+	auto it = stringIndices.find( text );
+	if( it != stringIndices.end( ) )
+		return it->second;
+
+	uint32_t index = static_cast<uint32_t>( strings.size( ) );
+	strings.push_back( { this->text.size( ), text.size( ) } );
+	this->text += text;
+	stringIndices.emplace( text, index );
+	return index;
+}
+
+Image::Image( ) :
+	data( nullptr ),
+	size( 0 )
+{ }
+
+Image::~Image( )
+{
+	if( data != nullptr )
+		munmap( const_cast<uint8_t *>( data ), size );
+}
+
+bool Image::Open( const std::string &path, std::string &error )
+{
+	int32_t descriptor = open( path.c_str( ), O_RDONLY );
+	if( descriptor < 0 )
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	// the mapping outlives the descriptor
+	struct stat info;
+	void *memory = MAP_FAILED;
+	if( fstat( descriptor, &info ) == 0 && info.st_size >= static_cast<off_t>( sizeof( Header ) ) )
+		memory = mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ, MAP_PRIVATE, descriptor, 0 );
+
+	close( descriptor );
+	if( memory == MAP_FAILED )
+	{
+		error = path + " isn't an image";
+		return false;
+	}
+
+	data = static_cast<const uint8_t *>( memory );
+	size = static_cast<size_t>( info.st_size );
+
+	const Header &header = GetHeader( );
+	if( header.magic != Magic )
+	{
+		error = path + " isn't an image";
+		return false;
+	}
+
+	if( header.version != Version )
+	{
+		error = path + " is version " + std::to_string( header.version ) + ", expected " + std::to_string( Version );
+		return false;
+	}
+
+	for( uint32_t i = 0; i < SectionCount; ++i )
+	{
+		const Range &section = header.sections[i];
+		if( section.offset % 8 != 0 || section.offset > size || section.count > ( size - section.offset ) / recordSizes[i] )
+		{
+			error = path + " is truncated";
+			return false;
+		}
+	}
+
+	const Range *strings = GetSection<Range>( Strings );
+	uint64_t text = header.sections[Text].count;
+	for( uint64_t i = 0; i < header.sections[Strings].count; ++i )
+	{
+		if( strings[i].offset > text || strings[i].count > text - strings[i].offset )
+		{
+			error = path + " has a string out of bounds";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const Header &Image::GetHeader( ) const
+{
+	return *reinterpret_cast<const Header *>( data );
+}
+
+const Node &Image::GetNode( uint32_t index ) const
+{
+	return GetSection<Node>( Nodes )[index];
+}
+
+uint32_t Image::GetStatement( uint32_t index ) const
+{
+	return GetSection<uint32_t>( Statements )[index];
+}
+
+const Instruction &Image::GetInstruction( uint32_t index ) const
+{
+	return GetSection<Instruction>( Instructions )[index];
+}
+
+std::string Image::GetString( uint32_t index ) const
+{
+	const Range &range = GetSection<Range>( Strings )[index];
+	return std::string( GetSection<char>( Text ) + range.offset, range.count );
+}
+
+bool Image::LoadSymbols( symbol::Table &symTable, std::string &error ) const
+{
+	const Header &header = GetHeader( );
+	const Symbol *symbols = GetSection<Symbol>( Symbols );
+	for( uint64_t i = 0; i < header.sections[Symbols].count; ++i )
+	{
+		symbol::Type type = static_cast<symbol::Type>( symbols[i].type );
+		if( symbols[i].name >= header.sections[Strings].count ||
+			( type != symbol::Type::Boolean && type != symbol::Type::Integer ) ||
+			!symTable.Add( GetString( symbols[i].name ), type ) )
+		{
+			error = "invalid symbol " + std::to_string( i );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool IsExpression( Kind kind )
+{
+	return kind == Kind::Boolean || kind == Kind::Integer || kind == Kind::Identifier || kind == Kind::BinaryOperator;
+}
+
+static bool IsStatement( Kind kind )
+{
+	return kind == Kind::Assignment || kind == Kind::ExpressionStatement || kind == Kind::IntegerDeclaration ||
+		kind == Kind::BooleanDeclaration || kind == Kind::IfThenElse || kind == Kind::WhileLoop;
+}
+
+// children come after their parents, so the nodes are built from the last
+// one down and every child is there when its parent is, without recursing
+node::Block *Image::LoadProgram( std::string &error ) const
+{
+	const Header &header = GetHeader( );
+	uint64_t count = header.sections[Nodes].count;
+	if( ( header.contents & HasProgram ) == 0 || header.root == 0 || header.root >= count || GetNode( header.root ).kind != Kind::Block )
+	{
+		error = "the image has no program";
+		return nullptr;
+	}
+
+	std::vector<node::Base *> built( count, nullptr );
+	std::vector<bool> owned( count, false );
+	bool failed = false;
+	uint64_t index = count;
+	while( --index > 0 )
+	{
+		const Node &record = GetNode( static_cast<uint32_t>( index ) );
+
+		// a child of the node being built, if it's there with one of the kinds wanted
+		auto valid = [&]( uint32_t child, bool ( *accept )( Kind ) )
+		{
+			return child > index && child < count && built[child] != nullptr && !owned[child] && accept( GetNode( child ).kind );
+		};
+
+		auto take = [&]( uint32_t child )
+		{
+			owned[child] = true;
+			return built[child];
+		};
+
+		auto identifier = []( Kind kind ) { return kind == Kind::Identifier; };
+		auto block = []( Kind kind ) { return kind == Kind::Block; };
+
+		node::Base *node = nullptr;
+		switch( record.kind )
+		{
+			case Kind::Boolean:
+				node = new node::Boolean( record.first != 0 );
+				break;
+
+			case Kind::Integer:
+				node = new node::Integer( static_cast<int32_t>( record.first ) );
+				break;
+
+			case Kind::Identifier:
+				if( record.first < header.sections[Strings].count )
+					node = new node::Identifier( GetString( record.first ) );
+
+				break;
+
+			case Kind::BinaryOperator:
+				if( valid( record.first, IsExpression ) && valid( record.second, IsExpression ) && record.third <= node::BinaryOperator::Or )
+				{
+					node::Expression *lhs = static_cast<node::Expression *>( take( record.first ) );
+					node::Expression *rhs = static_cast<node::Expression *>( take( record.second ) );
+					node = new node::BinaryOperator( lhs, static_cast<node::BinaryOperator::Code>( record.third ), rhs );
+				}
+
+				break;
+
+			case Kind::Assignment:
+				if( valid( record.first, identifier ) && valid( record.second, IsExpression ) )
+				{
+					node::Identifier *lhs = static_cast<node::Identifier *>( take( record.first ) );
+					node = new node::Assignment( lhs, static_cast<node::Expression *>( take( record.second ) ) );
+				}
+
+				break;
+
+			case Kind::Block:
+			{
+				uint64_t statements = header.sections[Statements].count;
+				if( record.first > statements || record.second > statements - record.first )
+					break;
+
+				bool complete = true;
+				for( uint32_t i = 0; i < record.second && complete; ++i )
+					complete = valid( GetStatement( record.first + i ), IsStatement );
+
+				if( !complete )
+					break;
+
+				node::Block *block = new node::Block( );
+				for( uint32_t i = 0; i < record.second; ++i )
+					block->statements.push_back( static_cast<node::Statement *>( take( GetStatement( record.first + i ) ) ) );
+
+				node = block;
+				break;
+			}
+
+			case Kind::ExpressionStatement:
+				if( valid( record.first, IsExpression ) )
+					node = new node::ExpressionStatement( static_cast<node::Expression *>( take( record.first ) ) );
+
+				break;
+
+			case Kind::IntegerDeclaration:
+			case Kind::BooleanDeclaration:
+			{
+				if( !valid( record.first, identifier ) || ( record.second != 0 && !valid( record.second, IsExpression ) ) )
+					break;
+
+				node::Identifier *id = static_cast<node::Identifier *>( take( record.first ) );
+				node::Expression *value = record.second != 0 ? static_cast<node::Expression *>( take( record.second ) ) : nullptr;
+				if( record.kind == Kind::IntegerDeclaration )
+					node = value != nullptr ? new node::IntegerDeclaration( id, value ) : new node::IntegerDeclaration( id );
+				else
+					node = value != nullptr ? new node::BooleanDeclaration( id, value ) : new node::BooleanDeclaration( id );
+
+				break;
+			}
+
+			case Kind::IfThenElse:
+			{
+				if( !valid( record.first, IsExpression ) || !valid( record.second, block ) || ( record.third != 0 && !valid( record.third, block ) ) )
+					break;
+
+				node::Expression *test = static_cast<node::Expression *>( take( record.first ) );
+				node::Block *success = static_cast<node::Block *>( take( record.second ) );
+				node::Block *failure = record.third != 0 ? static_cast<node::Block *>( take( record.third ) ) : nullptr;
+				node = new node::IfThenElse( test, success, failure );
+				break;
+			}
+
+			case Kind::WhileLoop:
+				if( valid( record.first, IsExpression ) && valid( record.second, block ) )
+				{
+					node::Expression *test = static_cast<node::Expression *>( take( record.first ) );
+					node = new node::WhileLoop( test, static_cast<node::Block *>( take( record.second ) ) );
+				}
+
+				break;
+
+			default:
+				break;
+		}
+
+		if( node == nullptr )
+		{
+			error = "invalid node " + std::to_string( index );
+			failed = true;
+			break;
+		}
+
+		built[index] = node;
+	}
+
+	// every node but the program belongs to another one
+	for( uint64_t i = 1; i < count && !failed; ++i )
+	{
+		if( i != header.root && !owned[i] )
+		{
+			error = "unreferenced node " + std::to_string( i );
+			failed = true;
+		}
+	}
+
+	if( !failed )
+		return static_cast<node::Block *>( built[header.root] );
+
+	for( uint64_t i = 1; i < count; ++i )
+	{
+		if( !owned[i] )
+			delete built[i];
+	}
+
+	return nullptr;
+}
+
+bool Image::GetVariable( const Instruction &inst, uint32_t operand, instruction::Variable &variable ) const
+{
+	uint32_t value = inst.operands[operand];
+	switch( static_cast<instruction::Variable::Type>( static_cast<int32_t>( inst.types[operand] ) - 1 ) )
+	{
+		case instruction::Variable::Type::None:
+			variable = instruction::Variable( );
+			return true;
+
+		case instruction::Variable::Type::Constant:
+			variable = instruction::Variable( static_cast<int32_t>( value ) );
+			return true;
+
+		case instruction::Variable::Type::Register:
+			if( value > static_cast<uint32_t>( instruction::Temporary::Nine ) )
+				return false;
+
+			variable = instruction::Variable( static_cast<instruction::Temporary>( value ) );
+			return true;
+
+		case instruction::Variable::Type::Memory:
+			if( value >= GetHeader( ).sections[Strings].count )
+				return false;
+
+			variable = instruction::Variable( GetString( value ) );
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool Image::LoadInstructions( instruction::List &list, std::string &error ) const
+{
+	const Header &header = GetHeader( );
+	if( ( header.contents & HasInstructions ) == 0 )
+	{
+		error = "the image has no instructions";
+		return false;
+	}
+
+	for( uint32_t i = 0; i < header.labels; ++i )
+		list.NewLabel( );
+
+	for( uint64_t i = 0; i < header.sections[Instructions].count; ++i )
+	{
+		const Instruction &record = GetInstruction( static_cast<uint32_t>( i ) );
+		instruction::Variable a, b, c;
+		bool valid = GetVariable( record, 0, a ) && GetVariable( record, 1, b ) && GetVariable( record, 2, c );
+
+		// the operands that aren't Variables in the constructors
+		bool text = a.GetType( ) == instruction::Variable::Type::Memory;
+		bool target = a.GetType( ) == instruction::Variable::Type::Constant && static_cast<uint32_t>( a.GetInteger( ) ) < header.labels;
+		bool branch = c.GetType( ) == instruction::Variable::Type::Constant && static_cast<uint32_t>( c.GetInteger( ) ) < header.labels;
+		uint32_t label = static_cast<uint32_t>( a.GetInteger( ) );
+		uint32_t branchLabel = static_cast<uint32_t>( c.GetInteger( ) );
+
+		instruction::Base *inst = nullptr;
+		switch( valid ? record.opcode : static_cast<Opcode>( 0xFF ) )
+		{
+			case Opcode::Custom:
+				inst = text ? new instruction::Custom( a.GetAddress( ) ) : nullptr;
+				break;
+
+			case Opcode::Section:
+				inst = text ? new instruction::Section( a.GetAddress( ) ) : nullptr;
+				break;
+
+			case Opcode::Word:
+				inst = text && b.GetType( ) == instruction::Variable::Type::Constant ? new instruction::Word( a.GetAddress( ), b.GetInteger( ) ) : nullptr;
+				break;
+
+			case Opcode::Assignment:
+				inst = new instruction::Assignment( a, b );
+				break;
+
+			case Opcode::Constant:
+				inst = new instruction::Constant( a, b );
+				break;
+
+			case Opcode::Address:
+				inst = text ? new instruction::Address( a.GetAddress( ), b ) : nullptr;
+				break;
+
+			case Opcode::Load:
+				inst = new instruction::Load( a, b );
+				break;
+
+			case Opcode::Save:
+				inst = new instruction::Save( a, b );
+				break;
+
+			case Opcode::Push:
+				inst = new instruction::Push( a );
+				break;
+
+			case Opcode::Pop:
+				inst = new instruction::Pop( a );
+				break;
+
+			case Opcode::Nop:
+				inst = new instruction::Nop( );
+				break;
+
+			case Opcode::Label:
+				inst = target ? new instruction::Label( label ) : nullptr;
+				break;
+
+			case Opcode::Jump:
+				inst = target ? new instruction::Jump( label ) : nullptr;
+				break;
+
+			case Opcode::BranchLessThan:
+				inst = branch ? new instruction::BranchLessThan( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::BranchLessEqual:
+				inst = branch ? new instruction::BranchLessEqual( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::BranchNotEqual:
+				inst = branch ? new instruction::BranchNotEqual( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::BranchEqual:
+				inst = branch ? new instruction::BranchEqual( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::BranchGreaterEqual:
+				inst = branch ? new instruction::BranchGreaterEqual( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::BranchGreaterThan:
+				inst = branch ? new instruction::BranchGreaterThan( a, b, branchLabel ) : nullptr;
+				break;
+
+			case Opcode::LessThan:
+				inst = new instruction::LessThan( a, b, c );
+				break;
+
+			case Opcode::LessEqual:
+				inst = new instruction::LessEqual( a, b, c );
+				break;
+
+			case Opcode::NotEqual:
+				inst = new instruction::NotEqual( a, b, c );
+				break;
+
+			case Opcode::Equal:
+				inst = new instruction::Equal( a, b, c );
+				break;
+
+			case Opcode::GreaterEqual:
+				inst = new instruction::GreaterEqual( a, b, c );
+				break;
+
+			case Opcode::GreaterThan:
+				inst = new instruction::GreaterThan( a, b, c );
+				break;
+
+			case Opcode::And:
+				inst = new instruction::And( a, b, c );
+				break;
+
+			case Opcode::Or:
+				inst = new instruction::Or( a, b, c );
+				break;
+
+			case Opcode::MoveIfZero:
+				inst = new instruction::MoveIfZero( a, b, c );
+				break;
+
+			case Opcode::Add:
+				inst = new instruction::Add( a, b, c );
+				break;
+
+			case Opcode::Subtract:
+				inst = new instruction::Subtract( a, b, c );
+				break;
+
+			case Opcode::Multiply:
+				inst = new instruction::Multiply( a, b, c );
+				break;
+
+			case Opcode::Divide:
+				inst = new instruction::Divide( a, b, c );
+				break;
+
+			case Opcode::Modulo:
+				inst = new instruction::Modulo( a, b, c );
+				break;
+		}
+
+		if( inst == nullptr )
+		{
+			error = "invalid instruction " + std::to_string( i );
+			return false;
+		}
+
+		list.push_back( inst );
+	}
+
+	return true;
+}
+
+template <typename Record>
+const Record *Image::GetSection( Section section ) const
+{
+	return reinterpret_cast<const Record *>( data + GetHeader( ).sections[section].offset );
+}
+
+}
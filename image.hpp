@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.hpp"
+#include "symbol.hpp"
+#include "instruction.hpp"
+
+namespace image
+{
+
+// "C0IM" on little endian hosts, Version changes with any record below
+const uint32_t Magic = 0x4D493043;
+const uint32_t Version = 2;
+
+enum Section
+{
+	// Range records into Text, every identifier, label and directive once
+	Strings,
+	Text,
+	Symbols,
+	Nodes,
+	// the statements of every block, contiguous per block
+	Statements,
+	Instructions,
+	SectionCount
+};
+
+// what a file holds besides the symbols
+enum Contents
+{
+	HasProgram = 1,
+	HasInstructions = 2
+};
+
+struct Range
+{
+	uint64_t offset;
+	uint64_t count;
+};
+
+// at offset 0, every section starts at a multiple of 8 bytes
+struct Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t contents;
+	// the program Block in Nodes
+	uint32_t root;
+	// handed out by the instruction list
+	uint32_t labels;
+	uint32_t padding;
+	Range sections[SectionCount];
+};
+
+struct Symbol
+{
+	uint32_t name;
+	int32_t type;
+};
+
+// the node:: classes
+enum class Kind : uint8_t
+{
+	None,
+	Boolean,
+	Integer,
+	Identifier,
+	BinaryOperator,
+	Assignment,
+	Block,
+	ExpressionStatement,
+	IntegerDeclaration,
+	BooleanDeclaration,
+	IfThenElse,
+	WhileLoop
+};
+
+// the fields of flat::Tree: children are node indices, 0 for none, and always
+// after their parent; ExpressionStatement keeps its expression in first
+struct Node
+{
+	Kind kind;
+	uint8_t padding[3];
+	uint32_t first;
+	uint32_t second;
+	uint32_t third;
+};
+
+// the instruction:: classes
+enum class Opcode : uint8_t
+{
+	Custom,
+	Section,
+	Word,
+	Assignment,
+	Constant,
+	Address,
+	Load,
+	Save,
+	Nop,
+	Label,
+	Jump,
+	BranchLessThan,
+	BranchLessEqual,
+	BranchNotEqual,
+	BranchEqual,
+	BranchGreaterEqual,
+	BranchGreaterThan,
+	LessThan,
+	LessEqual,
+	NotEqual,
+	Equal,
+	GreaterEqual,
+	GreaterThan,
+	And,
+	Or,
+	MoveIfZero,
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Modulo,
+	Push,
+	Pop
+};
+
+// the arguments of the constructor in order, each an instruction::Variable
+// (labels are constants, memory operands strings)
+struct Instruction
+{
+	Opcode opcode;
+	// instruction::Variable::Type + 1
+	uint8_t types[3];
+	uint32_t operands[3];
+};
+
+// collects any of the symbols, a program and an instruction list, so a file
+// can be written after parsing, code generation or the passes
+class Writer
+{
+public:
+	Writer( );
+
+	void AddSymbols( const symbol::Table &symTable );
+	void AddProgram( const node::Block *program );
+	void AddInstructions( const instruction::List &list );
+	bool Write( const std::string &path, std::string &error ) const;
+
+	// used by instruction::Base::Store
+	void Add(
+		Opcode opcode,
+		const instruction::Variable &first = instruction::Variable( ),
+		const instruction::Variable &second = instruction::Variable( ),
+		const instruction::Variable &third = instruction::Variable( )
+	);
+
+private:
+	uint32_t AddString( const std::string &text );
+
+	Header header;
+	std::vector<Range> strings;
+	std::string text;
+	std::unordered_map<std::string, uint32_t> stringIndices;
+	std::vector<Symbol> symbols;
+	std::vector<Node> nodes;
+	std::vector<uint32_t> statements;
+	std::vector<Instruction> instructions;
+};
+
+// a file mapped read only, its records are used in place, only the header and
+// the string table are checked when it's opened, the rest while it's loaded
+class Image
+{
+public:
+	Image( );
+	~Image( );
+
+	Image( const Image & ) = delete;
+	Image &operator=( const Image & ) = delete;
+
+	bool Open( const std::string &path, std::string &error );
+
+	const Header &GetHeader( ) const;
+	const Node &GetNode( uint32_t index ) const;
+	uint32_t GetStatement( uint32_t index ) const;
+	const Instruction &GetInstruction( uint32_t index ) const;
+	std::string GetString( uint32_t index ) const;
+
+	bool LoadSymbols( symbol::Table &symTable, std::string &error ) const;
+	// nullptr with the error when the tree isn't well formed
+	node::Block *LoadProgram( std::string &error ) const;
+	bool LoadInstructions( instruction::List &list, std::string &error ) const;
+
+private:
+	template <typename Record> const Record *GetSection( Section section ) const;
+	bool GetVariable( const Instruction &inst, uint32_t operand, instruction::Variable &variable ) const;
+
+	const uint8_t *data;
+	size_t size;
+};
+
+}
@@ -0,0 +1,313 @@
+#include "incremental.hpp"
+#include <algorithm>
+#include "lexer.hpp"
+#include "pratt.hpp"
+
+namespace incremental
+{
+
+// apart when the entries are numbered again, so as many statements can be inserted between two as they'll ever be split into
+static const uint64_t spacing = 1ULL << 24;
+
+// what the statements before the one being parsed declared
+class Document::Scope : public pratt::Scope
+{
+public:
+	Scope( const Document &document, uint64_t order ) :
+		document( document ),
+		order( order )
+	{
+	}
+
+	symbol::Type Get( const std::string &name ) const override
+	{
+		auto it = document.declarations.find( name );
+		if( it == document.declarations.end( ) )
+			return symbol::Type::None;
+
+		auto first = it->second.begin( );
+		return first->first->order < order ? first->second : symbol::Type::None;
+	}
+
+private:
+	const Document &document;
+	uint64_t order;
+};
+
+Document::Document( const std::string &text ) :
+	text( text )
+{
+	Reparse( 0, 0, 0 );
+	pending.clear( );
+}
+
+Document::~Document( )
+{
+	for( Entry *entry : entries )
+	{
+		delete entry->statement;
+		delete entry;
+	}
+}
+
+bool Document::Edit( size_t offset, size_t removed, const std::string &inserted )
+{
+	if( offset > text.size( ) || removed > text.size( ) - offset )
+		return false;
+
+	stats.edits++;
+
+	// the statement the edit starts in and the one before, whose if may take an else from it
+	size_t end = std::upper_bound( offsets.begin( ), offsets.end( ), offset ) - offsets.begin( );
+	size_t first = end > 1 ? end - 2 : 0;
+
+	// and the ones that started in the removed text
+	while( end < offsets.size( ) && offsets[end] < offset + removed )
+		end++;
+
+	for( size_t i = first; i < end; ++i )
+		Unregister( entries[i] );
+
+	text.replace( offset, removed, inserted );
+	for( size_t i = end; i < offsets.size( ); ++i )
+		offsets[i] = offsets[i] - removed + inserted.size( );
+
+	Reparse( first, end, offsets.empty( ) ? 0 : offsets[first] );
+
+	while( !pending.empty( ) )
+	{
+		size_t index = Find( *pending.begin( ) );
+		Unregister( entries[index] );
+		Reparse( index, index + 1, offsets[index] );
+		stats.rechecked++;
+	}
+
+	return true;
+}
+
+const std::string &Document::GetText( ) const
+{
+	return text;
+}
+
+std::vector<Diagnostic> Document::GetDiagnostics( ) const
+{
+	std::vector<Diagnostic> diagnostics;
+	if( entries.empty( ) )
+		diagnostics.push_back( { text.size( ), "syntax error, unexpected end of file" } );
+
+	for( const Entry *entry : failed )
+		diagnostics.push_back( { offsets[Find( entry )] + entry->errorOffset, entry->error } );
+
+	return diagnostics;
+}
+
+size_t Document::GetStatementCount( ) const
+{
+	return entries.size( );
+}
+
+const node::Statement *Document::GetStatement( size_t index ) const
+{
+	return entries[index]->statement;
+}
+
+Statistics Document::GetStatistics( ) const
+{
+	return stats;
+}
+
+Document::Entry *Document::ParseEntry( size_t position, uint64_t order, size_t &end )
+{
+	Scope scope( *this, order );
+	symbol::Table symTable;
+	pratt::Statement parsed = pratt::ParseStatement( text.data( ) + position, text.size( ) - position, scope, symTable );
+
+	Entry *entry = new Entry;
+	entry->order = order;
+	entry->statement = parsed.statement;
+	entry->errorOffset = 0;
+	if( parsed.statement != nullptr )
+		end = position + parsed.end;
+	else
+	{
+		entry->error = parsed.error;
+		entry->errorOffset = parsed.end;
+		end = Recover( position, parsed.end );
+	}
+
+	for( const std::string &name : symTable.GetNames( ) )
+		entry->declarations.push_back( { name, symTable.Get( name ) } );
+
+	lexer::Scanner scanner( text.data( ) + position, end - position );
+	for( lexer::Token token = scanner.Next( ); token.kind != lexer::Kind::End; token = scanner.Next( ) )
+	{
+		if( token.kind == lexer::Kind::Identifier )
+			entry->names.push_back( std::string( scanner.GetText( token ), token.length ) );
+	}
+
+	std::sort( entry->names.begin( ), entry->names.end( ) );
+	entry->names.erase( std::unique( entry->names.begin( ), entry->names.end( ) ), entry->names.end( ) );
+
+	stats.reparsed++;
+	stats.bytes += end - position;
+	return entry;
+}
+
+// skips the failed statement at position up to the first ";" outside of
+// braces or the "}" closing them once past the error, returns where the next
+// token starts
+size_t Document::Recover( size_t position, size_t error ) const
+{
+	lexer::Scanner scanner( text.data( ) + position, text.size( ) - position );
+	int32_t depth = 0;
+	lexer::Token token;
+	do
+	{
+		token = scanner.Next( );
+		if( token.kind == lexer::Kind::LeftBrace )
+			depth++;
+		else if( token.kind == lexer::Kind::RightBrace )
+			depth--;
+	}
+	while( token.kind != lexer::Kind::End && !( token.offset >= error && depth <= 0 &&
+		( token.kind == lexer::Kind::Semicolon || token.kind == lexer::Kind::RightBrace ) ) );
+
+	if( token.kind != lexer::Kind::End )
+		token = scanner.Next( );
+
+	return position + token.offset;
+}
+
+// for a statement parsed after the ones in parsed, which replace entries [index, end);
+// the registered entries are numbered again, in the same order, when there's no room left
+uint64_t Document::GetOrder( size_t index, std::vector<Entry *> &parsed, size_t end )
+{
+	uint64_t low = !parsed.empty( ) ? parsed.back( )->order : index > 0 ? entries[index - 1]->order : 0;
+	uint64_t high = end < entries.size( ) ? entries[end]->order : UINT64_MAX;
+	if( high - low >= 2 )
+		return low + std::min( ( high - low ) / 2, spacing );
+
+	uint64_t order = 0;
+	for( size_t i = 0; i < index; ++i )
+		entries[i]->order = order += spacing;
+
+	for( Entry *entry : parsed )
+		entry->order = order += spacing;
+
+	low = order;
+	order += spacing;
+	for( size_t i = end; i < entries.size( ); ++i )
+		entries[i]->order = order += spacing;
+
+	return low + spacing;
+}
+
+size_t Document::Find( const Entry *entry ) const
+{
+	return std::lower_bound( entries.begin( ), entries.end( ), entry, ByOrder( ) ) - entries.begin( );
+}
+
+void Document::Register( Entry *entry )
+{
+	for( const auto &declaration : entry->declarations )
+		declarations[declaration.first].emplace( entry, declaration.second );
+
+	for( const std::string &name : entry->names )
+		references[name].insert( entry );
+
+	if( entry->statement == nullptr )
+		failed.insert( entry );
+}
+
+void Document::Unregister( Entry *entry )
+{
+	for( const auto &declaration : entry->declarations )
+	{
+		auto it = declarations.find( declaration.first );
+		it->second.erase( entry );
+		if( it->second.empty( ) )
+			declarations.erase( it );
+	}
+
+	for( const std::string &name : entry->names )
+	{
+		auto it = references.find( name );
+		it->second.erase( entry );
+		if( it->second.empty( ) )
+			references.erase( it );
+	}
+
+	failed.erase( entry );
+	pending.erase( entry );
+}
+
+// entries [index, end) are unregistered and replaced by the statements parsed
+// from position on, until one starts where a kept entry does; the entries
+// after them that mention a name declared differently now are queued up
+void Document::Reparse( size_t index, size_t end, size_t position )
+{
+	std::vector<std::pair<std::string, symbol::Type>> before, after;
+	std::vector<Entry *> parsed;
+	std::vector<size_t> starts;
+	for( size_t i = index; i < end; ++i )
+		before.insert( before.end( ), entries[i]->declarations.begin( ), entries[i]->declarations.end( ) );
+
+	for( ;; )
+	{
+		while( end < entries.size( ) && offsets[end] < position )
+		{
+			Unregister( entries[end] );
+			before.insert( before.end( ), entries[end]->declarations.begin( ), entries[end]->declarations.end( ) );
+			end++;
+		}
+
+		if( end < entries.size( ) && offsets[end] == position )
+			break;
+
+		// nothing but whitespace left
+		lexer::Scanner scanner( text.data( ) + position, text.size( ) - position );
+		if( scanner.Next( ).kind == lexer::Kind::End )
+		{
+			for( ; end < entries.size( ); ++end )
+			{
+				Unregister( entries[end] );
+				before.insert( before.end( ), entries[end]->declarations.begin( ), entries[end]->declarations.end( ) );
+			}
+
+			break;
+		}
+
+		uint64_t order = GetOrder( index, parsed, end );
+		starts.push_back( position );
+		Entry *entry = ParseEntry( position, order, position );
+		Register( entry );
+		parsed.push_back( entry );
+		after.insert( after.end( ), entry->declarations.begin( ), entry->declarations.end( ) );
+	}
+
+	for( size_t i = index; i < end; ++i )
+	{
+		delete entries[i]->statement;
+		delete entries[i];
+	}
+
+	entries.erase( entries.begin( ) + index, entries.begin( ) + end );
+	entries.insert( entries.begin( ) + index, parsed.begin( ), parsed.end( ) );
+	offsets.erase( offsets.begin( ) + index, offsets.begin( ) + end );
+	offsets.insert( offsets.begin( ) + index, starts.begin( ), starts.end( ) );
+
+	size_t next = index + parsed.size( );
+	if( before == after || next == entries.size( ) )
+		return;
+
+	before.insert( before.end( ), after.begin( ), after.end( ) );
+	for( const auto &declaration : before )
+	{
+		auto it = references.find( declaration.first );
+		if( it != references.end( ) )
+			pending.insert( it->second.lower_bound( entries[next] ), it->second.end( ) );
+	}
+}
+
+}
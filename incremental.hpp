@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "node.hpp"
+#include "symbol.hpp"
+
+namespace incremental
+{
+
+struct Diagnostic
+{
+	// of the token the error was found at
+	size_t offset;
+	std::string message;
+};
+
+struct Statistics
+{
+	uint64_t edits = 0;
+	// top-level statements parsed again, and because a symbol they use changed
+	uint64_t reparsed = 0;
+	uint64_t rechecked = 0;
+	uint64_t bytes = 0;
+};
+
+// source being edited, kept as its top-level statements (each with its tree,
+// the symbols it declares and the names it mentions) so an edit only relexes
+// and reparses the statements it touches, stopping as soon as a new statement
+// starts where an old one did; the statements after it are only parsed again
+// when the symbols declared by the new ones differ and they mention them. A
+// statement with an error is skipped up to its ";" or closing "}", so one
+// error doesn't hide the rest, the first diagnostic is the error of a full
+// parse with the Pratt parser
+class Document
+{
+public:
+	explicit Document( const std::string &text );
+	~Document( );
+
+	Document( const Document & ) = delete;
+	Document &operator=( const Document & ) = delete;
+
+	// replaces removed bytes at offset with inserted, false when they aren't in the text
+	bool Edit( size_t offset, size_t removed, const std::string &inserted );
+
+	const std::string &GetText( ) const;
+	// in source order, empty when the whole text parses
+	std::vector<Diagnostic> GetDiagnostics( ) const;
+	size_t GetStatementCount( ) const;
+	// nullptr when the statement has an error
+	const node::Statement *GetStatement( size_t index ) const;
+	Statistics GetStatistics( ) const;
+
+private:
+	struct Entry
+	{
+		// orders the entries without depending on their offsets, which move with every edit
+		uint64_t order;
+		node::Statement *statement;
+		std::string error;
+		// from the start of the statement
+		size_t errorOffset;
+		std::vector<std::pair<std::string, symbol::Type>> declarations;
+		std::vector<std::string> names;
+	};
+
+	struct ByOrder
+	{
+		bool operator()( const Entry *a, const Entry *b ) const
+		{
+			return a->order < b->order;
+		}
+	};
+
+	class Scope;
+
+	Entry *ParseEntry( size_t position, uint64_t order, size_t &end );
+	size_t Recover( size_t position, size_t error ) const;
+	uint64_t GetOrder( size_t index, std::vector<Entry *> &parsed, size_t end );
+	size_t Find( const Entry *entry ) const;
+	void Register( Entry *entry );
+	void Unregister( Entry *entry );
+	void Reparse( size_t index, size_t end, size_t position );
+
+	std::string text;
+	// each statement runs up to the first token of the next one, so they cover
+	// the whole text, offsets apart to shift them without touching the entries
+	std::vector<Entry *> entries;
+	std::vector<size_t> offsets;
+	// every declaration of each name, the first one is the one in use
+	std::unordered_map<std::string, std::map<Entry *, symbol::Type, ByOrder>> declarations;
+	std::unordered_map<std::string, std::set<Entry *, ByOrder>> references;
+	std::set<Entry *, ByOrder> failed;
+	// to parse again after the current edit, because a symbol they mention changed
+	std::set<Entry *, ByOrder> pending;
+	Statistics stats;
+};
+
+}
@@ -1,23 +1,80 @@
 #include "instruction.hpp"
 #include "common.hpp"
+#include "simulator.hpp"
+#include "object.hpp"
+#include "image.hpp"
 #include <stdexcept>
-#include <map>
 
 namespace instruction
 {
 
-static std::map<Temporary, std::string> temporary_number = {
-	{ Temporary::Zero, "0" },
-	{ Temporary::One, "1" },
-	{ Temporary::Two, "2" },
-	{ Temporary::Three, "3" },
-	{ Temporary::Four, "4" },
-	{ Temporary::Five, "5" },
-	{ Temporary::Six, "6" },
-	{ Temporary::Seven, "7" },
-	{ Temporary::Eight, "8" },
-	{ Temporary::Nine, "9" }
-};
+// read only, codegen threads print instructions concurrently
+static const char *const temporary_number[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+
+static bool IsValid( Temporary temporary )
+{
+	return temporary >= Temporary::Zero && temporary <= Temporary::Nine;
+}
+
+List::List( ) :
+	labels( 0 )
+{ }
+
+uint32_t List::NewLabel( )
+{
+	return labels++;
+}
+
+uint32_t List::GetLabelCount( ) const
+{
+	return labels;
+}
+
+void List::Append( List &other )
+{
+	for( Base *inst : other )
+		Relabel( inst, labels );
+
+	labels += other.labels;
+	splice( end( ), other );
+	other.labels = 0;
+}
+
+std::string LabelToString( uint32_t label )
+{
+	// identifiers can't contain '$', so these never clash with variables
+	return "$L" + std::to_string( label );
+}
+
+void Relabel( Base *inst, uint32_t offset )
+{
+	switch( inst->GetType( ) )
+	{
+		case Type::Label:
+		{
+			Label *label = static_cast<Label *>( inst );
+			label->SetLabel( label->GetLabel( ) + offset );
+			break;
+		}
+
+		case Type::Jump:
+		{
+			Jump *jump = static_cast<Jump *>( inst );
+			jump->SetLabel( jump->GetLabel( ) + offset );
+			break;
+		}
+
+		case Type::Branch:
+		{
+			Branch *branch = static_cast<Branch *>( inst );
+			branch->SetLabel( branch->GetLabel( ) + offset );
+			break;
+		}
+
+		default:
+			break;
+	}
+}
 
 Variable::Variable( ) :
 	type( Type::None )
@@ -41,6 +98,14 @@ Variable::Variable( const std::string &address ) :
 	value.address = new std::string( address );
 }
 
+Variable::Variable( const Variable &other ) :
+	type( other.type ),
+	value( other.value )
+{
+	if( type == Type::Memory )
+		value.address = new std::string( *other.value.address );
+}
+
 Variable::~Variable( )
 {
 	if( type == Type::Memory && value.address != nullptr )
@@ -50,11 +115,50 @@ Variable::~Variable( )
 	}
 }
 
+Variable &Variable::operator=( const Variable &other )
+{
+	if( this == &other )
+		return *this;
+
+	if( type == Type::Memory )
+		delete value.address;
+
+	type = other.type;
+	value = other.value;
+	if( type == Type::Memory )
+		value.address = new std::string( *other.value.address );
+
+	return *this;
+}
+
 Variable::Type Variable::GetType( ) const
 {
 	return type;
 }
 
+int32_t Variable::GetInteger( ) const
+{
+	return value.integer;
+}
+
+Temporary Variable::GetTemporary( ) const
+{
+	return value.temporary;
+}
+
+const std::string &Variable::GetAddress( ) const
+{
+	return *value.address;
+}
+
+uint32_t Variable::GetMask( ) const
+{
+	if( type != Type::Register || !IsValid( value.temporary ) )
+		return 0;
+
+	return 1 << static_cast<uint32_t>( value.temporary );
+}
+
 std::string Variable::ToString( ) const
 {
 	switch( type )
@@ -63,7 +167,10 @@ std::string Variable::ToString( ) const
 			return std::to_string( value.integer );
 
 		case Type::Register:
-			return "$t" + temporary_number[value.temporary];
+			if( !IsValid( value.temporary ) )
+				return "ERROR";
+
+			return std::string( "$t" ) + temporary_number[static_cast<int32_t>( value.temporary )];
 
 		case Type::Memory:
 			return *value.address;
@@ -77,299 +184,1288 @@ Base::Base( Type type ) :
 	type( type )
 { }
 
+Base::~Base( )
+{ }
+
 Type Base::GetType( ) const
 {
 	return type;
 }
 
-Custom::Custom( const std::string &data ) :
-	data( data )
-{ }
-
-std::string Custom::ToString( ) const
+uint32_t Base::GetReadMask( ) const
 {
-	return data;
+	return AllMask;
 }
 
-Assignment::Assignment( const Variable &left, const Variable &right ) :
-	result( left ),
-	value( right )
-{ }
+uint32_t Base::GetWriteMask( ) const
+{
+	return AllMask;
+}
 
-std::string Assignment::ToString( ) const
+uint32_t Base::GetSize( ) const
 {
-	return "ADDI " + result.ToString( ) + ", " + value.ToString( ) + ", 0\n";
+	return 0;
 }
 
-Constant::Constant( const Variable &value, const Variable &result ) :
-	result( result ),
-	value( value )
+void Base::Execute( simulator::Machine & ) const
 { }
 
-std::string Constant::ToString( ) const
+void Base::Encode( object::Encoder &encoder ) const
 {
-	return "LI " + result.ToString( ) + ", " + value.ToString( ) + "\n";
+	encoder.Unsupported( "instruction " + ToString( ) );
 }
 
-Address::Address( const std::string &label, const Variable &result ) :
-	Base( Type::Address ),
-	result( result ),
-	address( label )
+void Base::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Custom, Variable( ToString( ) ) );
+}
+
+Custom::Custom( const std::string &data ) :
+	data( data )
 { }
 
-std::string Address::ToString( ) const
+std::string Custom::ToString( ) const
 {
-	return "LA " + result.ToString( ) + ", " + address.ToString( ) + "\n";
+	return data;
 }
 
-Load::Load( const Variable &address, const Variable &result ) :
-	result( result ),
-	address( address )
-{ }
+void Custom::Encode( object::Encoder &encoder ) const
+{
+	encoder.Directive( data );
+}
 
-std::string Load::ToString( ) const
+void Custom::Store( image::Writer &writer ) const
 {
-	return "LW " + result.ToString( ) + ", 0(" + address.ToString( ) + ")\n";
+	writer.Add( image::Opcode::Custom, Variable( data ) );
 }
 
-Save::Save( const Variable &value, const Variable &address ) :
-	value( value ),
-	address( address )
+Section::Section( const std::string &name ) :
+	Base( Type::Section ),
+	name( name )
 { }
 
-std::string Save::ToString( ) const
+std::string Section::ToString( ) const
 {
-	return "SW " + value.ToString( ) + ", 0(" + address.ToString( ) + ")\n";
+	return name + "\n";
 }
 
-Label::Label( const std::string &label ) :
-	label( label )
-{ }
+void Section::Encode( object::Encoder &encoder ) const
+{
+	encoder.Section( name );
+}
 
-std::string Label::ToString( ) const
+void Section::Store( image::Writer &writer ) const
 {
-	return label + ":\n";
+	writer.Add( image::Opcode::Section, Variable( name ) );
 }
 
-Jump::Jump( const std::string &label ) :
-	label( label )
-{ }
+const std::string &Section::GetName( ) const
+{
+	return name;
+}
 
-std::string Jump::ToString( ) const
+void Section::SetName( const std::string &name )
 {
-	return "J " + label + "\n";
+	this->name = name;
 }
 
-Branch::Branch( const Variable &left, const Variable &right, const std::string &label ) :
-	left( left ),
-	right( right ),
-	label( label )
+Word::Word( const std::string &label, int32_t value ) :
+	Base( Type::Word ),
+	label( label ),
+	value( value )
 { }
 
-BranchLessThan::BranchLessThan( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
-{ }
+std::string Word::ToString( ) const
+{
+	return label + ": .word " + std::to_string( value ) + "\n";
+}
 
-std::string BranchLessThan::ToString( ) const
+void Word::Encode( object::Encoder &encoder ) const
 {
-	return "BLT " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	encoder.Word( label, value );
 }
 
-BranchLessEqual::BranchLessEqual( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
-{ }
+void Word::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Word, Variable( label ), value );
+}
 
-std::string BranchLessEqual::ToString( ) const
+const std::string &Word::GetLabel( ) const
 {
-	return "BLE " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	return label;
 }
 
-BranchNotEqual::BranchNotEqual( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
+uint32_t Word::GetSize( ) const
+{
+	return 1;
+}
+
+Assignment::Assignment( const Variable &left, const Variable &right ) :
+	result( left ),
+	value( right )
 { }
 
-std::string BranchNotEqual::ToString( ) const
+std::string Assignment::ToString( ) const
 {
-	return "BNE " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	return "ADDI " + result.ToString( ) + ", " + value.ToString( ) + ", 0\n";
 }
 
-BranchEqual::BranchEqual( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
-{ }
+void Assignment::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( value ) );
+}
 
-std::string BranchEqual::ToString( ) const
+void Assignment::Encode( object::Encoder &encoder ) const
 {
-	return "BEQ " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	uint8_t rs = encoder.Register( value );
+	encoder.EmitImmediate( 0x08, rs, encoder.Register( result ), 0 );
 }
 
-BranchGreaterEqual::BranchGreaterEqual( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
-{ }
+void Assignment::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Assignment, result, value );
+}
 
-std::string BranchGreaterEqual::ToString( ) const
+uint32_t Assignment::GetReadMask( ) const
 {
-	return "BGE " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	return value.GetMask( );
 }
 
-BranchGreaterThan::BranchGreaterThan( const Variable &left, const Variable &right, const std::string &label ) :
-	Branch( left, right, label )
-{ }
+uint32_t Assignment::GetWriteMask( ) const
+{
+	return result.GetMask( );
+}
 
-std::string BranchGreaterThan::ToString( ) const
+uint32_t Assignment::GetSize( ) const
 {
-	return "BGT " + left.ToString( ) + ", " + right.ToString( ) + ", " + label + "\n";
+	return 1;
 }
 
-Logic::Logic( const Variable &left, const Variable &right, const Variable &result ) :
+Constant::Constant( const Variable &value, const Variable &result ) :
 	result( result ),
-	left( left ),
-	right( right )
+	value( value )
 { }
 
-LessThan::LessThan( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+std::string Constant::ToString( ) const
+{
+	return "LI " + result.ToString( ) + ", " + value.ToString( ) + "\n";
+}
 
-std::string LessThan::ToString( ) const
+void Constant::Execute( simulator::Machine &machine ) const
 {
-	return "SLT " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+	machine.Write( result, machine.Read( value ) );
 }
 
-LessEqual::LessEqual( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+void Constant::Encode( object::Encoder &encoder ) const
+{
+	encoder.LoadImmediate( encoder.Register( result ), value.GetInteger( ) );
+}
 
-std::string LessEqual::ToString( ) const
+void Constant::Store( image::Writer &writer ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	return "BGT " + left.ToString( ) + ", " + right.ToString( ) + ", LessThan_" + labelnum + "\n" +
-		"ADDI " + result.ToString( ) + ", $zero, 1\n" +
-		"LessThan_" + labelnum + ":\n";
+	writer.Add( image::Opcode::Constant, value, result );
 }
 
-NotEqual::NotEqual( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+uint32_t Constant::GetReadMask( ) const
+{
+	return 0;
+}
 
-std::string NotEqual::ToString( ) const
+uint32_t Constant::GetWriteMask( ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	return "BEQ " + left.ToString( ) + ", " + right.ToString( ) + ", NotEqual_" + labelnum + "\n" +
-		"ADDI " + result.ToString( ) + ", $zero, 1\n" +
-		"NotEqual_" + labelnum + ":\n";
+	return result.GetMask( );
 }
 
-Equal::Equal( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
+uint32_t Constant::GetSize( ) const
+{
+	// LI becomes a single ADDIU or ORI when the value fits in 16 bits
+	int32_t integer = value.GetInteger( );
+	return integer >= -32768 && integer <= 65535 ? 1 : 2;
+}
+
+Address::Address( const std::string &label, const Variable &result ) :
+	Base( Type::Address ),
+	result( result ),
+	address( label )
 { }
 
-std::string Equal::ToString( ) const
+std::string Address::ToString( ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	return "BNE " + left.ToString( ) + ", " + right.ToString( ) + ", Equal_" + labelnum + "\n" +
-		"ADDI " + result.ToString( ) + ", $zero, 1\n" +
-		"Equal_" + labelnum + ":\n";
+	return "LA " + result.ToString( ) + ", " + address.ToString( ) + "\n";
 }
 
-GreaterEqual::GreaterEqual( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+void Address::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( address ) );
+}
 
-std::string GreaterEqual::ToString( ) const
+void Address::Encode( object::Encoder &encoder ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	return "BLT " + left.ToString( ) + ", " + right.ToString( ) + ", GreaterEqual_" + labelnum + "\n" +
-		"ADDI " + result.ToString( ) + ", $zero, 1\n" +
-		"GreaterEqual_" + labelnum + ":\n";
+	encoder.LoadAddress( encoder.Register( result ), address.GetAddress( ) );
 }
 
-GreaterThan::GreaterThan( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+void Address::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Address, address, result );
+}
 
-std::string GreaterThan::ToString( ) const
+const Variable &Address::GetResult( ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	return "BLE " + left.ToString( ) + ", " + right.ToString( ) + ", GreaterThan_" + labelnum + "\n" +
-		"ADDI " + result.ToString( ) + ", $zero, 1\n" +
-		"GreaterThan_" + labelnum + ":\n";
+	return result;
 }
 
-And::And( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+const Variable &Address::GetAddress( ) const
+{
+	return address;
+}
 
-std::string And::ToString( ) const
+uint32_t Address::GetReadMask( ) const
 {
-	return "AND " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+	return 0;
 }
 
-Or::Or( const Variable &left, const Variable &right, const Variable &result ) :
-	Logic( left, right, result )
-{ }
+uint32_t Address::GetWriteMask( ) const
+{
+	return result.GetMask( );
+}
 
-std::string Or::ToString( ) const
+uint32_t Address::GetSize( ) const
 {
-	return "OR " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+	return 2;
 }
 
-Arithmetic::Arithmetic( const Variable &left, const Variable &right, const Variable &result ) :
+Load::Load( const Variable &address, const Variable &result ) :
+	Base( Type::Load ),
 	result( result ),
-	left( left ),
-	right( right )
+	address( address )
 { }
 
-Add::Add( const Variable &left, const Variable &right, const Variable &result ) :
-	Arithmetic( left, right, result )
-{ }
+std::string Load::ToString( ) const
+{
+	if( address.GetType( ) == Variable::Type::Memory )
+		return "LW " + result.ToString( ) + ", %gp_rel(" + address.ToString( ) + ")($gp)\n";
 
-std::string Add::ToString( ) const
+	return "LW " + result.ToString( ) + ", 0(" + address.ToString( ) + ")\n";
+}
+
+void Load::Execute( simulator::Machine &machine ) const
 {
-	return "ADD " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+	machine.Write( result, machine.Load( machine.Read( address ) ) );
 }
 
-Subtract::Subtract( const Variable &left, const Variable &right, const Variable &result ) :
-	Arithmetic( left, right, result )
-{ }
+void Load::Encode( object::Encoder &encoder ) const
+{
+	encoder.Memory( 0x23, encoder.Register( result ), address );
+}
 
-std::string Subtract::ToString( ) const
+void Load::Store( image::Writer &writer ) const
 {
-	return "SUB " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+	writer.Add( image::Opcode::Load, address, result );
 }
 
-Multiply::Multiply( const Variable &left, const Variable &right, const Variable &result ) :
-	Arithmetic( left, right, result )
-{ }
+const Variable &Load::GetResult( ) const
+{
+	return result;
+}
 
-std::string Multiply::ToString( ) const
+const Variable &Load::GetAddress( ) const
 {
-	return "MULT " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
-		"MFLO " + result.ToString( ) + "\n";
+	return address;
 }
 
-Divide::Divide( const Variable &left, const Variable &right, const Variable &result ) :
-	Arithmetic( left, right, result )
-{ }
+uint32_t Load::GetReadMask( ) const
+{
+	return address.GetMask( ) | MemoryMask;
+}
 
-std::string Divide::ToString( ) const
+uint32_t Load::GetWriteMask( ) const
 {
-	return "DIV " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
-		"MFLO " + result.ToString( ) + "\n";
+	return result.GetMask( );
 }
 
-Modulo::Modulo( const Variable &left, const Variable &right, const Variable &result ) :
-	Arithmetic( left, right, result )
+uint32_t Load::GetSize( ) const
+{
+	return 1;
+}
+
+Save::Save( const Variable &value, const Variable &address ) :
+	Base( Type::Save ),
+	value( value ),
+	address( address )
 { }
 
-std::string Modulo::ToString( ) const
+std::string Save::ToString( ) const
+{
+	if( address.GetType( ) == Variable::Type::Memory )
+		return "SW " + value.ToString( ) + ", %gp_rel(" + address.ToString( ) + ")($gp)\n";
+
+	return "SW " + value.ToString( ) + ", 0(" + address.ToString( ) + ")\n";
+}
+
+void Save::Execute( simulator::Machine &machine ) const
+{
+	machine.Store( machine.Read( address ), machine.Read( value ) );
+}
+
+void Save::Encode( object::Encoder &encoder ) const
+{
+	encoder.Memory( 0x2B, encoder.Register( value ), address );
+}
+
+void Save::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Save, value, address );
+}
+
+const Variable &Save::GetValue( ) const
+{
+	return value;
+}
+
+const Variable &Save::GetAddress( ) const
+{
+	return address;
+}
+
+uint32_t Save::GetReadMask( ) const
+{
+	return value.GetMask( ) | address.GetMask( );
+}
+
+uint32_t Save::GetWriteMask( ) const
+{
+	return MemoryMask;
+}
+
+uint32_t Save::GetSize( ) const
+{
+	return 1;
+}
+
+Push::Push( const Variable &value ) :
+	value( value )
+{ }
+
+std::string Push::ToString( ) const
+{
+	return "ADDIU $sp, $sp, -4\nSW " + value.ToString( ) + ", 0($sp)\n";
+}
+
+void Push::Execute( simulator::Machine &machine ) const
+{
+	machine.Push( machine.Read( value ) );
+}
+
+void Push::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rt = encoder.Register( value );
+	encoder.AdjustStack( -4 );
+	encoder.EmitImmediate( 0x2B, object::Encoder::StackPointer, rt, 0 );
+}
+
+void Push::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Push, value );
+}
+
+uint32_t Push::GetReadMask( ) const
+{
+	return value.GetMask( ) | StackMask;
+}
+
+uint32_t Push::GetWriteMask( ) const
+{
+	return MemoryMask | StackMask;
+}
+
+uint32_t Push::GetSize( ) const
+{
+	return 2;
+}
+
+Pop::Pop( const Variable &result ) :
+	result( result )
+{ }
+
+std::string Pop::ToString( ) const
+{
+	return "LW " + result.ToString( ) + ", 0($sp)\nADDIU $sp, $sp, 4\n";
+}
+
+void Pop::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Pop( ) );
+}
+
+void Pop::Encode( object::Encoder &encoder ) const
+{
+	encoder.EmitImmediate( 0x23, object::Encoder::StackPointer, encoder.Register( result ), 0 );
+	encoder.AdjustStack( 4 );
+}
+
+void Pop::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Pop, result );
+}
+
+uint32_t Pop::GetReadMask( ) const
+{
+	return MemoryMask | StackMask;
+}
+
+uint32_t Pop::GetWriteMask( ) const
+{
+	return result.GetMask( ) | StackMask;
+}
+
+uint32_t Pop::GetSize( ) const
+{
+	return 2;
+}
+
+std::string Nop::ToString( ) const
+{
+	return "NOP\n";
+}
+
+void Nop::Encode( object::Encoder &encoder ) const
+{
+	encoder.Emit( 0 );
+}
+
+void Nop::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Nop );
+}
+
+uint32_t Nop::GetReadMask( ) const
+{
+	return 0;
+}
+
+uint32_t Nop::GetWriteMask( ) const
+{
+	return 0;
+}
+
+uint32_t Nop::GetSize( ) const
+{
+	return 1;
+}
+
+Label::Label( uint32_t label ) :
+	Base( Type::Label ),
+	label( label )
+{ }
+
+std::string Label::ToString( ) const
+{
+	return LabelToString( label ) + ":\n";
+}
+
+void Label::Encode( object::Encoder &encoder ) const
+{
+	encoder.Label( label );
+}
+
+void Label::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Label, static_cast<int32_t>( label ) );
+}
+
+uint32_t Label::GetLabel( ) const
+{
+	return label;
+}
+
+void Label::SetLabel( uint32_t label )
+{
+	this->label = label;
+}
+
+uint32_t Label::GetReadMask( ) const
+{
+	return 0;
+}
+
+uint32_t Label::GetWriteMask( ) const
+{
+	return 0;
+}
+
+uint32_t Label::GetSize( ) const
+{
+	return 0;
+}
+
+Jump::Jump( uint32_t label ) :
+	Base( Type::Jump ),
+	label( label )
+{ }
+
+std::string Jump::ToString( ) const
+{
+	return "J " + LabelToString( label ) + "\n";
+}
+
+void Jump::Execute( simulator::Machine &machine ) const
+{
+	machine.Jump( label );
+}
+
+void Jump::Encode( object::Encoder &encoder ) const
+{
+	encoder.Jump( label );
+}
+
+void Jump::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Jump, static_cast<int32_t>( label ) );
+}
+
+uint32_t Jump::GetLabel( ) const
+{
+	return label;
+}
+
+void Jump::SetLabel( uint32_t label )
+{
+	this->label = label;
+}
+
+uint32_t Jump::GetReadMask( ) const
+{
+	return 0;
+}
+
+uint32_t Jump::GetWriteMask( ) const
+{
+	return 0;
+}
+
+uint32_t Jump::GetSize( ) const
+{
+	return 1;
+}
+
+Branch::Branch( const Variable &left, const Variable &right, uint32_t label ) :
+	Base( Type::Branch ),
+	left( left ),
+	right( right ),
+	label( label )
+{ }
+
+uint32_t Branch::GetLabel( ) const
+{
+	return label;
+}
+
+void Branch::SetLabel( uint32_t label )
+{
+	this->label = label;
+}
+
+uint32_t Branch::GetReadMask( ) const
+{
+	return left.GetMask( ) | right.GetMask( );
+}
+
+uint32_t Branch::GetWriteMask( ) const
+{
+	return 0;
+}
+
+uint32_t Branch::GetSize( ) const
+{
+	// relational branches are a SLT into $at followed by BNE or BEQ
+	return 2;
+}
+
+BranchLessThan::BranchLessThan( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchLessThan::ToString( ) const
+{
+	return "BLT " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchLessThan::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) < machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchLessThan::Encode( object::Encoder &encoder ) const
+{
+	// SLT into $at and a branch on it, the assembler's expansion
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x2A, rs, rt, object::Encoder::AssemblerTemporary );
+	encoder.Branch( 0x05, object::Encoder::AssemblerTemporary, object::Encoder::Zero, label );
+}
+
+void BranchLessThan::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchLessThan, left, right, static_cast<int32_t>( label ) );
+}
+
+BranchLessEqual::BranchLessEqual( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchLessEqual::ToString( ) const
+{
+	return "BLE " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchLessEqual::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) <= machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchLessEqual::Encode( object::Encoder &encoder ) const
+{
+	// SLT into $at and a branch on it, the assembler's expansion
+	uint8_t rs = encoder.Register( right );
+	uint8_t rt = encoder.Register( left );
+	encoder.EmitRegister( 0x2A, rs, rt, object::Encoder::AssemblerTemporary );
+	encoder.Branch( 0x04, object::Encoder::AssemblerTemporary, object::Encoder::Zero, label );
+}
+
+void BranchLessEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchLessEqual, left, right, static_cast<int32_t>( label ) );
+}
+
+BranchNotEqual::BranchNotEqual( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchNotEqual::ToString( ) const
+{
+	return "BNE " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchNotEqual::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) != machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchNotEqual::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	encoder.Branch( 0x05, rs, encoder.Register( right ), label );
+}
+
+void BranchNotEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchNotEqual, left, right, static_cast<int32_t>( label ) );
+}
+
+uint32_t BranchNotEqual::GetSize( ) const
+{
+	// comparing against anything other than a register or zero needs a LI into $at
+	if( right.GetType( ) == Variable::Type::Constant && right.GetInteger( ) != 0 )
+		return 2;
+
+	return 1;
+}
+
+BranchEqual::BranchEqual( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchEqual::ToString( ) const
+{
+	return "BEQ " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchEqual::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) == machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchEqual::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	encoder.Branch( 0x04, rs, encoder.Register( right ), label );
+}
+
+void BranchEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchEqual, left, right, static_cast<int32_t>( label ) );
+}
+
+uint32_t BranchEqual::GetSize( ) const
+{
+	// comparing against anything other than a register or zero needs a LI into $at
+	if( right.GetType( ) == Variable::Type::Constant && right.GetInteger( ) != 0 )
+		return 2;
+
+	return 1;
+}
+
+BranchGreaterEqual::BranchGreaterEqual( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchGreaterEqual::ToString( ) const
+{
+	return "BGE " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchGreaterEqual::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) >= machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchGreaterEqual::Encode( object::Encoder &encoder ) const
+{
+	// SLT into $at and a branch on it, the assembler's expansion
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x2A, rs, rt, object::Encoder::AssemblerTemporary );
+	encoder.Branch( 0x04, object::Encoder::AssemblerTemporary, object::Encoder::Zero, label );
+}
+
+void BranchGreaterEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchGreaterEqual, left, right, static_cast<int32_t>( label ) );
+}
+
+BranchGreaterThan::BranchGreaterThan( const Variable &left, const Variable &right, uint32_t label ) :
+	Branch( left, right, label )
+{ }
+
+std::string BranchGreaterThan::ToString( ) const
+{
+	return "BGT " + left.ToString( ) + ", " + right.ToString( ) + ", " + LabelToString( label ) + "\n";
+}
+
+void BranchGreaterThan::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( left ) > machine.Read( right ) )
+		machine.Jump( label );
+}
+
+void BranchGreaterThan::Encode( object::Encoder &encoder ) const
+{
+	// SLT into $at and a branch on it, the assembler's expansion
+	uint8_t rs = encoder.Register( right );
+	uint8_t rt = encoder.Register( left );
+	encoder.EmitRegister( 0x2A, rs, rt, object::Encoder::AssemblerTemporary );
+	encoder.Branch( 0x05, object::Encoder::AssemblerTemporary, object::Encoder::Zero, label );
+}
+
+void BranchGreaterThan::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::BranchGreaterThan, left, right, static_cast<int32_t>( label ) );
+}
+
+Logic::Logic( const Variable &left, const Variable &right, const Variable &result ) :
+	result( result ),
+	left( left ),
+	right( right )
+{ }
+
+uint32_t Logic::GetReadMask( ) const
+{
+	return left.GetMask( ) | right.GetMask( );
+}
+
+uint32_t Logic::GetWriteMask( ) const
+{
+	return result.GetMask( );
+}
+
+uint32_t Logic::GetSize( ) const
+{
+	return 1;
+}
+
+LessThan::LessThan( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string LessThan::ToString( ) const
+{
+	return "SLT " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+}
+
+void LessThan::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) < machine.Read( right ) ? 1 : 0 );
+}
+
+void LessThan::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x2A, rs, rt, rd );
+}
+
+void LessThan::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::LessThan, left, right, result );
+}
+
+LessEqual::LessEqual( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string LessEqual::ToString( ) const
+{
+	return "SLT " + result.ToString( ) + ", " + right.ToString( ) + ", " + left.ToString( ) + "\n" +
+		"XORI " + result.ToString( ) + ", " + result.ToString( ) + ", 1\n";
+}
+
+void LessEqual::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) <= machine.Read( right ) ? 1 : 0 );
+}
+
+void LessEqual::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( right );
+	uint8_t rt = encoder.Register( left );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x2A, rs, rt, rd );
+	encoder.EmitImmediate( 0x0E, rd, rd, 1 );
+}
+
+void LessEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::LessEqual, left, right, result );
+}
+
+uint32_t LessEqual::GetSize( ) const
+{
+	return 2;
+}
+
+NotEqual::NotEqual( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string NotEqual::ToString( ) const
+{
+	return "XOR " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
+		"SLTU " + result.ToString( ) + ", $zero, " + result.ToString( ) + "\n";
+}
+
+void NotEqual::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) != machine.Read( right ) ? 1 : 0 );
+}
+
+void NotEqual::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x26, rs, rt, rd );
+	encoder.EmitRegister( 0x2B, object::Encoder::Zero, rd, rd );
+}
+
+void NotEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::NotEqual, left, right, result );
+}
+
+uint32_t NotEqual::GetSize( ) const
+{
+	return 2;
+}
+
+Equal::Equal( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string Equal::ToString( ) const
+{
+	return "XOR " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
+		"SLTIU " + result.ToString( ) + ", " + result.ToString( ) + ", 1\n";
+}
+
+void Equal::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) == machine.Read( right ) ? 1 : 0 );
+}
+
+void Equal::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x26, rs, rt, rd );
+	encoder.EmitImmediate( 0x0B, rd, rd, 1 );
+}
+
+void Equal::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Equal, left, right, result );
+}
+
+uint32_t Equal::GetSize( ) const
+{
+	return 2;
+}
+
+GreaterEqual::GreaterEqual( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string GreaterEqual::ToString( ) const
+{
+	return "SLT " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
+		"XORI " + result.ToString( ) + ", " + result.ToString( ) + ", 1\n";
+}
+
+void GreaterEqual::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) >= machine.Read( right ) ? 1 : 0 );
+}
+
+void GreaterEqual::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x2A, rs, rt, rd );
+	encoder.EmitImmediate( 0x0E, rd, rd, 1 );
+}
+
+void GreaterEqual::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::GreaterEqual, left, right, result );
+}
+
+uint32_t GreaterEqual::GetSize( ) const
+{
+	return 2;
+}
+
+GreaterThan::GreaterThan( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string GreaterThan::ToString( ) const
+{
+	return "SLT " + result.ToString( ) + ", " + right.ToString( ) + ", " + left.ToString( ) + "\n";
+}
+
+void GreaterThan::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) > machine.Read( right ) ? 1 : 0 );
+}
+
+void GreaterThan::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( right );
+	uint8_t rt = encoder.Register( left );
+	uint8_t rd = encoder.Register( result );
+	encoder.EmitRegister( 0x2A, rs, rt, rd );
+}
+
+void GreaterThan::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::GreaterThan, left, right, result );
+}
+
+And::And( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string And::ToString( ) const
+{
+	return "AND " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+}
+
+void And::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) & machine.Read( right ) );
+}
+
+void And::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x24, rs, rt, encoder.Register( result ) );
+}
+
+void And::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::And, left, right, result );
+}
+
+Or::Or( const Variable &left, const Variable &right, const Variable &result ) :
+	Logic( left, right, result )
+{ }
+
+std::string Or::ToString( ) const
+{
+	return "OR " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+}
+
+void Or::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, machine.Read( left ) | machine.Read( right ) );
+}
+
+void Or::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x25, rs, rt, encoder.Register( result ) );
+}
+
+void Or::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Or, left, right, result );
+}
+
+MoveIfZero::MoveIfZero( const Variable &value, const Variable &condition, const Variable &result ) :
+	result( result ),
+	value( value ),
+	condition( condition )
+{ }
+
+std::string MoveIfZero::ToString( ) const
+{
+	return "MOVZ " + result.ToString( ) + ", " + value.ToString( ) + ", " + condition.ToString( ) + "\n";
+}
+
+void MoveIfZero::Execute( simulator::Machine &machine ) const
+{
+	if( machine.Read( condition ) == 0 )
+		machine.Write( result, machine.Read( value ) );
+}
+
+void MoveIfZero::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( value );
+	uint8_t rt = encoder.Register( condition );
+	encoder.EmitRegister( 0x0A, rs, rt, encoder.Register( result ) );
+}
+
+void MoveIfZero::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::MoveIfZero, value, condition, result );
+}
+
+uint32_t MoveIfZero::GetReadMask( ) const
+{
+	return value.GetMask( ) | condition.GetMask( ) | result.GetMask( );
+}
+
+uint32_t MoveIfZero::GetWriteMask( ) const
+{
+	return result.GetMask( );
+}
+
+uint32_t MoveIfZero::GetSize( ) const
+{
+	return 1;
+}
+
+Arithmetic::Arithmetic( const Variable &left, const Variable &right, const Variable &result, Type type ) :
+	Base( type ),
+	result( result ),
+	left( left ),
+	right( right )
+{ }
+
+uint32_t Arithmetic::GetReadMask( ) const
+{
+	return left.GetMask( ) | right.GetMask( );
+}
+
+uint32_t Arithmetic::GetWriteMask( ) const
+{
+	return result.GetMask( );
+}
+
+uint32_t Arithmetic::GetSize( ) const
+{
+	return 1;
+}
+
+Add::Add( const Variable &left, const Variable &right, const Variable &result ) :
+	Arithmetic( left, right, result )
+{ }
+
+std::string Add::ToString( ) const
+{
+	return "ADD " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+}
+
+void Add::Execute( simulator::Machine &machine ) const
+{
+	// wraps around instead of trapping on overflow like ADD would
+	machine.Write( result, static_cast<int32_t>( static_cast<uint32_t>( machine.Read( left ) ) + static_cast<uint32_t>( machine.Read( right ) ) ) );
+}
+
+void Add::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x20, rs, rt, encoder.Register( result ) );
+}
+
+void Add::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Add, left, right, result );
+}
+
+Subtract::Subtract( const Variable &left, const Variable &right, const Variable &result ) :
+	Arithmetic( left, right, result )
+{ }
+
+std::string Subtract::ToString( ) const
+{
+	return "SUB " + result.ToString( ) + ", " + left.ToString( ) + ", " + right.ToString( ) + "\n";
+}
+
+void Subtract::Execute( simulator::Machine &machine ) const
+{
+	machine.Write( result, static_cast<int32_t>( static_cast<uint32_t>( machine.Read( left ) ) - static_cast<uint32_t>( machine.Read( right ) ) ) );
+}
+
+void Subtract::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x22, rs, rt, encoder.Register( result ) );
+}
+
+void Subtract::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Subtract, left, right, result );
+}
+
+Multiply::Multiply( const Variable &left, const Variable &right, const Variable &result ) :
+	Arithmetic( left, right, result, Type::Multiply )
+{ }
+
+std::string Multiply::ToString( ) const
+{
+	return "MULT " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
+		"MFLO " + result.ToString( ) + "\n";
+}
+
+void Multiply::Execute( simulator::Machine &machine ) const
+{
+	int64_t product = static_cast<int64_t>( machine.Read( left ) ) * machine.Read( right );
+	machine.SetHiLo( static_cast<int32_t>( product >> 32 ), static_cast<int32_t>( product ) );
+	machine.Write( result, machine.GetLo( ) );
+}
+
+void Multiply::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x18, rs, rt, object::Encoder::Zero );
+	encoder.EmitRegister( 0x12, object::Encoder::Zero, object::Encoder::Zero, encoder.Register( result ) );
+}
+
+void Multiply::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Multiply, left, right, result );
+}
+
+uint32_t Multiply::GetWriteMask( ) const
+{
+	return result.GetMask( ) | HiLoMask;
+}
+
+uint32_t Multiply::GetSize( ) const
+{
+	return 2;
+}
+
+Divide::Divide( const Variable &left, const Variable &right, const Variable &result ) :
+	Arithmetic( left, right, result, Type::Divide )
+{ }
+
+std::string Divide::ToString( ) const
+{
+	return "DIV " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
+		"MFLO " + result.ToString( ) + "\n";
+}
+
+void Divide::Execute( simulator::Machine &machine ) const
+{
+	machine.Divide( machine.Read( left ), machine.Read( right ) );
+	machine.Write( result, machine.GetLo( ) );
+}
+
+void Divide::Encode( object::Encoder &encoder ) const
+{
+	// plain DIV, without the divide by zero trap the assembler's macro adds
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x1A, rs, rt, object::Encoder::Zero );
+	encoder.EmitRegister( 0x12, object::Encoder::Zero, object::Encoder::Zero, encoder.Register( result ) );
+}
+
+void Divide::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Divide, left, right, result );
+}
+
+uint32_t Divide::GetWriteMask( ) const
+{
+	return result.GetMask( ) | HiLoMask;
+}
+
+uint32_t Divide::GetSize( ) const
+{
+	return 2;
+}
+
+Modulo::Modulo( const Variable &left, const Variable &right, const Variable &result ) :
+	Arithmetic( left, right, result, Type::Divide )
+{ }
+
+std::string Modulo::ToString( ) const
 {
 	return "DIV " + left.ToString( ) + ", " + right.ToString( ) + "\n" +
 		"MFHI " + result.ToString( ) + "\n";
 }
 
+void Modulo::Execute( simulator::Machine &machine ) const
+{
+	machine.Divide( machine.Read( left ), machine.Read( right ) );
+	machine.Write( result, machine.GetHi( ) );
+}
+
+void Modulo::Encode( object::Encoder &encoder ) const
+{
+	uint8_t rs = encoder.Register( left );
+	uint8_t rt = encoder.Register( right );
+	encoder.EmitRegister( 0x1A, rs, rt, object::Encoder::Zero );
+	encoder.EmitRegister( 0x10, object::Encoder::Zero, object::Encoder::Zero, encoder.Register( result ) );
+}
+
+void Modulo::Store( image::Writer &writer ) const
+{
+	writer.Add( image::Opcode::Modulo, left, right, result );
+}
+
+uint32_t Modulo::GetWriteMask( ) const
+{
+	return result.GetMask( ) | HiLoMask;
+}
+
+uint32_t Modulo::GetSize( ) const
+{
+	return 2;
+}
+
 }
@@ -4,15 +4,64 @@
 #include <string>
 #include <list>
 
+namespace simulator
+{
+
+class Machine;
+
+}
+
+namespace object
+{
+
+class Encoder;
+
+}
+
+namespace image
+{
+
+class Writer;
+
+}
+
 namespace instruction
 {
 
-typedef std::list<class Base *> List;
+class Base;
+
+// instructions of a program, labels are numeric ids handed out by the list
+class List : public std::list<Base *>
+{
+public:
+	List( );
+
+	uint32_t NewLabel( );
+	uint32_t GetLabelCount( ) const;
+	// moves the instructions of other to the end, renumbering its labels after ours
+	void Append( List &other );
+
+private:
+	uint32_t labels;
+};
+
+std::string LabelToString( uint32_t label );
+// moves the label of a Label, Jump or Branch by offset, others are left alone
+void Relabel( Base *inst, uint32_t offset );
 
 enum class Type
 {
 	Unknown = -1,
-	Address
+	Address,
+	Label,
+	Jump,
+	Branch,
+	Load,
+	Save,
+	Multiply,
+	Divide,
+	Section,
+	Word
 };
 
 enum class Temporary
@@ -30,6 +79,14 @@ enum class Temporary
 	Nine
 };
 
+// resources read or written by an instruction, as returned by GetReadMask and
+// GetWriteMask, temporaries use the bit ( 1 << Temporary )
+const uint32_t HiLoMask = 1 << 10;
+const uint32_t MemoryMask = 1 << 11;
+// $sp, moved by Push and Pop
+const uint32_t StackMask = 1 << 12;
+const uint32_t AllMask = ~0u;
+
 class Variable
 {
 public:
@@ -45,9 +102,16 @@ public:
 	Variable( int32_t integer );
 	Variable( Temporary temporary );
 	Variable( const std::string &address );
+	Variable( const Variable &other );
 	~Variable( );
 
+	Variable &operator=( const Variable &other );
+
 	Type GetType( ) const;
+	int32_t GetInteger( ) const;
+	Temporary GetTemporary( ) const;
+	const std::string &GetAddress( ) const;
+	uint32_t GetMask( ) const;
 
 	std::string ToString( ) const;
 
@@ -65,10 +129,23 @@ class Base
 {
 public:
 	Base( Type type = Type::Unknown );
+	virtual ~Base( );
 
 	virtual std::string ToString( ) const = 0;
 	virtual Type GetType( ) const;
 
+	// unknown instructions read and write everything and have no known size
+	virtual uint32_t GetReadMask( ) const;
+	virtual uint32_t GetWriteMask( ) const;
+	// number of machine words the instruction assembles to
+	virtual uint32_t GetSize( ) const;
+	// runs the instruction on the simulator, does nothing by default
+	virtual void Execute( simulator::Machine &machine ) const;
+	// emits the machine code, unknown instructions are reported as unsupported
+	virtual void Encode( object::Encoder &encoder ) const;
+	// adds the record of the instruction, others are stored as their text
+	virtual void Store( image::Writer &writer ) const;
+
 private:
 	Type type;
 };
@@ -79,17 +156,56 @@ public:
 	Custom( const std::string &data );
 
 	std::string ToString( ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 
 private:
 	std::string data;
 };
 
+class Section : public Base
+{
+public:
+	Section( const std::string &name );
+
+	std::string ToString( ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	const std::string &GetName( ) const;
+	void SetName( const std::string &name );
+
+private:
+	std::string name;
+};
+
+class Word : public Base
+{
+public:
+	Word( const std::string &label, int32_t value = 0 );
+
+	std::string ToString( ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	const std::string &GetLabel( ) const;
+	uint32_t GetSize( ) const;
+
+private:
+	std::string label;
+	int32_t value;
+};
+
 class Assignment : public Base
 {
 public:
 	Assignment( const Variable &left, const Variable &right );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
 	Variable result;
@@ -102,6 +218,12 @@ public:
 	Constant( const Variable &value, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
 	Variable result;
@@ -114,6 +236,14 @@ public:
 	Address( const std::string &label, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	const Variable &GetResult( ) const;
+	const Variable &GetAddress( ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
 	Variable result;
@@ -126,6 +256,14 @@ public:
 	Load( const Variable &address, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	const Variable &GetResult( ) const;
+	const Variable &GetAddress( ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
 	Variable result;
@@ -138,94 +276,197 @@ public:
 	Save( const Variable &value, const Variable &address );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	const Variable &GetValue( ) const;
+	const Variable &GetAddress( ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
 	Variable value;
 	Variable address;
 };
 
+// spills a temporary to the stack when an expression needs more than there
+// are: "ADDIU $sp, $sp, -4" and "SW value, 0($sp)"
+class Push : public Base
+{
+public:
+	Push( const Variable &value );
+
+	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
+private:
+	Variable value;
+};
+
+// reloads the last pushed value: "LW result, 0($sp)" and "ADDIU $sp, $sp, 4"
+class Pop : public Base
+{
+public:
+	Pop( const Variable &result );
+
+	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
+private:
+	Variable result;
+};
+
+class Nop : public Base
+{
+public:
+	std::string ToString( ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+};
+
 class Label : public Base
 {
 public:
-	Label( const std::string &label );
+	Label( uint32_t label );
 
 	std::string ToString( ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetLabel( ) const;
+	void SetLabel( uint32_t label );
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
-	std::string label;
+	uint32_t label;
 };
 
 class Jump : public Base
 {
 public:
-	Jump( const std::string &label );
+	Jump( uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetLabel( ) const;
+	void SetLabel( uint32_t label );
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 
 private:
-	std::string label;
+	uint32_t label;
 };
 
 class Branch : public Base
 {
+public:
+	uint32_t GetLabel( ) const;
+	void SetLabel( uint32_t label );
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
 protected:
-	Branch( const Variable &left, const Variable &right, const std::string &label );
+	Branch( const Variable &left, const Variable &right, uint32_t label );
 
 	Variable left;
 	Variable right;
-	std::string label;
+	uint32_t label;
 };
 
 class BranchLessThan : public Branch
 {
 public:
-	BranchLessThan( const Variable &left, const Variable &right, const std::string &label );
+	BranchLessThan( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class BranchLessEqual : public Branch
 {
 public:
-	BranchLessEqual( const Variable &left, const Variable &right, const std::string &label );
+	BranchLessEqual( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class BranchNotEqual : public Branch
 {
 public:
-	BranchNotEqual( const Variable &left, const Variable &right, const std::string &label );
+	BranchNotEqual( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class BranchEqual : public Branch
 {
 public:
-	BranchEqual( const Variable &left, const Variable &right, const std::string &label );
+	BranchEqual( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class BranchGreaterEqual : public Branch
 {
 public:
-	BranchGreaterEqual( const Variable &left, const Variable &right, const std::string &label );
+	BranchGreaterEqual( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class BranchGreaterThan : public Branch
 {
 public:
-	BranchGreaterThan( const Variable &left, const Variable &right, const std::string &label );
+	BranchGreaterThan( const Variable &left, const Variable &right, uint32_t label );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class Logic : public Base
 {
+public:
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
 protected:
 	Logic( const Variable &left, const Variable &right, const Variable &result );
 
@@ -240,6 +481,9 @@ public:
 	LessThan( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class LessEqual : public Logic
@@ -248,6 +492,10 @@ public:
 	LessEqual( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class NotEqual : public Logic
@@ -256,6 +504,10 @@ public:
 	NotEqual( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class Equal : public Logic
@@ -264,6 +516,10 @@ public:
 	Equal( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class GreaterEqual : public Logic
@@ -272,6 +528,10 @@ public:
 	GreaterEqual( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetSize( ) const;
 };
 
 class GreaterThan : public Logic
@@ -280,6 +540,9 @@ public:
 	GreaterThan( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class And : public Logic
@@ -288,6 +551,9 @@ public:
 	And( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class Or : public Logic
@@ -296,12 +562,39 @@ public:
 	Or( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+};
+
+class MoveIfZero : public Base
+{
+public:
+	MoveIfZero( const Variable &value, const Variable &condition, const Variable &result );
+
+	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
+private:
+	Variable result;
+	Variable value;
+	Variable condition;
 };
 
 class Arithmetic : public Base
 {
+public:
+	uint32_t GetReadMask( ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
+
 protected:
-	Arithmetic( const Variable &left, const Variable &right, const Variable &result );
+	Arithmetic( const Variable &left, const Variable &right, const Variable &result, Type type = Type::Unknown );
 
 	Variable result;
 	Variable left;
@@ -314,6 +607,9 @@ public:
 	Add( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class Subtract : public Arithmetic
@@ -322,6 +618,9 @@ public:
 	Subtract( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
 };
 
 class Multiply : public Arithmetic
@@ -330,6 +629,11 @@ public:
 	Multiply( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 };
 
 class Divide : public Arithmetic
@@ -338,6 +642,11 @@ public:
 	Divide( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 };
 
 class Modulo : public Arithmetic
@@ -346,6 +655,11 @@ public:
 	Modulo( const Variable &left, const Variable &right, const Variable &result );
 
 	std::string ToString( ) const;
+	void Execute( simulator::Machine &machine ) const;
+	void Encode( object::Encoder &encoder ) const;
+	void Store( image::Writer &writer ) const;
+	uint32_t GetWriteMask( ) const;
+	uint32_t GetSize( ) const;
 };
 
 }
@@ -0,0 +1,765 @@
+#include "jit.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#if defined __x86_64__ && defined __linux__
+#include <sys/mman.h>
+#endif
+
+namespace jit
+{
+
+enum Register : uint8_t
+{
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// condition codes as encoded in Jcc and SETcc
+enum Condition : uint8_t
+{
+	Equal = 0x4,
+	NotEqual = 0x5,
+	Less = 0xC,
+	GreaterEqual = 0xD,
+	LessEqual = 0xE,
+	Greater = 0xF
+};
+
+// RDI holds the frame, RAX, RCX and RDX are scratch, everything else can hold
+// a variable since the generated code never calls anything
+static const Register variable_registers[] = { RBX, R12, R13, R14, R15, RBP, RSI, R8, R9, R10, R11 };
+
+static bool IsCalleeSaved( Register reg )
+{
+	return reg == RBX || reg == RBP || reg >= R12;
+}
+
+// a 32-bit register or a frame slot
+struct Operand
+{
+	bool memory;
+	Register reg;
+	int32_t displacement;
+
+	static Operand Direct( Register reg )
+	{
+		return { false, reg, 0 };
+	}
+
+	static Operand Slot( int32_t slot )
+	{
+		return { true, RDI, slot * 4 };
+	}
+};
+
+class Assembler
+{
+public:
+	std::vector<uint8_t> code;
+
+	void Byte( uint8_t byte )
+	{
+		code.push_back( byte );
+	}
+
+	void Int32( int32_t value )
+	{
+		for( int32_t i = 0; i < 4; ++i )
+			Byte( static_cast<uint8_t>( static_cast<uint32_t>( value ) >> ( i * 8 ) ) );
+	}
+
+	// REX prefix, opcode and ModRM (+ disp32 for frame slots)
+	void Instruction( std::initializer_list<uint8_t> opcode, uint8_t reg, const Operand &rm, bool wide = false )
+	{
+		uint8_t rex = 0x40 | ( wide ? 0x08 : 0 ) | ( ( reg & 8 ) != 0 ? 0x04 : 0 ) | ( !rm.memory && ( rm.reg & 8 ) != 0 ? 0x01 : 0 );
+		if( rex != 0x40 )
+			Byte( rex );
+
+		for( uint8_t byte : opcode )
+			Byte( byte );
+
+		if( rm.memory )
+		{
+			Byte( 0x80 | ( ( reg & 7 ) << 3 ) | ( rm.reg & 7 ) );
+			Int32( rm.displacement );
+		}
+		else
+			Byte( 0xC0 | ( ( reg & 7 ) << 3 ) | ( rm.reg & 7 ) );
+	}
+
+	void MoveImmediate( Register reg, int32_t value )
+	{
+		if( reg >= R8 )
+			Byte( 0x41 );
+
+		Byte( 0xB8 + ( reg & 7 ) );
+		Int32( value );
+	}
+
+	void Move( Register reg, const Operand &rm )
+	{
+		if( rm.memory || rm.reg != reg )
+			Instruction( { 0x8B }, reg, rm );
+	}
+
+	void Store( const Operand &rm, Register reg )
+	{
+		Instruction( { 0x89 }, reg, rm );
+	}
+
+	void Push( Register reg )
+	{
+		if( reg >= R8 )
+			Byte( 0x41 );
+
+		Byte( 0x50 + ( reg & 7 ) );
+	}
+
+	void Pop( Register reg )
+	{
+		if( reg >= R8 )
+			Byte( 0x41 );
+
+		Byte( 0x58 + ( reg & 7 ) );
+	}
+
+	// returns the position of the rel32 to patch
+	size_t Jump( )
+	{
+		Byte( 0xE9 );
+		Int32( 0 );
+		return code.size( ) - 4;
+	}
+
+	size_t Jump( Condition condition )
+	{
+		Byte( 0x0F );
+		Byte( 0x80 + condition );
+		Int32( 0 );
+		return code.size( ) - 4;
+	}
+
+	void Patch( size_t position, size_t target )
+	{
+		int32_t relative = static_cast<int32_t>( target ) - static_cast<int32_t>( position + 4 );
+		for( int32_t i = 0; i < 4; ++i )
+			code[position + i] = static_cast<uint8_t>( static_cast<uint32_t>( relative ) >> ( i * 8 ) );
+	}
+
+	size_t Here( ) const
+	{
+		return code.size( );
+	}
+};
+
+class Compiler
+{
+public:
+	Compiler( const symbol::Table &symTable, Program &program ) :
+		symTable( symTable ),
+		program( program )
+	{ }
+
+	void Function( const node::Block *block )
+	{
+		program.variables = static_cast<uint32_t>( symTable.GetNames( ).size( ) );
+		budget = static_cast<int32_t>( ( program.variables + 1 ) / 2 * 8 );
+		Allocate( block );
+
+		for( auto &pair : registers )
+			if( IsCalleeSaved( pair.second ) )
+				assembler.Push( pair.second );
+
+		for( auto &pair : registers )
+			assembler.Move( pair.second, Operand::Slot( pair.first ) );
+
+		Statement( block );
+
+		assembler.MoveImmediate( RAX, 1 );
+		size_t done = assembler.Here( );
+		for( auto &pair : registers )
+			assembler.Store( Operand::Slot( pair.first ), pair.second );
+
+		for( auto it = registers.rbegin( ); it != registers.rend( ); ++it )
+			if( IsCalleeSaved( it->second ) )
+				assembler.Pop( it->second );
+
+		assembler.Byte( 0xC3 );
+
+		// loops jump here when the budget runs out
+		size_t abort = assembler.Here( );
+		assembler.Instruction( { 0x33 }, RAX, Operand::Direct( RAX ) );
+		assembler.Patch( assembler.Jump( ), done );
+		for( size_t position : aborts )
+			assembler.Patch( position, abort );
+
+		program.code = assembler.code;
+	}
+
+private:
+	struct Step
+	{
+		enum Kind
+		{
+			Evaluate,
+			Spill,
+			Reload,
+			Apply
+		};
+
+		Kind kind;
+		const node::Expression *expr;
+	};
+
+	struct Item
+	{
+		enum Kind
+		{
+			Statement,
+			Else,
+			Patch,
+			Test
+		};
+
+		Kind kind;
+		const node::Base *node;
+		// the jump to patch, and where a loop's body starts
+		size_t position;
+		size_t body;
+	};
+
+	// the hottest variables (references weigh 8 times more per loop level) get registers
+	void Allocate( const node::Block *block )
+	{
+		std::vector<uint64_t> weights( program.variables, 0 );
+		Count( block, weights );
+
+		std::vector<int32_t> slots;
+		for( uint32_t slot = 0; slot < program.variables; ++slot )
+			if( weights[slot] != 0 )
+				slots.push_back( static_cast<int32_t>( slot ) );
+
+		std::stable_sort( slots.begin( ), slots.end( ), [&weights]( int32_t a, int32_t b ) { return weights[a] > weights[b]; } );
+
+		size_t count = std::min( slots.size( ), sizeof( variable_registers ) / sizeof( variable_registers[0] ) );
+		for( size_t i = 0; i < count; ++i )
+			registers.push_back( std::make_pair( slots[i], variable_registers[i] ) );
+
+		program.registers = static_cast<uint32_t>( count );
+	}
+
+	// the order doesn't matter, so the nodes wait on a stack with their loop depth
+	void Count( const node::Base *root, std::vector<uint64_t> &weights )
+	{
+		std::vector<std::pair<const node::Base *, int32_t>> stack( 1, std::make_pair( root, 0 ) );
+		while( !stack.empty( ) )
+		{
+			const node::Base *node = stack.back( ).first;
+			int32_t depth = stack.back( ).second;
+			stack.pop_back( );
+			if( node == nullptr )
+				continue;
+
+			auto push = [&stack, depth]( const node::Base *child, int32_t deeper ) { stack.push_back( std::make_pair( child, depth + deeper ) ); };
+			uint64_t weight = uint64_t( 1 ) << std::min( 3 * depth, 48 );
+			if( const node::Identifier *id = dynamic_cast<const node::Identifier *>( node ) )
+				weights[symTable.GetIndex( id->name )] += weight;
+			else if( const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( node ) )
+			{
+				push( binop->lhs, 0 );
+				push( binop->rhs, 0 );
+			}
+			else if( const node::Block *block = dynamic_cast<const node::Block *>( node ) )
+			{
+				for( const node::Statement *stmt : block->statements )
+					push( stmt, 0 );
+			}
+			else if( const node::Assignment *assignment = dynamic_cast<const node::Assignment *>( node ) )
+			{
+				push( assignment->lhs, 0 );
+				push( assignment->rhs, 0 );
+			}
+			else if( const node::IntegerDeclaration *declaration = dynamic_cast<const node::IntegerDeclaration *>( node ) )
+			{
+				push( declaration->id, 0 );
+				push( declaration->assignmentExpr, 0 );
+			}
+			else if( const node::BooleanDeclaration *declaration = dynamic_cast<const node::BooleanDeclaration *>( node ) )
+			{
+				push( declaration->id, 0 );
+				push( declaration->assignmentExpr, 0 );
+			}
+			else if( const node::ExpressionStatement *expression = dynamic_cast<const node::ExpressionStatement *>( node ) )
+				push( expression->expression, 0 );
+			else if( const node::IfThenElse *ifthenelse = dynamic_cast<const node::IfThenElse *>( node ) )
+			{
+				push( ifthenelse->testExpr, 0 );
+				push( ifthenelse->successBlock, 0 );
+				push( ifthenelse->failureBlock, 0 );
+			}
+			else if( const node::WhileLoop *whileloop = dynamic_cast<const node::WhileLoop *>( node ) )
+			{
+				push( whileloop->testExpr, 1 );
+				push( whileloop->successBlock, 1 );
+			}
+		}
+	}
+
+	Operand Location( const node::Identifier *id ) const
+	{
+		int32_t slot = symTable.GetIndex( id->name );
+		for( auto &pair : registers )
+			if( pair.first == slot )
+				return Operand::Direct( pair.second );
+
+		return Operand::Slot( slot );
+	}
+
+	static bool IsConstant( const node::Expression *expr, int32_t &value )
+	{
+		if( const node::Integer *integer = dynamic_cast<const node::Integer *>( expr ) )
+		{
+			value = integer->value;
+			return true;
+		}
+
+		if( const node::Boolean *boolean = dynamic_cast<const node::Boolean *>( expr ) )
+		{
+			value = boolean->value ? 1 : 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	static bool IsComparison( node::BinaryOperator::Code op, Condition &condition )
+	{
+		switch( op )
+		{
+			case node::BinaryOperator::Equal: condition = Equal; return true;
+			case node::BinaryOperator::NotEqual: condition = NotEqual; return true;
+			case node::BinaryOperator::LessThan: condition = Less; return true;
+			case node::BinaryOperator::LessEqual: condition = LessEqual; return true;
+			case node::BinaryOperator::GreaterThan: condition = Greater; return true;
+			case node::BinaryOperator::GreaterEqual: condition = GreaterEqual; return true;
+			default: return false;
+		}
+	}
+
+	static bool IsLeaf( const node::Expression *expr )
+	{
+		int32_t constant;
+		return IsConstant( expr, constant ) || dynamic_cast<const node::Identifier *>( expr ) != nullptr;
+	}
+
+	// returns where the right operand is once the left one is in EAX, right
+	// operands that aren't leaves have been reloaded into ECX
+	bool Right( const node::BinaryOperator *binop, Operand &right, int32_t &constant ) const
+	{
+		if( IsConstant( binop->rhs, constant ) )
+			return true;
+
+		if( const node::Identifier *id = dynamic_cast<const node::Identifier *>( binop->rhs ) )
+			right = Location( id );
+		else
+			right = Operand::Direct( RCX );
+
+		return false;
+	}
+
+	// right operands wait in the frame past the budget rather than on the
+	// machine stack, which deep expressions would overflow
+	void Spill( )
+	{
+		assembler.Store( Operand::Slot( budget / 4 + 2 + spilled ), RAX );
+		spilled++;
+		program.temporaries = std::max( program.temporaries, static_cast<uint32_t>( spilled ) );
+	}
+
+	void Reload( )
+	{
+		spilled--;
+		assembler.Move( RCX, Operand::Slot( budget / 4 + 2 + spilled ) );
+	}
+
+	// computes the left operand into EAX and returns where the right one is
+	bool Operands( const node::BinaryOperator *binop, Operand &right, int32_t &constant )
+	{
+		if( IsLeaf( binop->rhs ) )
+			Expression( binop->lhs );
+		else
+		{
+			Expression( binop->rhs );
+			Spill( );
+			Expression( binop->lhs );
+			Reload( );
+		}
+
+		return Right( binop, right, constant );
+	}
+
+	// EAX = EAX op right, for the operators that have a plain ALU form
+	bool Arithmetic( node::BinaryOperator::Code op, Register reg, bool immediate, const Operand &right, int32_t constant )
+	{
+		static const std::map<node::BinaryOperator::Code, std::pair<uint8_t, uint8_t>> opcodes = {
+			{ node::BinaryOperator::Addition, { 0x03, 0 } },
+			{ node::BinaryOperator::Subtraction, { 0x2B, 5 } },
+			{ node::BinaryOperator::And, { 0x23, 4 } },
+			{ node::BinaryOperator::Or, { 0x0B, 1 } }
+		};
+
+		if( op == node::BinaryOperator::Multiplication )
+		{
+			if( immediate )
+			{
+				assembler.Instruction( { 0x69 }, reg, Operand::Direct( reg ) );
+				assembler.Int32( constant );
+			}
+			else
+				assembler.Instruction( { 0x0F, 0xAF }, reg, right );
+
+			return true;
+		}
+
+		auto it = opcodes.find( op );
+		if( it == opcodes.end( ) )
+			return false;
+
+		if( immediate )
+		{
+			assembler.Instruction( { 0x81 }, it->second.second, Operand::Direct( reg ) );
+			assembler.Int32( constant );
+		}
+		else
+			assembler.Instruction( { it->second.first }, reg, right );
+
+		return true;
+	}
+
+	void Compare( bool immediate, const Operand &right, int32_t constant )
+	{
+		if( immediate )
+		{
+			assembler.Instruction( { 0x81 }, 7, Operand::Direct( RAX ) );
+			assembler.Int32( constant );
+		}
+		else
+			assembler.Instruction( { 0x3B }, RAX, right );
+	}
+
+	// same semantics as the MIPS backend: dividing by zero gives zero and
+	// INT_MIN / -1 wraps, IDIV would trap on both
+	void Divide( bool modulo, bool immediate, const Operand &right, int32_t constant )
+	{
+		if( immediate )
+			assembler.MoveImmediate( RCX, constant );
+		else
+			assembler.Move( RCX, right );
+
+		assembler.Instruction( { 0x85 }, RCX, Operand::Direct( RCX ) );
+		size_t zero = assembler.Jump( Equal );
+		assembler.Instruction( { 0x81 }, 7, Operand::Direct( RCX ) );
+		assembler.Int32( -1 );
+		size_t minusone = assembler.Jump( Equal );
+
+		assembler.Byte( 0x99 );
+		assembler.Instruction( { 0xF7 }, 7, Operand::Direct( RCX ) );
+		if( modulo )
+			assembler.Move( RAX, Operand::Direct( RDX ) );
+
+		size_t done = assembler.Jump( );
+
+		assembler.Patch( minusone, assembler.Here( ) );
+		if( modulo )
+			assembler.Instruction( { 0x33 }, RAX, Operand::Direct( RAX ) );
+		else
+			assembler.Instruction( { 0xF7 }, 3, Operand::Direct( RAX ) );
+
+		size_t done2 = assembler.Jump( );
+
+		assembler.Patch( zero, assembler.Here( ) );
+		assembler.Instruction( { 0x33 }, RAX, Operand::Direct( RAX ) );
+
+		assembler.Patch( done, assembler.Here( ) );
+		assembler.Patch( done2, assembler.Here( ) );
+	}
+
+	// EAX = EAX op the right operand
+	void Apply( const node::BinaryOperator *binop )
+	{
+		Operand right = Operand::Direct( RCX );
+		int32_t constant = 0;
+		bool immediate = Right( binop, right, constant );
+
+		Condition condition;
+		if( Arithmetic( binop->op, RAX, immediate, right, constant ) )
+			return;
+
+		if( IsComparison( binop->op, condition ) )
+		{
+			Compare( immediate, right, constant );
+			assembler.Byte( 0x0F );
+			assembler.Byte( 0x90 + condition );
+			assembler.Byte( 0xC0 );
+			assembler.Byte( 0x0F );
+			assembler.Byte( 0xB6 );
+			assembler.Byte( 0xC0 );
+			return;
+		}
+
+		Divide( binop->op == node::BinaryOperator::Modulo, immediate, right, constant );
+	}
+
+	// leaves the value in EAX, the steps wait on a stack instead of recursing
+	void Expression( const node::Expression *root )
+	{
+		std::vector<Step> steps( 1, Step { Step::Evaluate, root } );
+		while( !steps.empty( ) )
+		{
+			Step step = steps.back( );
+			steps.pop_back( );
+			switch( step.kind )
+			{
+				case Step::Evaluate:
+				{
+					int32_t constant = 0;
+					if( IsConstant( step.expr, constant ) )
+						assembler.MoveImmediate( RAX, constant );
+					else if( const node::Identifier *id = dynamic_cast<const node::Identifier *>( step.expr ) )
+						assembler.Move( RAX, Location( id ) );
+					else
+					{
+						// reversed, the last one pushed runs first
+						const node::BinaryOperator *binop = static_cast<const node::BinaryOperator *>( step.expr );
+						steps.push_back( { Step::Apply, binop } );
+						if( IsLeaf( binop->rhs ) )
+							steps.push_back( { Step::Evaluate, binop->lhs } );
+						else
+						{
+							steps.push_back( { Step::Reload, nullptr } );
+							steps.push_back( { Step::Evaluate, binop->lhs } );
+							steps.push_back( { Step::Spill, nullptr } );
+							steps.push_back( { Step::Evaluate, binop->rhs } );
+						}
+					}
+					break;
+				}
+
+				case Step::Spill:
+					Spill( );
+					break;
+
+				case Step::Reload:
+					Reload( );
+					break;
+
+				case Step::Apply:
+					Apply( static_cast<const node::BinaryOperator *>( step.expr ) );
+					break;
+			}
+		}
+	}
+
+	// emits the test and returns the condition under which it holds
+	Condition Test( const node::Expression *expr )
+	{
+		const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( expr );
+		Condition condition;
+		if( binop != nullptr && IsComparison( binop->op, condition ) )
+		{
+			Operand right = Operand::Direct( RCX );
+			int32_t constant = 0;
+			bool immediate = Operands( binop, right, constant );
+			Compare( immediate, right, constant );
+			return condition;
+		}
+
+		Expression( expr );
+		assembler.Instruction( { 0x85 }, RAX, Operand::Direct( RAX ) );
+		return NotEqual;
+	}
+
+	static Condition Invert( Condition condition )
+	{
+		return static_cast<Condition>( condition ^ 1 );
+	}
+
+	void Store( const node::Identifier *id, const node::Expression *expr )
+	{
+		Operand target = Location( id );
+
+		int32_t constant = 0;
+		if( IsConstant( expr, constant ) )
+		{
+			if( target.memory )
+			{
+				assembler.Instruction( { 0xC7 }, 0, target );
+				assembler.Int32( constant );
+			}
+			else
+				assembler.MoveImmediate( target.reg, constant );
+
+			return;
+		}
+
+		// "x = x op leaf" updates a register variable in place
+		const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( expr );
+		const node::Identifier *lhs = binop != nullptr ? dynamic_cast<const node::Identifier *>( binop->lhs ) : nullptr;
+		if( !target.memory && lhs != nullptr && lhs->name == id->name )
+		{
+			const node::Identifier *rhs = dynamic_cast<const node::Identifier *>( binop->rhs );
+			bool immediate = IsConstant( binop->rhs, constant );
+			if( ( immediate || rhs != nullptr ) &&
+				Arithmetic( binop->op, target.reg, immediate, immediate ? target : Location( rhs ), constant ) )
+				return;
+		}
+
+		Expression( expr );
+		if( target.memory )
+			assembler.Store( target, RAX );
+		else
+			assembler.Move( target.reg, Operand::Direct( RAX ) );
+	}
+
+	// on a stack instead of recursing, so any nesting fits: a statement
+	// pushes what comes after it in reverse, the first part on top
+	void Statement( const node::Base *root )
+	{
+		std::vector<Item> items( 1, Item { Item::Statement, root, 0, 0 } );
+		while( !items.empty( ) )
+		{
+			Item item = items.back( );
+			items.pop_back( );
+			switch( item.kind )
+			{
+				case Item::Statement:
+					Visit( item.node, items );
+					break;
+
+				// the test failed, the success block jumps over the failure one
+				case Item::Else:
+				{
+					size_t end = assembler.Jump( );
+					assembler.Patch( item.position, assembler.Here( ) );
+					items.push_back( { Item::Patch, nullptr, end, 0 } );
+					items.push_back( { Item::Statement, static_cast<const node::IfThenElse *>( item.node )->failureBlock, 0, 0 } );
+					break;
+				}
+
+				case Item::Patch:
+					assembler.Patch( item.position, assembler.Here( ) );
+					break;
+
+				case Item::Test:
+					assembler.Patch( item.position, assembler.Here( ) );
+					assembler.Patch( assembler.Jump( Test( static_cast<const node::WhileLoop *>( item.node )->testExpr ) ), item.body );
+					break;
+			}
+		}
+	}
+
+	// what a statement emits before its children, which it pushes with the rest
+	void Visit( const node::Base *stmt, std::vector<Item> &items )
+	{
+		if( const node::Block *block = dynamic_cast<const node::Block *>( stmt ) )
+		{
+			for( auto child = block->statements.rbegin( ); child != block->statements.rend( ); ++child )
+				items.push_back( { Item::Statement, *child, 0, 0 } );
+		}
+		else if( const node::Assignment *assignment = dynamic_cast<const node::Assignment *>( stmt ) )
+			Store( assignment->lhs, assignment->rhs );
+		else if( const node::IntegerDeclaration *declaration = dynamic_cast<const node::IntegerDeclaration *>( stmt ) )
+		{
+			if( declaration->assignmentExpr != nullptr )
+				Store( declaration->id, declaration->assignmentExpr );
+		}
+		else if( const node::BooleanDeclaration *declaration = dynamic_cast<const node::BooleanDeclaration *>( stmt ) )
+		{
+			if( declaration->assignmentExpr != nullptr )
+				Store( declaration->id, declaration->assignmentExpr );
+		}
+		else if( const node::ExpressionStatement *expression = dynamic_cast<const node::ExpressionStatement *>( stmt ) )
+			Expression( expression->expression );
+		else if( const node::IfThenElse *ifthenelse = dynamic_cast<const node::IfThenElse *>( stmt ) )
+		{
+			size_t failure = assembler.Jump( Invert( Test( ifthenelse->testExpr ) ) );
+			items.push_back( { ifthenelse->failureBlock != nullptr ? Item::Else : Item::Patch, ifthenelse, failure, 0 } );
+			items.push_back( { Item::Statement, ifthenelse->successBlock, 0, 0 } );
+		}
+		else if( const node::WhileLoop *whileloop = dynamic_cast<const node::WhileLoop *>( stmt ) )
+		{
+			// rotated so every iteration takes a single branch, the budget is
+			// charged once per iteration
+			size_t test = assembler.Jump( );
+			size_t body = assembler.Here( );
+			assembler.Instruction( { 0x83 }, 5, Operand::Slot( budget / 4 ), true );
+			assembler.Byte( 0x01 );
+			aborts.push_back( assembler.Jump( Equal ) );
+			items.push_back( { Item::Test, whileloop, test, body } );
+			items.push_back( { Item::Statement, whileloop->successBlock, 0, 0 } );
+		}
+	}
+
+	const symbol::Table &symTable;
+	Program &program;
+	Assembler assembler;
+	std::vector<std::pair<int32_t, Register>> registers;
+	std::vector<size_t> aborts;
+	int32_t budget;
+	int32_t spilled = 0;
+};
+
+Program Compile( const node::Block *block, const symbol::Table &symTable )
+{
+	Program program;
+	Compiler compiler( symTable, program );
+	compiler.Function( block );
+	return program;
+}
+
+bool Run( const Program &program, std::vector<int32_t> &variables, std::string &error, uint64_t maxJumps )
+{
+#if defined __x86_64__ && defined __linux__
+	void *memory = mmap( nullptr, program.code.size( ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if( memory == MAP_FAILED )
+	{
+		error = "unable to map executable memory";
+		return false;
+	}
+
+	std::memcpy( memory, program.code.data( ), program.code.size( ) );
+	if( mprotect( memory, program.code.size( ), PROT_READ | PROT_EXEC ) != 0 )
+	{
+		munmap( memory, program.code.size( ) );
+		error = "unable to make memory executable";
+		return false;
+	}
+
+	// variables followed by the 8 byte aligned loop budget and the temporaries
+	size_t budget = ( program.variables + 1 ) / 2;
+	std::vector<int64_t> frame( budget + 1 + ( program.temporaries + 1 ) / 2, 0 );
+	frame[budget] = static_cast<int64_t>( std::min<uint64_t>( maxJumps + 1, INT64_MAX ) );
+
+	typedef int32_t ( *Entry )( int32_t *frame );
+	Entry entry = reinterpret_cast<Entry>( memory );
+	int32_t finished = entry( reinterpret_cast<int32_t *>( frame.data( ) ) );
+	munmap( memory, program.code.size( ) );
+
+	const int32_t *slots = reinterpret_cast<const int32_t *>( frame.data( ) );
+	variables.assign( slots, slots + program.variables );
+	if( finished == 0 )
+	{
+		error = "jump limit reached";
+		return false;
+	}
+
+	return true;
+#else
+	error = "native execution is only supported on x86-64 Linux";
+	return false;
+#endif
+}
+
+}
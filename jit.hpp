@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "node.hpp"
+#include "symbol.hpp"
+
+namespace jit
+{
+
+// x86-64 machine code for "int32_t function( int32_t *frame )", where the
+// frame holds the variables (indexed by symbol id) followed by a 64-bit loop
+// budget and the temporaries, returns 0 if the budget ran out and 1 otherwise
+struct Program
+{
+	std::vector<uint8_t> code;
+	uint32_t variables = 0;
+	// how many of the hottest variables live in registers
+	uint32_t registers = 0;
+	// frame slots for right operands that wait while the left one is computed
+	uint32_t temporaries = 0;
+};
+
+Program Compile( const node::Block *block, const symbol::Table &symTable );
+
+// maps the code as executable and runs it natively (x86-64 Linux only),
+// variables ends up with the final value of every variable
+bool Run( const Program &program, std::vector<int32_t> &variables, std::string &error, uint64_t maxJumps = 1000000000 );
+
+}
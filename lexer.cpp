@@ -0,0 +1,397 @@
+#include "lexer.hpp"
+#include <cstring>
+
+#if defined __linux__ || defined __APPLE__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define LEXER_MMAP
+#endif
+
+#if defined __x86_64__ && defined __GNUC__
+#include <immintrin.h>
+#define LEXER_SIMD
+#endif
+
+namespace lexer
+{
+
+enum class Class
+{
+	Whitespace,
+	Word,
+	Digit
+};
+
+template<Class type>
+static inline bool IsClass( uint8_t c )
+{
+	switch( type )
+	{
+		case Class::Whitespace:
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+
+		case Class::Word:
+			return ( ( c | 0x20 ) >= 'a' && ( c | 0x20 ) <= 'z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+
+		case Class::Digit:
+			return c >= '0' && c <= '9';
+	}
+
+	return false;
+}
+
+#if defined LEXER_SIMD
+
+// bytes above 0x7F are negative for the signed compares, so they never fall in a range
+template<Class type>
+static inline uint32_t Mask16( __m128i c )
+{
+	switch( type )
+	{
+		case Class::Whitespace:
+			return static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128(
+				_mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( ' ' ) ), _mm_cmpeq_epi8( c, _mm_set1_epi8( '\t' ) ) ),
+				_mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( '\r' ) ), _mm_cmpeq_epi8( c, _mm_set1_epi8( '\n' ) ) ) ) ) );
+
+		case Class::Word:
+		{
+			__m128i lower = _mm_or_si128( c, _mm_set1_epi8( 0x20 ) );
+			__m128i alpha = _mm_and_si128( _mm_cmpgt_epi8( lower, _mm_set1_epi8( 'a' - 1 ) ), _mm_cmplt_epi8( lower, _mm_set1_epi8( 'z' + 1 ) ) );
+			__m128i digit = _mm_and_si128( _mm_cmpgt_epi8( c, _mm_set1_epi8( '0' - 1 ) ), _mm_cmplt_epi8( c, _mm_set1_epi8( '9' + 1 ) ) );
+			return static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( alpha, digit ), _mm_cmpeq_epi8( c, _mm_set1_epi8( '_' ) ) ) ) );
+		}
+
+		case Class::Digit:
+			return static_cast<uint32_t>( _mm_movemask_epi8(
+				_mm_and_si128( _mm_cmpgt_epi8( c, _mm_set1_epi8( '0' - 1 ) ), _mm_cmplt_epi8( c, _mm_set1_epi8( '9' + 1 ) ) ) ) );
+	}
+
+	return 0;
+}
+
+template<Class type>
+__attribute__(( target( "avx2" ) )) static inline uint32_t Mask32( __m256i c )
+{
+	switch( type )
+	{
+		case Class::Whitespace:
+			return static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_or_si256(
+				_mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( ' ' ) ), _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\t' ) ) ),
+				_mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\r' ) ), _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\n' ) ) ) ) ) );
+
+		case Class::Word:
+		{
+			__m256i lower = _mm256_or_si256( c, _mm256_set1_epi8( 0x20 ) );
+			__m256i alpha = _mm256_and_si256( _mm256_cmpgt_epi8( lower, _mm256_set1_epi8( 'a' - 1 ) ), _mm256_cmpgt_epi8( _mm256_set1_epi8( 'z' + 1 ), lower ) );
+			__m256i digit = _mm256_and_si256( _mm256_cmpgt_epi8( c, _mm256_set1_epi8( '0' - 1 ) ), _mm256_cmpgt_epi8( _mm256_set1_epi8( '9' + 1 ), c ) );
+			return static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_or_si256( alpha, digit ), _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '_' ) ) ) ) );
+		}
+
+		case Class::Digit:
+			return static_cast<uint32_t>( _mm256_movemask_epi8(
+				_mm256_and_si256( _mm256_cmpgt_epi8( c, _mm256_set1_epi8( '0' - 1 ) ), _mm256_cmpgt_epi8( _mm256_set1_epi8( '9' + 1 ), c ) ) ) );
+	}
+
+	return 0;
+}
+
+template<Class type>
+__attribute__(( target( "avx2" ) )) static size_t Span32( const char *data, size_t position, size_t size )
+{
+	while( position + 32 <= size )
+	{
+		uint32_t mask = ~Mask32<type>( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( data + position ) ) );
+		if( mask != 0 )
+			return position + static_cast<size_t>( __builtin_ctz( mask ) );
+
+		position += 32;
+	}
+
+	return position;
+}
+
+#endif
+
+// first position at or after the given one that isn't of the class, the
+// vector loads never go past the end of the input (it may be mapped)
+template<Class type>
+static size_t Span( const char *data, size_t position, size_t size, bool avx2 )
+{
+#if defined LEXER_SIMD
+	// most runs are short, AVX2 only takes over once the first 16 bytes all
+	// matched (the AVX state switch isn't free)
+	bool first = true;
+	while( position + 16 <= size )
+	{
+		uint32_t mask = ~Mask16<type>( _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + position ) ) ) & 0xFFFF;
+		if( mask != 0 )
+			return position + static_cast<size_t>( __builtin_ctz( mask ) );
+
+		position += 16;
+		if( first && avx2 )
+			position = Span32<type>( data, position, size );
+
+		first = false;
+	}
+#else
+	(void)avx2;
+#endif
+
+	while( position < size && IsClass<type>( static_cast<uint8_t>( data[position] ) ) )
+		++position;
+
+	return position;
+}
+
+static Kind Keyword( const char *text, size_t length )
+{
+	switch( length )
+	{
+		case 2:
+			if( std::memcmp( text, "if", 2 ) == 0 )
+				return Kind::If;
+
+			break;
+
+		case 3:
+			if( std::memcmp( text, "int", 3 ) == 0 )
+				return Kind::Int;
+
+			break;
+
+		case 4:
+			if( std::memcmp( text, "true", 4 ) == 0 )
+				return Kind::True;
+			else if( std::memcmp( text, "bool", 4 ) == 0 )
+				return Kind::Bool;
+			else if( std::memcmp( text, "else", 4 ) == 0 )
+				return Kind::Else;
+
+			break;
+
+		case 5:
+			if( std::memcmp( text, "false", 5 ) == 0 )
+				return Kind::False;
+			else if( std::memcmp( text, "while", 5 ) == 0 )
+				return Kind::While;
+
+			break;
+	}
+
+	return Kind::Identifier;
+}
+
+static Kind Operator( uint8_t c, uint8_t next )
+{
+	switch( c )
+	{
+		case ';':
+			return Kind::Semicolon;
+
+		case '(':
+			return Kind::LeftParen;
+
+		case ')':
+			return Kind::RightParen;
+
+		case '{':
+			return Kind::LeftBrace;
+
+		case '}':
+			return Kind::RightBrace;
+
+		case '+':
+			return Kind::Add;
+
+		case '-':
+			return Kind::Subtract;
+
+		case '*':
+			return Kind::Multiply;
+
+		case '/':
+			return Kind::Divide;
+
+		case '%':
+			return Kind::Modulo;
+
+		case '=':
+			return next == '=' ? Kind::Equal : Kind::Assign;
+
+		case '<':
+			return next == '=' ? Kind::LessEqual : Kind::Less;
+
+		case '>':
+			return next == '=' ? Kind::GreaterEqual : Kind::Greater;
+
+		case '!':
+			return next == '=' ? Kind::NotEqual : Kind::Unknown;
+
+		case '&':
+			return next == '&' ? Kind::And : Kind::Unknown;
+
+		case '|':
+			return next == '|' ? Kind::Or : Kind::Unknown;
+	}
+
+	return Kind::Unknown;
+}
+
+Source::Source( ) :
+	data( nullptr ),
+	size( 0 ),
+	mapped( false )
+{ }
+
+Source::~Source( )
+{
+#if defined LEXER_MMAP
+	if( mapped )
+		munmap( const_cast<char *>( data ), size );
+#endif
+}
+
+bool Source::Open( int32_t descriptor )
+{
+#if defined LEXER_MMAP
+	struct stat info;
+	if( fstat( descriptor, &info ) == 0 && S_ISREG( info.st_mode ) && info.st_size > 0 )
+	{
+		void *memory = mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ, MAP_PRIVATE, descriptor, 0 );
+		if( memory != MAP_FAILED )
+		{
+			madvise( memory, static_cast<size_t>( info.st_size ), MADV_SEQUENTIAL );
+			data = static_cast<const char *>( memory );
+			size = static_cast<size_t>( info.st_size );
+			mapped = true;
+			return true;
+		}
+	}
+
+	char chunk[65536];
+	ssize_t count;
+	while( ( count = read( descriptor, chunk, sizeof( chunk ) ) ) > 0 )
+		buffer.insert( buffer.end( ), chunk, chunk + count );
+
+	if( count < 0 )
+		return false;
+
+	data = buffer.data( );
+	size = buffer.size( );
+	return true;
+#else
+	(void)descriptor;
+	return false;
+#endif
+}
+
+bool Source::Open( const std::string &path )
+{
+#if defined LEXER_MMAP
+	// the mapping outlives the descriptor
+	int32_t descriptor = open( path.c_str( ), O_RDONLY );
+	if( descriptor < 0 )
+		return false;
+
+	bool opened = Open( descriptor );
+	close( descriptor );
+	return opened;
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+const char *Source::GetData( ) const
+{
+	return data;
+}
+
+size_t Source::GetSize( ) const
+{
+	return size;
+}
+
+Scanner::Scanner( const char *data, size_t size ) :
+	data( data ),
+	size( size ),
+	position( 0 ),
+#if defined LEXER_SIMD
+	avx2( __builtin_cpu_supports( "avx2" ) != 0 )
+#else
+	avx2( false )
+#endif
+{ }
+
+Token Scanner::Next( )
+{
+	position = Span<Class::Whitespace>( data, position, size, avx2 );
+
+	Token token = { Kind::End, position, 0 };
+	if( position >= size )
+		return token;
+
+	uint8_t c = static_cast<uint8_t>( data[position] );
+	uint8_t next = position + 1 < size ? static_cast<uint8_t>( data[position + 1] ) : 0;
+	size_t end = position + 1;
+	if( ( ( c | 0x20 ) >= 'a' && ( c | 0x20 ) <= 'z' ) || c == '_' )
+	{
+		end = Span<Class::Word>( data, end, size, avx2 );
+		token.kind = Keyword( data + position, end - position );
+	}
+	else if( c >= '0' && c <= '9' )
+	{
+		end = Span<Class::Digit>( data, end, size, avx2 );
+		token.kind = Kind::Integer;
+	}
+	else
+	{
+		token.kind = Operator( c, next );
+
+		switch( token.kind )
+		{
+			case Kind::Equal:
+			case Kind::LessEqual:
+			case Kind::GreaterEqual:
+			case Kind::NotEqual:
+			case Kind::And:
+			case Kind::Or:
+				++end;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	token.length = end - position;
+	position = end;
+	return token;
+}
+
+const char *Scanner::GetText( const Token &token ) const
+{
+	return data + token.offset;
+}
+
+int32_t Scanner::GetInteger( const Token &token ) const
+{
+	uint64_t value = 0;
+	for( size_t i = 0; i < token.length; ++i )
+	{
+		uint64_t digit = static_cast<uint64_t>( data[token.offset + i] - '0' );
+		if( value > ( INT64_MAX - digit ) / 10 )
+		{
+			value = INT64_MAX;
+			break;
+		}
+
+		value = value * 10 + digit;
+	}
+
+	return static_cast<int32_t>( static_cast<uint32_t>( value ) );
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lexer
+{
+
+enum class Kind : uint8_t
+{
+	End,
+	Identifier,
+	Integer,
+	True,
+	False,
+	Int,
+	Bool,
+	If,
+	Else,
+	While,
+	And,
+	Or,
+	Assign,
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+	LeftParen,
+	RightParen,
+	LeftBrace,
+	RightBrace,
+	Semicolon,
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Modulo,
+	Unknown
+};
+
+// slice of the input, nothing is copied or allocated; offsets are as wide
+// as the input, which may be mapped past 4 GiB
+struct Token
+{
+	Kind kind;
+	size_t offset;
+	size_t length;
+};
+
+// whole input in memory, mapped when the descriptor is a regular file and
+// read otherwise (pipes, terminals)
+class Source
+{
+public:
+	Source( );
+	~Source( );
+
+	Source( const Source & ) = delete;
+	Source &operator=( const Source & ) = delete;
+
+	bool Open( int32_t descriptor );
+	bool Open( const std::string &path );
+	const char *GetData( ) const;
+	size_t GetSize( ) const;
+
+private:
+	const char *data;
+	size_t size;
+	bool mapped;
+	std::vector<char> buffer;
+};
+
+// hand-written scanner for the same language as tokens.l, whitespace,
+// identifier and integer runs are scanned 16 (SSE2) or 32 (AVX2, when the CPU
+// has it) bytes at a time
+class Scanner
+{
+public:
+	Scanner( const char *data, size_t size );
+
+	Token Next( );
+	const char *GetText( const Token &token ) const;
+	// same as the flex front end: atol, which saturates at LONG_MAX, truncated
+	// to 32 bits
+	int32_t GetInteger( const Token &token ) const;
+
+private:
+	const char *data;
+	size_t size;
+	size_t position;
+	bool avx2;
+};
+
+}
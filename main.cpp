@@ -1,21 +1,690 @@
 #include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <memory>
 #include "node.hpp"
 #include "symbol.hpp"
+#include "simulator.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "lexer.hpp"
+#include "compiler.hpp"
+#include "batch.hpp"
+#include "server.hpp"
+#include "pipeline.hpp"
+#include "cache.hpp"
+#include "incremental.hpp"
+#include "pratt.hpp"
+#include "image.hpp"
+#include "report.hpp"
 
-extern int32_t yyparse( node::Block **programBlock, symbol::Table &symTable );
+extern size_t CountFlexTokens( const char *data, size_t size );
 
-int32_t main( int32_t argc, const char **argv )
+static void PrintVariable( const symbol::Table &symTable, const std::string &name, int32_t value )
 {
-	node::Block *programBlock = nullptr;
+	if( symTable.Get( name ) == symbol::Type::Boolean )
+		std::cout << "  " << name << " = " << ( value != 0 ? "true" : "false" ) << std::endl;
+	else
+		std::cout << "  " << name << " = " << value << std::endl;
+}
+
+static int32_t Run( const instruction::List &list, const symbol::Table &symTable, bool delaySlots, const simulator::CostModel &model )
+{
+	simulator::Machine machine( list, delaySlots, model );
+	simulator::Statistics stats = machine.Run( );
+
+	std::cout << "Instructions: " << stats.instructions << " (" << stats.words << " machine instructions)" << std::endl;
+	std::cout << "  ALU: " << stats.alu << std::endl;
+	std::cout << "  Loads: " << stats.loads << std::endl;
+	std::cout << "  Stores: " << stats.stores << std::endl;
+	std::cout << "  Multiplies: " << stats.multiplies << std::endl;
+	std::cout << "  Divides: " << stats.divides << std::endl;
+	std::cout << "  Branches: " << stats.branches << " (" << stats.taken << " taken)" << std::endl;
+	std::cout << "  Jumps: " << stats.jumps << std::endl;
+	std::cout << "  NOPs: " << stats.nops << std::endl;
+	std::cout << "Estimated cycles: " << stats.cycles << std::endl;
+
+	std::cout << "Variables:" << std::endl;
+	for( const std::string &name : symTable.GetNames( ) )
+	{
+		int32_t value = 0;
+		machine.GetVariable( name, value );
+		PrintVariable( symTable, name, value );
+	}
+
+	if( !stats.error.empty( ) )
+	{
+		std::cerr << "Error: " << stats.error << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int32_t RunBytecode( const node::Block *programBlock, const symbol::Table &symTable )
+{
+	bytecode::Program program = bytecode::Compile( programBlock, symTable );
+
+	std::vector<int32_t> frame;
+	bool finished = bytecode::Run( program, frame );
+
+	std::cout << "Variables:" << std::endl;
+	for( const std::string &name : symTable.GetNames( ) )
+		PrintVariable( symTable, name, frame[symTable.GetIndex( name )] );
+
+	if( !finished )
+	{
+		std::cerr << "Error: jump limit reached" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int32_t RunNative( const node::Block *programBlock, const symbol::Table &symTable )
+{
+	jit::Program program = jit::Compile( programBlock, symTable );
+
+	std::vector<int32_t> variables;
+	std::string error;
+	bool finished = jit::Run( program, variables, error );
+
+	if( variables.size( ) == symTable.GetNames( ).size( ) )
+	{
+		std::cout << "Variables:" << std::endl;
+		for( const std::string &name : symTable.GetNames( ) )
+			PrintVariable( symTable, name, variables[symTable.GetIndex( name )] );
+	}
+
+	if( !finished )
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int32_t WriteObject( compiler::Compiler &compiler, bool delaySlots, const char *path )
+{
+	std::vector<uint8_t> bytes;
+	if( !compiler.GetObject( delaySlots, bytes ) )
+	{
+		std::cerr << "Error: " << compiler.GetError( ) << std::endl;
+		return 1;
+	}
+
+	std::ofstream file( path, std::ios::binary );
+	file.write( reinterpret_cast<const char *>( bytes.data( ) ), static_cast<std::streamsize>( bytes.size( ) ) );
+	if( !file )
+	{
+		std::cerr << "Error: can't write " << path << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+static size_t CountTokens( const char *data, size_t size )
+{
+	lexer::Scanner scanner( data, size );
+	size_t count = 0;
+	while( scanner.Next( ).kind != lexer::Kind::End )
+		++count;
+
+	return count;
+}
+
+// scans the whole input repeatedly with both scanners and prints their throughput
+static int32_t BenchmarkLexers( const lexer::Source &source )
+{
+	auto benchmark = [&source]( const char *name, size_t ( *scan )( const char *, size_t ) )
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+		std::chrono::duration<double> elapsed;
+		size_t tokens = 0;
+		uint32_t runs = 0;
+		do
+		{
+			tokens = scan( source.GetData( ), source.GetSize( ) );
+			++runs;
+			elapsed = std::chrono::steady_clock::now( ) - start;
+		}
+		while( runs < 10 || elapsed.count( ) < 0.5 );
+
+		double bytes = static_cast<double>( source.GetSize( ) ) * runs;
+		std::cout << name << ": " << tokens << " tokens, " << elapsed.count( ) * 1000.0 / runs << " ms per run, " <<
+			bytes / elapsed.count( ) / 1000000.0 << " MB/s" << std::endl;
+	};
+
+	benchmark( "flex", CountFlexTokens );
+	benchmark( "simd", CountTokens );
+
+	return 0;
+}
+
+// types a character at random places of the input and takes it back, reporting
+// the latency of each edit next to a full parse; the text ends up as it was,
+// so the allocations still live after the edits are leaks and fail the run
+static int32_t BenchmarkEdits( const lexer::Source &source )
+{
+	std::string text( source.GetData( ), source.GetSize( ) );
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
 	symbol::Table symTable;
+	node::Block *programBlock = nullptr;
+	std::string error;
+	pratt::Parse( text.data( ), text.size( ), &programBlock, symTable, error );
+	std::chrono::duration<double> full = std::chrono::steady_clock::now( ) - start;
+	delete programBlock;
+
+	incremental::Document document( text );
+	incremental::Statistics initial = document.GetStatistics( );
+	const char characters[] = " ;x1+(";
+	const uint32_t edits = 2000;
+	std::chrono::duration<double> total( 0 ), slowest( 0 );
+	uint64_t seed = 1;
+	report::Report counting( true, text.size( ) );
+	int64_t live = report::GetLiveAllocations( );
+	for( uint32_t i = 0; i < edits; ++i )
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		size_t offset = static_cast<size_t>( seed >> 33 ) % ( text.size( ) + 1 );
+		std::string inserted( 1, characters[( seed >> 16 ) % ( sizeof( characters ) - 1 )] );
+
+		for( uint32_t undo = 0; undo < 2; ++undo )
+		{
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now( );
+			if( undo == 0 )
+				document.Edit( offset, 0, inserted );
+			else
+				document.Edit( offset, 1, "" );
+
+			document.GetDiagnostics( );
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now( ) - begin;
+			total += elapsed;
+			slowest = std::max( slowest, elapsed );
+		}
+	}
+
+	incremental::Statistics stats = document.GetStatistics( );
+	std::cout << "full parse: " << full.count( ) * 1000.0 << " ms, " << document.GetStatementCount( ) << " statements" << std::endl;
+	std::cout << "edits: " << stats.edits << ", " << total.count( ) * 1000000.0 / stats.edits << " us average, " <<
+		slowest.count( ) * 1000000.0 << " us slowest, " << static_cast<double>( stats.reparsed - initial.reparsed ) / stats.edits <<
+		" statements and " << static_cast<double>( stats.bytes - initial.bytes ) / stats.edits << " bytes reparsed per edit, " <<
+		stats.rechecked << " rechecked" << std::endl;
+
+	int64_t leaked = report::GetLiveAllocations( ) - live;
+	std::cout << "allocations left by the edits: " << leaked << std::endl;
+	return leaked > 0 ? 1 : 0;
+}
+
+static void PrintCacheStatistics( const cache::Cache &cache )
+{
+	cache::Statistics stats = cache.GetStatistics( );
+	std::cerr << "Cache hits: " << stats.hits << ", misses: " << stats.misses << ", stored: " << stats.stores <<
+		", evicted: " << stats.evictions << std::endl;
+}
+
+static int32_t CompileBatch( const std::vector<std::string> &paths, const batch::Settings &settings )
+{
+	batch::Statistics stats = batch::CompileFiles( paths, settings );
+	for( const std::string &error : stats.errors )
+		std::cerr << "Error: " << error << std::endl;
+
+	std::cerr << "Compiled " << stats.files - stats.failed << "/" << stats.files << " files (" << stats.bytes << " bytes) in " <<
+		stats.seconds << " s on " << stats.threads << " threads: " << stats.files / stats.seconds << " files/s, " <<
+		stats.bytes / stats.seconds / 1000000.0 << " MB/s, " << stats.steals << " steals" << std::endl;
+
+	if( settings.cache != nullptr )
+		PrintCacheStatistics( *settings.cache );
 
-	yyparse( &programBlock, symTable );
+	return stats.failed == 0 ? 0 : 1;
+}
+
+// assembly to stdout, or the object to the "--elf=" path
+static int32_t WriteOutput( const std::string &output, const char *elf )
+{
+	if( elf == nullptr )
+	{
+		std::cout << output;
+		return 0;
+	}
 
-	instruction::List list;
-	programBlock->GenerateInstructions( list, symTable );
-	for( instruction::Base *inst : list )
-		std::cout << inst->ToString( );
+	std::ofstream file( elf, std::ios::binary );
+	file.write( output.data( ), static_cast<std::streamsize>( output.size( ) ) );
+	if( !file )
+	{
+		std::cerr << "Error: can't write " << elf << std::endl;
+		return 1;
+	}
 
 	return 0;
 }
+
+// compiles on a server, with the same output as a local compilation
+static int32_t CompileRemote( const char *path, const std::string &options, const lexer::Source &source, const char *elf )
+{
+	std::string output;
+	if( !server::Request( path, options, source.GetData( ), source.GetSize( ), output ) )
+	{
+		std::cout << "Error: " << output << std::endl;
+		return 1;
+	}
+
+	return WriteOutput( output, elf );
+}
+
+// compiles locally unless the cache has the output already
+static int32_t CompileCached( const lexer::Source &source, const batch::Settings &settings, const char *elf )
+{
+	compiler::Compiler compiler;
+	std::string output;
+	bool compiled = batch::CompileSource( compiler, source.GetData( ), source.GetSize( ), settings, output );
+	PrintCacheStatistics( *settings.cache );
+	if( !compiled )
+	{
+		std::cout << "Error: " << compiler.GetError( ) << std::endl;
+		return 1;
+	}
+
+	return WriteOutput( output, elf );
+}
+
+// the symbols and either the instructions or the program of an image, generated
+// tells which one it was
+static bool LoadImage( const char *path, compiler::Compiler &compiler, bool &generated )
+{
+	image::Image file;
+	std::string error;
+	bool loaded = file.Open( path, error ) && file.LoadSymbols( compiler.GetSymbols( ), error );
+	generated = loaded && ( file.GetHeader( ).contents & image::HasInstructions ) != 0;
+	if( generated )
+		loaded = file.LoadInstructions( compiler.GetInstructions( ), error );
+	else if( loaded )
+	{
+		node::Block *program = file.LoadProgram( error );
+		compiler.SetProgram( program );
+		loaded = program != nullptr;
+	}
+
+	if( !loaded )
+		std::cerr << "Error: " << error << std::endl;
+
+	return loaded;
+}
+
+// the symbols and the program, or the instructions
+static bool SaveImage( const char *path, compiler::Compiler &compiler, bool instructions )
+{
+	image::Writer writer;
+	writer.AddSymbols( compiler.GetSymbols( ) );
+	if( instructions )
+		writer.AddInstructions( compiler.GetInstructions( ) );
+	else
+		writer.AddProgram( compiler.GetProgram( ) );
+
+	std::string error;
+	if( !writer.Write( path, error ) )
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int32_t main( int32_t argc, const char **argv )
+{
+	compiler::Passes passes;
+	bool gprel = false;
+	bool simplify = false;
+	bool schedule = false;
+	bool run = false;
+	bool vm = false;
+	bool native = false;
+	const char *elf = nullptr;
+	bool simd = false;
+	bool lexBench = false;
+	bool editBench = false;
+	bool pratt = false;
+	bool flatAst = false;
+	simulator::CostModel model;
+	std::vector<std::string> paths;
+	const char *manifest = nullptr;
+	uint32_t jobs = 0;
+	uint32_t codegenThreads = 1;
+	bool pipelined = false;
+	bool streaming = false;
+	const char *cacheDirectory = nullptr;
+	uint64_t cacheSize = 256;
+	const char *serve = nullptr;
+	const char *client = nullptr;
+	const char *load = nullptr;
+	const char *saveAst = nullptr;
+	const char *saveIr = nullptr;
+	bool timeReport = false;
+	bool timeJson = false;
+	// compile flags forwarded by the client
+	std::string options;
+	for( int32_t i = 1; i < argc; ++i )
+	{
+		if( std::strncmp( argv[i], "--elf=", 6 ) == 0 )
+			options += "--elf ";
+		else if( argv[i][0] == '-' && std::strncmp( argv[i], "--client=", 9 ) != 0 )
+			options += std::string( argv[i] ) + " ";
+
+		if( std::strcmp( argv[i], "--gprel" ) == 0 )
+			gprel = true;
+		else if( std::strcmp( argv[i], "--thread-jumps" ) == 0 )
+			simplify = true;
+		else if( std::strcmp( argv[i], "--schedule" ) == 0 )
+			schedule = true;
+		else if( std::strcmp( argv[i], "--noreorder" ) == 0 )
+			passes.noreorder = true;
+		else if( std::strcmp( argv[i], "--time-report" ) == 0 )
+			timeReport = true;
+		else if( std::strcmp( argv[i], "--time-report=json" ) == 0 )
+			timeReport = timeJson = true;
+		else if( std::strcmp( argv[i], "--pass-stats" ) == 0 )
+			passes.statistics = true;
+		else if( std::strncmp( argv[i], "-O", 2 ) == 0 )
+		{
+			if( !optimizer::GetLevel( argv[i] + 2, passes.pipeline ) )
+			{
+				std::cerr << "Error: invalid optimization level " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if( std::strncmp( argv[i], "--passes=", 9 ) == 0 )
+		{
+			if( !optimizer::ParsePasses( argv[i] + 9, passes.pipeline ) )
+			{
+				std::cerr << "Error: invalid passes " << argv[i] + 9 << std::endl;
+				return 1;
+			}
+		}
+		else if( std::strcmp( argv[i], "--run" ) == 0 )
+			run = true;
+		else if( std::strcmp( argv[i], "--vm" ) == 0 )
+			vm = true;
+		else if( std::strcmp( argv[i], "--jit" ) == 0 )
+			native = true;
+		else if( std::strcmp( argv[i], "--lexer=flex" ) == 0 )
+			simd = false;
+		else if( std::strcmp( argv[i], "--lexer=simd" ) == 0 )
+			simd = true;
+		else if( std::strcmp( argv[i], "--parser=bison" ) == 0 )
+			pratt = false;
+		else if( std::strcmp( argv[i], "--parser=pratt" ) == 0 )
+			pratt = true;
+		else if( std::strcmp( argv[i], "--ast=nodes" ) == 0 )
+			flatAst = false;
+		else if( std::strcmp( argv[i], "--ast=flat" ) == 0 )
+			flatAst = true;
+		else if( std::strcmp( argv[i], "--lex-bench" ) == 0 )
+			lexBench = true;
+		else if( std::strcmp( argv[i], "--edit-bench" ) == 0 )
+			editBench = true;
+		else if( std::strcmp( argv[i], "--pipeline" ) == 0 )
+			pipelined = true;
+		else if( std::strcmp( argv[i], "--stream" ) == 0 )
+			streaming = true;
+		else if( std::strncmp( argv[i], "--elf=", 6 ) == 0 )
+			elf = argv[i] + 6;
+		else if( std::strncmp( argv[i], "--manifest=", 11 ) == 0 )
+			manifest = argv[i] + 11;
+		else if( std::strncmp( argv[i], "--server=", 9 ) == 0 )
+			serve = argv[i] + 9;
+		else if( std::strncmp( argv[i], "--client=", 9 ) == 0 )
+			client = argv[i] + 9;
+		else if( std::strncmp( argv[i], "--jobs=", 7 ) == 0 )
+			jobs = static_cast<uint32_t>( std::strtoul( argv[i] + 7, nullptr, 10 ) );
+		else if( std::strncmp( argv[i], "--cache=", 8 ) == 0 )
+			cacheDirectory = argv[i] + 8;
+		else if( std::strncmp( argv[i], "--cache-size=", 13 ) == 0 )
+			cacheSize = std::strtoull( argv[i] + 13, nullptr, 10 );
+		else if( std::strncmp( argv[i], "--codegen-threads=", 18 ) == 0 )
+			codegenThreads = static_cast<uint32_t>( std::strtoul( argv[i] + 18, nullptr, 10 ) );
+		else if( std::strncmp( argv[i], "--load=", 7 ) == 0 )
+			load = argv[i] + 7;
+		else if( std::strncmp( argv[i], "--save-ast=", 11 ) == 0 )
+			saveAst = argv[i] + 11;
+		else if( std::strncmp( argv[i], "--save-ir=", 10 ) == 0 )
+			saveIr = argv[i] + 10;
+		else if( std::strncmp( argv[i], "--cost-model=", 13 ) == 0 )
+		{
+			if( !simulator::ParseCostModel( argv[i] + 13, model ) )
+			{
+				std::cerr << "Error: invalid cost model " << argv[i] + 13 << std::endl;
+				return 1;
+			}
+		}
+		else if( argv[i][0] != '-' )
+			paths.push_back( argv[i] );
+		else
+		{
+			std::cerr << "Error: unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	// after "-O" and "--passes=", wherever they were
+	if( gprel )
+		passes.Add( optimizer::Pass::GlobalPointer );
+
+	if( simplify )
+		passes.Add( optimizer::Pass::ThreadJumps );
+
+	if( schedule )
+		passes.Add( optimizer::Pass::Schedule );
+
+	compiler::Frontend frontend = flatAst ? compiler::Frontend::Flat : pratt ? compiler::Frontend::Pratt :
+		simd ? compiler::Frontend::Simd : compiler::Frontend::Flex;
+
+	std::unique_ptr<cache::Cache> cache;
+	if( cacheDirectory != nullptr )
+		cache.reset( new cache::Cache( cacheDirectory, cacheSize * 1024 * 1024 ) );
+
+	if( manifest != nullptr && !batch::ReadManifest( manifest, paths ) )
+	{
+		std::cerr << "Error: can't read " << manifest << std::endl;
+		return 1;
+	}
+
+	if( ( load != nullptr || saveAst != nullptr || saveIr != nullptr ) && ( !paths.empty( ) || serve != nullptr ||
+		client != nullptr || lexBench || editBench || pipelined || streaming || cache != nullptr ) )
+	{
+		std::cerr << "Error: images only work with a single local compilation" << std::endl;
+		return 1;
+	}
+
+	if( timeReport && ( !paths.empty( ) || serve != nullptr || client != nullptr || lexBench || editBench || pipelined ||
+		streaming || ( cache != nullptr && !run && !vm && !native ) ) )
+	{
+		std::cerr << "Error: \"--time-report\" only works with a single local compilation" << std::endl;
+		return 1;
+	}
+
+	if( !paths.empty( ) )
+	{
+		if( run || vm || native || lexBench || editBench )
+		{
+			std::cerr << "Error: input files can only be compiled" << std::endl;
+			return 1;
+		}
+
+		batch::Settings settings;
+		settings.frontend = frontend;
+		settings.passes = passes;
+		settings.elf = elf != nullptr;
+		settings.jobs = jobs;
+		settings.cache = cache.get( );
+		return CompileBatch( paths, settings );
+	}
+
+	if( serve != nullptr )
+		return server::Serve( serve, jobs );
+
+	lexer::Source source;
+	if( load == nullptr && !source.Open( fileno( stdin ) ) )
+	{
+		std::cerr << "Error: can't read the input" << std::endl;
+		return 1;
+	}
+
+	if( client != nullptr )
+		return CompileRemote( client, options, source, elf );
+
+	if( lexBench )
+		return BenchmarkLexers( source );
+
+	if( editBench )
+		return BenchmarkEdits( source );
+
+	if( pipelined )
+	{
+		if( run || vm || native || elf != nullptr || !passes.pipeline.empty( ) || passes.noreorder )
+		{
+			std::cerr << "Error: the pipeline only prints assembly, without passes" << std::endl;
+			return 1;
+		}
+
+		std::string assembly, error;
+		if( !pipeline::Compile( source.GetData( ), source.GetSize( ), assembly, error ) )
+		{
+			std::cout << "Error: " << error << std::endl;
+			return 1;
+		}
+
+		std::cout << assembly;
+		return 0;
+	}
+
+	if( streaming )
+	{
+		if( run || vm || native || elf != nullptr || pratt || flatAst || !passes.pipeline.empty( ) || passes.noreorder )
+		{
+			std::cerr << "Error: streaming only prints assembly, with the Bison parser and without passes" << std::endl;
+			return 1;
+		}
+
+		compiler::Compiler compiler;
+		compiler.SetStream( &std::cout );
+		if( !compiler.Parse( source.GetData( ), source.GetSize( ), frontend ) )
+		{
+			std::cout << "Error: " << compiler.GetError( ) << std::endl;
+			return 1;
+		}
+
+		std::cout << compiler.GetData( );
+		return 0;
+	}
+
+	if( cache != nullptr && !run && !vm && !native )
+	{
+		batch::Settings settings;
+		settings.frontend = frontend;
+		settings.passes = passes;
+		settings.elf = elf != nullptr;
+		settings.cache = cache.get( );
+		return CompileCached( source, settings, elf );
+	}
+
+	compiler::Compiler compiler;
+	report::Report timing( timeReport, load == nullptr ? source.GetSize( ) : 0 );
+	if( timing.IsEnabled( ) && load == nullptr )
+	{
+		// on its own, parsing scans the input again, so it's not in the total
+		timing.Start( "lex", true );
+		bool flex = frontend == compiler::Frontend::Flex;
+		timing.Count( "tokens", ( flex ? CountFlexTokens : CountTokens )( source.GetData( ), source.GetSize( ) ) );
+	}
+
+	bool generated = false;
+	timing.Start( load != nullptr ? "load" : "parse" );
+	if( load != nullptr )
+	{
+		if( !LoadImage( load, compiler, generated ) )
+			return 1;
+	}
+	else if( !compiler.Parse( source.GetData( ), source.GetSize( ), frontend ) )
+	{
+		std::cout << "Error: " << compiler.GetError( ) << std::endl;
+		return 1;
+	}
+
+	timing.Stop( );
+	if( timing.IsEnabled( ) && !generated )
+	{
+		const node::Block *program = compiler.GetProgram( );
+		timing.Count( "nodes", program != nullptr ? report::CountNodes( program ) : compiler.GetTree( ).kinds.size( ) - 1 );
+	}
+
+	timing.Start( "optimize" );
+	compiler.RunTreePasses( passes, &std::cerr );
+	timing.Stop( );
+
+	const symbol::Table &symTable = compiler.GetSymbols( );
+	if( ( vm || native || saveAst != nullptr ) && compiler.GetProgram( ) == nullptr )
+	{
+		std::cerr << "Error: the bytecode and native backends and \"--save-ast\" need node:: trees, not \"--ast=flat\" or instructions" << std::endl;
+		return 1;
+	}
+
+	if( saveAst != nullptr )
+	{
+		timing.Start( "save" );
+		if( !SaveImage( saveAst, compiler, false ) )
+			return 1;
+	}
+
+	int32_t status = 0;
+	if( vm || native )
+	{
+		timing.Start( "run" );
+		status = vm ? RunBytecode( compiler.GetProgram( ), symTable ) : RunNative( compiler.GetProgram( ), symTable );
+	}
+	else
+	{
+		timing.Start( "codegen" );
+		if( !generated )
+			compiler.Generate( codegenThreads );
+
+		timing.Count( "instructions", compiler.GetInstructions( ).size( ) );
+		timing.Start( "optimize" );
+		if( !compiler.RunPasses( passes, &std::cerr ) )
+		{
+			std::cout << "Error: " << compiler.GetError( ) << std::endl;
+			return 1;
+		}
+
+		timing.Count( "optimized instructions", compiler.GetInstructions( ).size( ) );
+		if( saveIr != nullptr )
+		{
+			timing.Start( "save" );
+			if( !SaveImage( saveIr, compiler, true ) )
+				return 1;
+		}
+
+		timing.Start( run ? "run" : "emit" );
+		if( run )
+			status = Run( compiler.GetInstructions( ), symTable, passes.noreorder, model );
+		else if( elf != nullptr )
+			status = WriteObject( compiler, passes.noreorder, elf );
+		else
+			std::cout << compiler.GetAssembly( );
+	}
+
+	timing.Stop( );
+	if( timeJson )
+		timing.PrintJson( std::cerr );
+	else if( timeReport )
+		timing.Print( std::cerr );
+
+	return status;
+}
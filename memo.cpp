@@ -0,0 +1,107 @@
+#include "memo.hpp"
+
+namespace memo
+{
+
+Table::~Table( )
+{
+	Clear( );
+}
+
+Statistics Table::Generate( const node::Block *program, const symbol::Table &symTable, std::string &assembly )
+{
+	Statistics stats;
+	generation++;
+
+	instruction::List prologue;
+	node::GeneratePrologue( prologue, symTable );
+	for( instruction::Base *inst : prologue )
+	{
+		assembly += inst->ToString( );
+		delete inst;
+	}
+
+	uint32_t labels = 0;
+	entries.reserve( program->statements.size( ) );
+	for( const node::Statement *stmt : program->statements )
+	{
+		// a statement repeated within the program shares the entry too
+		Entry &entry = entries[stmt->Hash( )];
+		if( entry.generation != 0 )
+			stats.reused++;
+		else
+		{
+			Format( stmt, symTable, entry );
+			stats.generated++;
+		}
+
+		entry.generation = generation;
+		for( const Piece &piece : entry.pieces )
+		{
+			assembly += piece.text;
+			if( piece.labelled == nullptr )
+				continue;
+
+			// numbered from zero in the entry, moved after the labels before it for printing
+			instruction::Relabel( piece.labelled, labels );
+			assembly += piece.labelled->ToString( );
+			instruction::Relabel( piece.labelled, -labels );
+		}
+
+		labels += entry.labels;
+	}
+
+	for( auto entry = entries.begin( ); entry != entries.end( ); )
+	{
+		if( entry->second.generation == generation )
+			++entry;
+		else
+		{
+			for( const Piece &piece : entry->second.pieces )
+				delete piece.labelled;
+
+			entry = entries.erase( entry );
+		}
+	}
+
+	return stats;
+}
+
+void Table::Clear( )
+{
+	for( auto &entry : entries )
+	{
+		for( const Piece &piece : entry.second.pieces )
+			delete piece.labelled;
+	}
+
+	entries.clear( );
+}
+
+void Table::Format( const node::Statement *stmt, const symbol::Table &symTable, Entry &entry )
+{
+	instruction::List list;
+	stmt->GenerateInstructions( list, symTable );
+	entry.labels = list.GetLabelCount( );
+
+	Piece piece = { std::string( ), nullptr };
+	for( instruction::Base *inst : list )
+	{
+		instruction::Type type = inst->GetType( );
+		if( type == instruction::Type::Label || type == instruction::Type::Jump || type == instruction::Type::Branch )
+		{
+			piece.labelled = inst;
+			entry.pieces.push_back( piece );
+			piece = { std::string( ), nullptr };
+			continue;
+		}
+
+		piece.text += inst->ToString( );
+		delete inst;
+	}
+
+	if( !piece.text.empty( ) )
+		entry.pieces.push_back( piece );
+}
+
+}
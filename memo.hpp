@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "node.hpp"
+#include "symbol.hpp"
+#include "instruction.hpp"
+
+namespace memo
+{
+
+struct Statistics
+{
+	size_t reused = 0;
+	size_t generated = 0;
+};
+
+// assembly of the top-level statements of the last program, by the hash of
+// their tree (node::Base::Hash), so recompiling an edited program only
+// generates and formats the statements that changed; the others are copied
+// as text, with their labels renumbered for where they land now. Copying the
+// instructions instead would cost as much as generating them again
+class Table
+{
+public:
+	Table( ) = default;
+	~Table( );
+
+	Table( const Table & ) = delete;
+	Table &operator=( const Table & ) = delete;
+
+	// same as GetAssembly after generating program without passes, keeps
+	// only the statements of this program
+	Statistics Generate( const node::Block *program, const symbol::Table &symTable, std::string &assembly );
+	void Clear( );
+
+private:
+	// formatted instructions up to a labelled one, which is kept to print it
+	// with the labels of each use
+	struct Piece
+	{
+		std::string text;
+		instruction::Base *labelled;
+	};
+
+	struct Entry
+	{
+		std::vector<Piece> pieces;
+		uint32_t labels = 0;
+		// last program that used it
+		uint64_t generation = 0;
+	};
+
+	static void Format( const node::Statement *stmt, const symbol::Table &symTable, Entry &entry );
+
+	std::unordered_map<uint64_t, Entry> entries;
+	uint64_t generation = 0;
+};
+
+}
@@ -1,11 +1,15 @@
 #include "node.hpp"
 #include "common.hpp"
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
 
 namespace node
 {
 
-static std::map<instruction::Temporary, instruction::Temporary> next_temporary = {
+static const std::map<instruction::Temporary, instruction::Temporary> next_temporary = {
 	{ instruction::Temporary::Zero, instruction::Temporary::One },
 	{ instruction::Temporary::One, instruction::Temporary::Two },
 	{ instruction::Temporary::Two, instruction::Temporary::Three },
@@ -18,18 +22,313 @@ static std::map<instruction::Temporary, instruction::Temporary> next_temporary =
 	{ instruction::Temporary::Nine, instruction::Temporary::None },
 };
 
+// one per node class, so different nodes with the same children hash differently
+enum class Tag : uint64_t
+{
+	Boolean = 1,
+	Integer,
+	Identifier,
+	BinaryOperator,
+	Assignment,
+	Block,
+	ExpressionStatement,
+	IntegerDeclaration,
+	BooleanDeclaration,
+	IfThenElse,
+	WhileLoop
+};
+
+static uint64_t Mix( uint64_t hash, uint64_t value )
+{
+	hash = ( hash ^ value ) * 0x9E3779B97F4A7C15ULL;
+	return hash ^ ( hash >> 29 );
+}
+
+// find rather than operator[], which may insert and so can't be shared by codegen threads
+static instruction::Temporary NextTemporary( instruction::Temporary temporary )
+{
+	auto next = next_temporary.find( temporary );
+	return next != next_temporary.end( ) ? next->second : instruction::Temporary( );
+}
+
+// nodes being freed, each destructor adds its children here instead of
+// deleting them, so freeing a deep tree doesn't recurse
+static thread_local std::vector<Base *> released;
+static thread_local bool releasing = false;
+
+static void Release( Base *node )
+{
+	if( node == nullptr )
+		return;
+
+	released.push_back( node );
+	if( releasing )
+		return;
+
+	releasing = true;
+	while( !released.empty( ) )
+	{
+		Base *next = released.back( );
+		released.pop_back( );
+		delete next;
+	}
+
+	releasing = false;
+}
+
+// the walks keep the nodes still to visit on a stack: a node adds what it's
+// made of in order and the walk pushes that in reverse, so the first child is
+// visited next and everything after it once its whole subtree is done
+
+class Printer
+{
+public:
+	void Add( const Base *child )
+	{
+		pending.push_back( { child, std::string( ) } );
+	}
+
+	void Add( const std::string &text )
+	{
+		pending.push_back( { nullptr, text } );
+	}
+
+	std::string Run( const Base *root )
+	{
+		std::string text;
+		stack.push_back( { root, std::string( ) } );
+		while( !stack.empty( ) )
+		{
+			Item item = std::move( stack.back( ) );
+			stack.pop_back( );
+			if( item.node == nullptr )
+			{
+				text += item.text;
+				continue;
+			}
+
+			item.node->Print( *this );
+			stack.insert( stack.end( ), std::make_move_iterator( pending.rbegin( ) ), std::make_move_iterator( pending.rend( ) ) );
+			pending.clear( );
+		}
+
+		return text;
+	}
+
+private:
+	struct Item
+	{
+		// text when null
+		const Base *node;
+		std::string text;
+	};
+
+	std::vector<Item> stack;
+	std::vector<Item> pending;
+};
+
+class Generator
+{
+public:
+	Generator( instruction::List &list, const symbol::Table &symTable ) :
+		list( list ),
+		symTable( symTable )
+	{ }
+
+	void Add( const Base *child, instruction::Temporary temporary )
+	{
+		pending.push_back( { Item::Node, child, temporary, nullptr } );
+	}
+
+	void Add( instruction::Base *inst )
+	{
+		pending.push_back( { Item::Instruction, nullptr, instruction::Temporary::None, inst } );
+	}
+
+	// what is generated for a variable is its address, operands need the value
+	void AddLoad( instruction::Temporary temporary )
+	{
+		pending.push_back( { Item::Load, nullptr, temporary, nullptr } );
+	}
+
+	// for the labels and for code emitted before anything is added
+	instruction::List &GetList( )
+	{
+		return list;
+	}
+
+	const symbol::Table &GetSymbols( ) const
+	{
+		return symTable;
+	}
+
+	void Run( const Base *root, instruction::Temporary temporary )
+	{
+		stack.push_back( { Item::Node, root, temporary, nullptr } );
+		while( !stack.empty( ) )
+		{
+			Item item = stack.back( );
+			stack.pop_back( );
+			switch( item.kind )
+			{
+				case Item::Node:
+					item.node->Generate( *this, item.temporary );
+					stack.insert( stack.end( ), pending.rbegin( ), pending.rend( ) );
+					pending.clear( );
+					break;
+
+				case Item::Instruction:
+					list.push_back( item.inst );
+					break;
+
+				case Item::Load:
+					if( list.back( )->GetType( ) == instruction::Type::Address )
+						list.push_back( new instruction::Load( item.temporary, item.temporary ) );
+
+					break;
+			}
+		}
+	}
+
+private:
+	struct Item
+	{
+		enum Kind
+		{
+			Node,
+			Instruction,
+			Load
+		};
+
+		Kind kind;
+		const Base *node;
+		instruction::Temporary temporary;
+		instruction::Base *inst;
+	};
+
+	instruction::List &list;
+	const symbol::Table &symTable;
+	std::vector<Item> stack;
+	std::vector<Item> pending;
+};
+
+class Hasher
+{
+public:
+	// first, the hash of a node starts from its tag
+	void Add( Tag tag )
+	{
+		pending.push_back( { Item::Start, nullptr, static_cast<uint64_t>( tag ) } );
+	}
+
+	void Add( uint64_t value )
+	{
+		pending.push_back( { Item::Value, nullptr, value } );
+	}
+
+	// a missing child hashes as 0
+	void Add( const Base *child )
+	{
+		if( child == nullptr )
+			Add( static_cast<uint64_t>( 0 ) );
+		else
+			pending.push_back( { Item::Node, child, 0 } );
+	}
+
+	uint64_t Run( const Base *root )
+	{
+		uint64_t hash = 0;
+		stack.push_back( { Item::Node, root, 0 } );
+		while( !stack.empty( ) )
+		{
+			Item item = stack.back( );
+			stack.pop_back( );
+			switch( item.kind )
+			{
+				case Item::Node:
+					item.node->Digest( *this );
+					stack.push_back( { Item::End, nullptr, 0 } );
+					stack.insert( stack.end( ), pending.rbegin( ), pending.rend( ) );
+					pending.clear( );
+					break;
+
+				case Item::Start:
+					hashes.push_back( item.value );
+					break;
+
+				case Item::Value:
+					hashes.back( ) = Mix( hashes.back( ), item.value );
+					break;
+
+				// mixed into the node the child belongs to
+				case Item::End:
+					hash = hashes.back( );
+					hashes.pop_back( );
+					if( !hashes.empty( ) )
+						hashes.back( ) = Mix( hashes.back( ), hash );
+
+					break;
+			}
+		}
+
+		return hash;
+	}
+
+private:
+	struct Item
+	{
+		enum Kind
+		{
+			Node,
+			Start,
+			Value,
+			End
+		};
+
+		Kind kind;
+		const Base *node;
+		uint64_t value;
+	};
+
+	std::vector<Item> stack;
+	std::vector<Item> pending;
+	// of the nodes being hashed, innermost last
+	std::vector<uint64_t> hashes;
+};
+
+Base::~Base( )
+{ }
+
+std::string Base::ToString( ) const
+{
+	Printer printer;
+	return printer.Run( this );
+}
+
+void Base::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary temporary ) const
+{
+	Generator generator( list, symTable );
+	generator.Run( this, temporary );
+}
+
+uint64_t Base::Hash( ) const
+{
+	Hasher hasher;
+	return hasher.Run( this );
+}
+
 Boolean::Boolean( bool value ) :
 	value( value )
 { }
 
-std::string Boolean::ToString( ) const
+void Boolean::Print( Printer &printer ) const
 {
-	return value ? "true" : "false";
+	printer.Add( value ? "true" : "false" );
 }
 
-void Boolean::GenerateInstructions( instruction::List &list, const symbol::Table &, instruction::Temporary temporary ) const
+void Boolean::Generate( Generator &generator, instruction::Temporary temporary ) const
 {
-	list.push_back( new instruction::Constant( value, temporary ) );
+	generator.Add( new instruction::Constant( value, temporary ) );
 }
 
 symbol::Type Boolean::GetResultType( const symbol::Table &symTable ) const
@@ -37,18 +336,24 @@ symbol::Type Boolean::GetResultType( const symbol::Table &symTable ) const
 	return symbol::Type::Boolean;
 }
 
+void Boolean::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::Boolean );
+	hasher.Add( static_cast<uint64_t>( value ) );
+}
+
 Integer::Integer( int32_t value ) :
 	value( value )
 { }
 
-std::string Integer::ToString( ) const
+void Integer::Print( Printer &printer ) const
 {
-	return std::to_string( value );
+	printer.Add( std::to_string( value ) );
 }
 
-void Integer::GenerateInstructions( instruction::List &list, const symbol::Table &, instruction::Temporary temporary ) const
+void Integer::Generate( Generator &generator, instruction::Temporary temporary ) const
 {
-	list.push_back( new instruction::Constant( value, temporary ) );
+	generator.Add( new instruction::Constant( value, temporary ) );
 }
 
 symbol::Type Integer::GetResultType( const symbol::Table &symTable ) const
@@ -56,18 +361,24 @@ symbol::Type Integer::GetResultType( const symbol::Table &symTable ) const
 	return symbol::Type::Integer;
 }
 
+void Integer::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::Integer );
+	hasher.Add( static_cast<uint64_t>( static_cast<uint32_t>( value ) ) );
+}
+
 Identifier::Identifier( const std::string &name ) :
 	name( name )
 { }
 
-std::string Identifier::ToString( ) const
+void Identifier::Print( Printer &printer ) const
 {
-	return name;
+	printer.Add( name );
 }
 
-void Identifier::GenerateInstructions( instruction::List &list, const symbol::Table &, instruction::Temporary temporary ) const
+void Identifier::Generate( Generator &generator, instruction::Temporary temporary ) const
 {
-	list.push_back( new instruction::Address( name, temporary ) );
+	generator.Add( new instruction::Address( name, temporary ) );
 }
 
 symbol::Type Identifier::GetResultType( const symbol::Table &symTable ) const
@@ -75,149 +386,141 @@ symbol::Type Identifier::GetResultType( const symbol::Table &symTable ) const
 	return symTable.Get( name );
 }
 
+void Identifier::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::Identifier );
+	hasher.Add( static_cast<uint64_t>( std::hash<std::string>( )( name ) ) );
+}
+
 BinaryOperator::BinaryOperator( Expression *lhs, Code op, Expression *rhs ) :
 	lhs( lhs ), rhs( rhs ), op( op )
 { }
 
-std::string BinaryOperator::ToString( ) const
+BinaryOperator::~BinaryOperator( )
 {
-	std::map<BinaryOperator::Code, std::string> code_to_string = {
-		{ BinaryOperator::Addition, " + " },
-		{ BinaryOperator::Subtraction, " - " },
-		{ BinaryOperator::Multiplication, " * " },
-		{ BinaryOperator::Division, " / " },
-		{ BinaryOperator::Modulo, " % " },
-
-		{ BinaryOperator::Equal, " == " },
-		{ BinaryOperator::NotEqual, " != " },
-		{ BinaryOperator::LessThan, " < " },
-		{ BinaryOperator::LessEqual, " <= " },
-		{ BinaryOperator::GreaterThan, " > " },
-		{ BinaryOperator::GreaterEqual, " >= " },
+	Release( lhs );
+	Release( rhs );
+}
 
-		{ BinaryOperator::And, " && " },
-		{ BinaryOperator::Or, " || " }
-	};
+// in the order of BinaryOperator::Code
+static const char *const operator_strings[] = {
+	" + ", " - ", " * ", " / ", " % ",
+	" == ", " != ", " < ", " <= ", " > ", " >= ",
+	" && ", " || "
+};
 
-	return lhs->ToString( ) + code_to_string[op] + rhs->ToString( );
+void BinaryOperator::Print( Printer &printer ) const
+{
+	printer.Add( lhs );
+	printer.Add( operator_strings[op] );
+	printer.Add( rhs );
 }
 
-void BinaryOperator::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary temporary ) const
+static instruction::Base *NewOperation( BinaryOperator::Code op, instruction::Temporary left, instruction::Temporary right, instruction::Temporary result )
 {
-	instruction::Temporary temporary2 = next_temporary[temporary];
-	lhs->GenerateInstructions( list, symTable, temporary );
-
-	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( temporary, temporary ) );
-
-	rhs->GenerateInstructions( list, symTable, temporary2 );
-
-	address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( temporary2, temporary2 ) );
-
-	instruction::Base *inst = nullptr;
 	switch( op )
 	{
 		case BinaryOperator::Addition:
-			inst = new instruction::Add( temporary, temporary2, temporary );
-			break;
+			return new instruction::Add( left, right, result );
 
 		case BinaryOperator::Subtraction:
-			inst = new instruction::Subtract( temporary, temporary2, temporary );
-			break;
+			return new instruction::Subtract( left, right, result );
 
 		case BinaryOperator::Multiplication:
-			inst = new instruction::Multiply( temporary, temporary2, temporary );
-			break;
+			return new instruction::Multiply( left, right, result );
 
 		case BinaryOperator::Division:
-			inst = new instruction::Divide( temporary, temporary2, temporary );
-			break;
+			return new instruction::Divide( left, right, result );
 
 		case BinaryOperator::Modulo:
-			inst = new instruction::Modulo( temporary, temporary2, temporary );
-			break;
+			return new instruction::Modulo( left, right, result );
 
 		case BinaryOperator::Equal:
-			inst = new instruction::Equal( temporary, temporary2, temporary );
-			break;
+			return new instruction::Equal( left, right, result );
 
 		case BinaryOperator::NotEqual:
-			inst = new instruction::NotEqual( temporary, temporary2, temporary );
-			break;
+			return new instruction::NotEqual( left, right, result );
 
 		case BinaryOperator::LessThan:
-			inst = new instruction::LessThan( temporary, temporary2, temporary );
-			break;
+			return new instruction::LessThan( left, right, result );
 
 		case BinaryOperator::LessEqual:
-			inst = new instruction::LessEqual( temporary, temporary2, temporary );
-			break;
+			return new instruction::LessEqual( left, right, result );
 
 		case BinaryOperator::GreaterThan:
-			inst = new instruction::GreaterThan( temporary, temporary2, temporary );
-			break;
+			return new instruction::GreaterThan( left, right, result );
 
 		case BinaryOperator::GreaterEqual:
-			inst = new instruction::GreaterEqual( temporary, temporary2, temporary );
-			break;
+			return new instruction::GreaterEqual( left, right, result );
 
 		case BinaryOperator::And:
-			inst = new instruction::And( temporary, temporary2, temporary );
-			break;
+			return new instruction::And( left, right, result );
 
 		case BinaryOperator::Or:
-			inst = new instruction::Or( temporary, temporary2, temporary );
-			break;
+			return new instruction::Or( left, right, result );
+	}
+
+	return nullptr;
+}
+
+void BinaryOperator::Generate( Generator &generator, instruction::Temporary temporary ) const
+{
+	instruction::Temporary temporary2 = NextTemporary( temporary );
+	generator.Add( lhs, temporary );
+	generator.AddLoad( temporary );
+
+	// $t9 only ever holds a leaf: an operator on the right of one in $t8 is
+	// evaluated in $t8 again, with the left operand on the stack meanwhile
+	if( temporary2 == instruction::Temporary::Nine && dynamic_cast<const BinaryOperator *>( rhs ) != nullptr )
+	{
+		generator.Add( new instruction::Push( temporary ) );
+		generator.Add( rhs, temporary );
+		generator.Add( new instruction::Pop( temporary2 ) );
+		generator.Add( NewOperation( op, temporary2, temporary, temporary ) );
+		return;
 	}
 
-	list.push_back( inst );
+	generator.Add( rhs, temporary2 );
+	generator.AddLoad( temporary2 );
+	generator.Add( NewOperation( op, temporary, temporary2, temporary ) );
 }
 
+// arithmetic gives integers, comparisons and logic booleans
 symbol::Type BinaryOperator::GetResultType( const symbol::Table &symTable ) const
 {
-	std::map<BinaryOperator::Code, symbol::Type> operator_to_type = {
-		{ BinaryOperator::Addition, symbol::Type::Integer },
-		{ BinaryOperator::Subtraction, symbol::Type::Integer },
-		{ BinaryOperator::Multiplication, symbol::Type::Integer },
-		{ BinaryOperator::Division, symbol::Type::Integer },
-		{ BinaryOperator::Modulo, symbol::Type::Integer },
-
-		{ BinaryOperator::Equal, symbol::Type::Boolean },
-		{ BinaryOperator::NotEqual, symbol::Type::Boolean },
-		{ BinaryOperator::LessThan, symbol::Type::Boolean },
-		{ BinaryOperator::LessEqual, symbol::Type::Boolean },
-		{ BinaryOperator::GreaterThan, symbol::Type::Boolean },
-		{ BinaryOperator::GreaterEqual, symbol::Type::Boolean },
-
-		{ BinaryOperator::And, symbol::Type::Boolean },
-		{ BinaryOperator::Or, symbol::Type::Boolean }
-	};
+	return op <= BinaryOperator::Modulo ? symbol::Type::Integer : symbol::Type::Boolean;
+}
 
-	return operator_to_type[op];
+void BinaryOperator::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::BinaryOperator );
+	hasher.Add( static_cast<uint64_t>( op ) );
+	hasher.Add( lhs );
+	hasher.Add( rhs );
 }
 
 Assignment::Assignment( Identifier *lhs, Expression *rhs ) :
 	lhs( lhs ), rhs( rhs )
 { }
 
-std::string Assignment::ToString( ) const
+Assignment::~Assignment( )
 {
-	return lhs->ToString( ) + " = " + rhs->ToString( );
+	Release( lhs );
+	Release( rhs );
 }
 
-void Assignment::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+void Assignment::Print( Printer &printer ) const
 {
-	rhs->GenerateInstructions( list, symTable, instruction::Temporary::One );
-
-	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( instruction::Temporary::One, instruction::Temporary::One ) );
+	printer.Add( lhs->name + " = " );
+	printer.Add( rhs );
+}
 
-	lhs->GenerateInstructions( list, symTable, instruction::Temporary::Zero );
-	list.push_back( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+void Assignment::Generate( Generator &generator, instruction::Temporary ) const
+{
+	generator.Add( rhs, instruction::Temporary::One );
+	generator.AddLoad( instruction::Temporary::One );
+	generator.Add( new instruction::Address( lhs->name, instruction::Temporary::Zero ) );
+	generator.Add( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
 }
 
 symbol::Type Assignment::GetResultType( const symbol::Table &symTable ) const
@@ -225,38 +528,93 @@ symbol::Type Assignment::GetResultType( const symbol::Table &symTable ) const
 	return lhs->GetResultType( symTable );
 }
 
+void Assignment::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::Assignment );
+	hasher.Add( lhs );
+	hasher.Add( rhs );
+}
+
 Block::Block( )
 { }
 
-std::string Block::ToString( ) const
+Block::~Block( )
+{
+	for( Statement *statement : statements )
+		Release( statement );
+}
+
+void Block::Print( Printer &printer ) const
 {
-	std::string block = "{\n";
+	printer.Add( "{\n" );
 	for( const Statement *stmt : statements )
 	{
-		block += stmt->ToString( );
-		block += ";\n";
+		printer.Add( stmt );
+		printer.Add( ";\n" );
 	}
 
-	block += "}";
-	return block;
+	printer.Add( "}" );
 }
 
-void Block::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+void GeneratePrologue( instruction::List &list, const symbol::Table &symTable )
 {
+	if( !symTable.Empty( ) )
+	{
+		list.push_back( new instruction::Section( ".data" ) );
+		for( const std::string &name : symTable.GetNames( ) )
+			list.push_back( new instruction::Word( name ) );
+	}
+
+	list.push_back( new instruction::Section( ".text" ) );
+}
+
+void Block::Generate( Generator &generator, instruction::Temporary ) const
+{
+	if( generator.GetList( ).empty( ) )
+		GeneratePrologue( generator.GetList( ), generator.GetSymbols( ) );
+
+	for( const Statement *stmt : statements )
+		generator.Add( stmt, instruction::Temporary::Zero );
+}
+
+void Block::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, pool::ThreadPool &pool ) const
+{
+	// below this many statements per chunk the threads cost more than they save
+	const size_t minimumChunk = 256;
+
+	size_t chunks = std::min<size_t>( pool.GetSize( ) * 4, statements.size( ) / minimumChunk );
+	if( chunks < 2 )
+	{
+		GenerateInstructions( list, symTable );
+		return;
+	}
+
 	if( list.empty( ) )
+		GeneratePrologue( list, symTable );
+
+	// each chunk numbers its labels from zero in its own list, Append moves
+	// them after the ones before it so the result matches the serial order
+	std::vector<instruction::List> buffers( chunks );
+	StatementList::const_iterator begin = statements.begin( );
+	for( size_t i = 0; i < chunks; i++ )
 	{
-		if( !symTable.Empty( ) )
+		StatementList::const_iterator end = begin;
+		std::advance( end, ( statements.size( ) * ( i + 1 ) ) / chunks - ( statements.size( ) * i ) / chunks );
+
+		instruction::List *buffer = &buffers[i];
+		pool.Submit( [this, begin, end, buffer, &symTable]( )
 		{
-			list.push_back( new instruction::Custom( ".data\n" ) );
-			for( auto &pair : symTable.GetAll( ) )
-				list.push_back( new instruction::Custom( pair.first + ": .word 0\n" ) );
-		}
+			for( StatementList::const_iterator stmt = begin; stmt != end; ++stmt )
+				( *stmt )->GenerateInstructions( *buffer, symTable );
+		} );
 
-		list.push_back( new instruction::Custom( ".text\n" ) );
+		begin = end;
 	}
 
-	for( const Statement *stmt : statements )
-		stmt->GenerateInstructions( list, symTable );
+	pool.Wait( );
+
+	for( instruction::List &buffer : buffers )
+		list.Append( buffer );
 }
 
 symbol::Type Block::GetResultType( const symbol::Table &symTable ) const
@@ -264,18 +622,31 @@ symbol::Type Block::GetResultType( const symbol::Table &symTable ) const
 	return symbol::Type::None;
 }
 
+void Block::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::Block );
+	hasher.Add( static_cast<uint64_t>( statements.size( ) ) );
+	for( const Statement *stmt : statements )
+		hasher.Add( stmt );
+}
+
 ExpressionStatement::ExpressionStatement( Expression *expression ) :
 	expression( expression )
 { }
 
-std::string ExpressionStatement::ToString( ) const
+ExpressionStatement::~ExpressionStatement( )
+{
+	Release( expression );
+}
+
+void ExpressionStatement::Print( Printer &printer ) const
 {
-	return expression->ToString( );
+	printer.Add( expression );
 }
 
-void ExpressionStatement::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary temporary ) const
+void ExpressionStatement::Generate( Generator &generator, instruction::Temporary temporary ) const
 {
-	expression->GenerateInstructions( list, symTable, temporary );
+	generator.Add( expression, temporary );
 }
 
 symbol::Type ExpressionStatement::GetResultType( const symbol::Table &symTable ) const
@@ -283,6 +654,12 @@ symbol::Type ExpressionStatement::GetResultType( const symbol::Table &symTable )
 	return symbol::Type::None;
 }
 
+void ExpressionStatement::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::ExpressionStatement );
+	hasher.Add( expression );
+}
+
 IntegerDeclaration::IntegerDeclaration( Identifier *id ) :
 	id( id ), assignmentExpr( nullptr )
 { }
@@ -291,27 +668,33 @@ IntegerDeclaration::IntegerDeclaration( Identifier *id, Expression *assignmentEx
 	id( id ), assignmentExpr( assignmentExpr )
 { }
 
-std::string IntegerDeclaration::ToString( ) const
+IntegerDeclaration::~IntegerDeclaration( )
 {
-	if( assignmentExpr == nullptr )
-		return "int " + id->ToString( );
-
-	return "int " + id->ToString( ) + " = " + assignmentExpr->ToString( );
+	Release( id );
+	Release( assignmentExpr );
 }
 
-void IntegerDeclaration::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+void IntegerDeclaration::Print( Printer &printer ) const
 {
 	if( assignmentExpr == nullptr )
+	{
+		printer.Add( "int " + id->name );
 		return;
+	}
 
-	assignmentExpr->GenerateInstructions( list, symTable, instruction::Temporary::One );
+	printer.Add( "int " + id->name + " = " );
+	printer.Add( assignmentExpr );
+}
 
-	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( instruction::Temporary::One, instruction::Temporary::One ) );
+void IntegerDeclaration::Generate( Generator &generator, instruction::Temporary ) const
+{
+	if( assignmentExpr == nullptr )
+		return;
 
-	list.push_back( new instruction::Address( id->ToString( ), instruction::Temporary::Zero ) );
-	list.push_back( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+	generator.Add( assignmentExpr, instruction::Temporary::One );
+	generator.AddLoad( instruction::Temporary::One );
+	generator.Add( new instruction::Address( id->name, instruction::Temporary::Zero ) );
+	generator.Add( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
 }
 
 symbol::Type IntegerDeclaration::GetResultType( const symbol::Table &symTable ) const
@@ -319,6 +702,13 @@ symbol::Type IntegerDeclaration::GetResultType( const symbol::Table &symTable )
 	return symbol::Type::None;
 }
 
+void IntegerDeclaration::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::IntegerDeclaration );
+	hasher.Add( id );
+	hasher.Add( assignmentExpr );
+}
+
 BooleanDeclaration::BooleanDeclaration( Identifier *id ) :
 	id( id ), assignmentExpr( nullptr )
 { }
@@ -327,27 +717,33 @@ BooleanDeclaration::BooleanDeclaration( Identifier *id, Expression *assignmentEx
 	id( id ), assignmentExpr( assignmentExpr )
 { }
 
-std::string BooleanDeclaration::ToString( ) const
+BooleanDeclaration::~BooleanDeclaration( )
 {
-	if( assignmentExpr == nullptr )
-		return "bool " + id->ToString( );
-
-	return "bool " + id->ToString( ) + " = " + assignmentExpr->ToString( );
+	Release( id );
+	Release( assignmentExpr );
 }
 
-void BooleanDeclaration::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+void BooleanDeclaration::Print( Printer &printer ) const
 {
 	if( assignmentExpr == nullptr )
+	{
+		printer.Add( "bool " + id->name );
 		return;
+	}
 
-	assignmentExpr->GenerateInstructions( list, symTable, instruction::Temporary::One );
+	printer.Add( "bool " + id->name + " = " );
+	printer.Add( assignmentExpr );
+}
 
-	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( instruction::Temporary::One, instruction::Temporary::One ) );
+void BooleanDeclaration::Generate( Generator &generator, instruction::Temporary ) const
+{
+	if( assignmentExpr == nullptr )
+		return;
 
-	list.push_back( new instruction::Address( id->ToString( ), instruction::Temporary::Zero ) );
-	list.push_back( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+	generator.Add( assignmentExpr, instruction::Temporary::One );
+	generator.AddLoad( instruction::Temporary::One );
+	generator.Add( new instruction::Address( id->name, instruction::Temporary::Zero ) );
+	generator.Add( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
 }
 
 symbol::Type BooleanDeclaration::GetResultType( const symbol::Table &symTable ) const
@@ -355,41 +751,138 @@ symbol::Type BooleanDeclaration::GetResultType( const symbol::Table &symTable )
 	return symbol::Type::None;
 }
 
+void BooleanDeclaration::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::BooleanDeclaration );
+	hasher.Add( id );
+	hasher.Add( assignmentExpr );
+}
+
 IfThenElse::IfThenElse( Expression *testExpr, Block *successBlock, Block *failureBlock ) :
 	testExpr( testExpr ), successBlock( successBlock ), failureBlock( failureBlock )
 { }
 
-std::string IfThenElse::ToString( ) const
+IfThenElse::~IfThenElse( )
 {
-	if( failureBlock == nullptr )
-		return "if( " + testExpr->ToString( ) + " )\n" + successBlock->ToString( );
+	Release( testExpr );
+	Release( successBlock );
+	Release( failureBlock );
+}
 
-	return "if( " + testExpr->ToString( ) + " )\n" + successBlock->ToString( ) + "\nelse\n" + failureBlock->ToString( );
+void IfThenElse::Print( Printer &printer ) const
+{
+	printer.Add( "if( " );
+	printer.Add( testExpr );
+	printer.Add( " )\n" );
+	printer.Add( successBlock );
+	if( failureBlock != nullptr )
+	{
+		printer.Add( "\nelse\n" );
+		printer.Add( failureBlock );
+	}
 }
 
-void IfThenElse::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+// returns the only statement of the block if it is an assignment, nullptr otherwise
+static const Assignment *GetSoleAssignment( const Block *block )
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	std::string labelfail = "IfThenElse_Failure_" + labelnum;
-	std::string labelend = "IfThenElse_End_" + labelnum;
+	if( block == nullptr || block->statements.size( ) != 1 )
+		return nullptr;
 
-	testExpr->GenerateInstructions( list, symTable, instruction::Temporary::Zero );
+	return dynamic_cast<const Assignment *>( block->statements.front( ) );
+}
+
+// expressions that are cheap, can't fault and are generated without branches
+// can be evaluated unconditionally (leaves or a single operator over leaves)
+static bool IsSpeculatable( const Expression *expr, bool allowOperator = true )
+{
+	if( dynamic_cast<const Boolean *>( expr ) != nullptr ||
+		dynamic_cast<const Integer *>( expr ) != nullptr ||
+		dynamic_cast<const Identifier *>( expr ) != nullptr )
+		return true;
+
+	const BinaryOperator *binop = dynamic_cast<const BinaryOperator *>( expr );
+	if( !allowOperator || binop == nullptr )
+		return false;
+
+	switch( binop->op )
+	{
+		case BinaryOperator::Addition:
+		case BinaryOperator::Subtraction:
+		case BinaryOperator::Multiplication:
+		case BinaryOperator::LessThan:
+		case BinaryOperator::And:
+		case BinaryOperator::Or:
+			return IsSpeculatable( binop->lhs, false ) && IsSpeculatable( binop->rhs, false );
+
+		default:
+			return false;
+	}
+}
+
+// if-conversion: turns "if( c ) x = a; else x = b;" (or "if( c ) x = a;") into
+// a branchless select using MOVZ, returns false if the diamond isn't eligible
+static bool GenerateSelect( const IfThenElse *ifthenelse, instruction::List &list, const symbol::Table &symTable )
+{
+	const Assignment *success = GetSoleAssignment( ifthenelse->successBlock );
+	if( success == nullptr || !IsSpeculatable( success->rhs ) )
+		return false;
+
+	const Assignment *failure = nullptr;
+	if( ifthenelse->failureBlock != nullptr )
+	{
+		failure = GetSoleAssignment( ifthenelse->failureBlock );
+		if( failure == nullptr || failure->lhs->name != success->lhs->name || !IsSpeculatable( failure->rhs ) )
+			return false;
+	}
+
+	ifthenelse->testExpr->GenerateInstructions( list, symTable, instruction::Temporary::Zero );
 
 	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
 	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
 		list.push_back( new instruction::Load( instruction::Temporary::Zero, instruction::Temporary::Zero ) );
 
-	list.push_back( new instruction::BranchEqual( instruction::Temporary::Zero, 0, failureBlock == nullptr ? labelend : labelfail ) );
-	successBlock->GenerateInstructions( list, symTable );
+	success->rhs->GenerateInstructions( list, symTable, instruction::Temporary::One );
+
+	address = dynamic_cast<instruction::Address *>( list.back( ) );
+	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
+		list.push_back( new instruction::Load( instruction::Temporary::One, instruction::Temporary::One ) );
+
+	// without an else block the variable keeps its current value
+	const Expression *otherwise = failure != nullptr ? failure->rhs : success->lhs;
+	otherwise->GenerateInstructions( list, symTable, instruction::Temporary::Two );
+
+	address = dynamic_cast<instruction::Address *>( list.back( ) );
+	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
+		list.push_back( new instruction::Load( instruction::Temporary::Two, instruction::Temporary::Two ) );
+
+	list.push_back( new instruction::MoveIfZero( instruction::Temporary::Two, instruction::Temporary::Zero, instruction::Temporary::One ) );
+	success->lhs->GenerateInstructions( list, symTable, instruction::Temporary::Zero );
+	list.push_back( new instruction::Save( instruction::Temporary::One, instruction::Temporary::Zero ) );
+	return true;
+}
+
+void IfThenElse::Generate( Generator &generator, instruction::Temporary ) const
+{
+	instruction::List &list = generator.GetList( );
+	if( GenerateSelect( this, list, generator.GetSymbols( ) ) )
+		return;
+
+	uint32_t labelfail = list.NewLabel( );
+	uint32_t labelend = list.NewLabel( );
+
+	generator.Add( testExpr, instruction::Temporary::Zero );
+	generator.AddLoad( instruction::Temporary::Zero );
+	generator.Add( new instruction::BranchEqual( instruction::Temporary::Zero, 0, failureBlock == nullptr ? labelend : labelfail ) );
+	generator.Add( successBlock, instruction::Temporary::Zero );
 
 	if( failureBlock != nullptr )
 	{
-		list.push_back( new instruction::Label( labelfail ) );
-		failureBlock->GenerateInstructions( list, symTable );
+		generator.Add( new instruction::Jump( labelend ) );
+		generator.Add( new instruction::Label( labelfail ) );
+		generator.Add( failureBlock, instruction::Temporary::Zero );
 	}
 
-	list.push_back( new instruction::Label( labelend ) );
+	generator.Add( new instruction::Label( labelend ) );
 }
 
 symbol::Type IfThenElse::GetResultType( const symbol::Table &symTable ) const
@@ -397,33 +890,44 @@ symbol::Type IfThenElse::GetResultType( const symbol::Table &symTable ) const
 	return symbol::Type::None;
 }
 
+void IfThenElse::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::IfThenElse );
+	hasher.Add( testExpr );
+	hasher.Add( successBlock );
+	hasher.Add( failureBlock );
+}
+
 WhileLoop::WhileLoop( Expression *testExpr, Block *successBlock ) :
 	testExpr( testExpr ), successBlock( successBlock )
 { }
 
-std::string WhileLoop::ToString( ) const
+WhileLoop::~WhileLoop( )
 {
-	return "while( " + testExpr->ToString( ) + " )\n" + successBlock->ToString( );
+	Release( testExpr );
+	Release( successBlock );
 }
 
-void WhileLoop::GenerateInstructions( instruction::List &list, const symbol::Table &symTable, instruction::Temporary ) const
+void WhileLoop::Print( Printer &printer ) const
 {
-	static uint32_t labels = 0;
-	std::string labelnum = std::to_string( labels++ );
-	std::string labelstart = "WhileLoop_Start_" + labelnum;
-	std::string labelend = "WhileLoop_End_" + labelnum;
-
-	list.push_back( new instruction::Label( labelstart ) );
-	testExpr->GenerateInstructions( list, symTable, instruction::Temporary::Zero );
+	printer.Add( "while( " );
+	printer.Add( testExpr );
+	printer.Add( " )\n" );
+	printer.Add( successBlock );
+}
 
-	instruction::Address *address = dynamic_cast<instruction::Address *>( list.back( ) );
-	if( address != nullptr && address->GetType( ) == instruction::Type::Address )
-		list.push_back( new instruction::Load( instruction::Temporary::Zero, instruction::Temporary::Zero ) );
+void WhileLoop::Generate( Generator &generator, instruction::Temporary ) const
+{
+	uint32_t labelstart = generator.GetList( ).NewLabel( );
+	uint32_t labelend = generator.GetList( ).NewLabel( );
 
-	list.push_back( new instruction::BranchEqual( instruction::Temporary::Zero, 0, labelend ) );
-	successBlock->GenerateInstructions( list, symTable );
-	list.push_back( new instruction::Jump( labelstart ) );
-	list.push_back( new instruction::Label( labelend ) );
+	generator.Add( new instruction::Label( labelstart ) );
+	generator.Add( testExpr, instruction::Temporary::Zero );
+	generator.AddLoad( instruction::Temporary::Zero );
+	generator.Add( new instruction::BranchEqual( instruction::Temporary::Zero, 0, labelend ) );
+	generator.Add( successBlock, instruction::Temporary::Zero );
+	generator.Add( new instruction::Jump( labelstart ) );
+	generator.Add( new instruction::Label( labelend ) );
 }
 
 symbol::Type WhileLoop::GetResultType( const symbol::Table &symTable ) const
@@ -431,4 +935,11 @@ symbol::Type WhileLoop::GetResultType( const symbol::Table &symTable ) const
 	return symbol::Type::None;
 }
 
+void WhileLoop::Digest( Hasher &hasher ) const
+{
+	hasher.Add( Tag::WhileLoop );
+	hasher.Add( testExpr );
+	hasher.Add( successBlock );
+}
+
 }
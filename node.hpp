@@ -8,6 +8,7 @@
 #include <sstream>
 #include "instruction.hpp"
 #include "symbol.hpp"
+#include "pool.hpp"
 
 namespace node
 {
@@ -15,21 +16,45 @@ namespace node
 class Statement;
 class Expression;
 class VariableDeclaration;
+class Printer;
+class Generator;
+class Hasher;
 
 typedef std::list<Statement *> StatementList;
 typedef std::list<Expression *> ExpressionList;
 typedef std::list<VariableDeclaration *> VariableList;
 
+// .data with every variable followed by .text, what every program starts with
+void GeneratePrologue( instruction::List &list, const symbol::Table &symTable );
+
 class Base
 {
 public:
-	virtual std::string ToString( ) const = 0;
-	virtual void GenerateInstructions(
+	// nodes own their children, freed without recursing however deep they nest
+	virtual ~Base( );
+
+	// these walk the subtree on a stack of their own rather than the native
+	// one, so the depth of a tree is only limited by memory
+	std::string ToString( ) const;
+	void GenerateInstructions(
 		instruction::List &list,
 		const symbol::Table &symTable,
 		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const = 0;
+	) const;
 	virtual symbol::Type GetResultType( const symbol::Table &symTable ) const = 0;
+	// structural hash of the subtree, the generated code only depends on what it hashes
+	uint64_t Hash( ) const;
+
+protected:
+	friend class Printer;
+	friend class Generator;
+	friend class Hasher;
+
+	// one node of each walk: what the node is made of, in order, its children
+	// are only added to the walk, which visits them after this returns
+	virtual void Print( Printer &printer ) const = 0;
+	virtual void Generate( Generator &generator, instruction::Temporary temporary ) const = 0;
+	virtual void Digest( Hasher &hasher ) const = 0;
 };
 
 class Expression : public Base
@@ -43,15 +68,14 @@ class Boolean : public Expression
 public:
 	Boolean( bool value );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	bool value;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class Integer : public Expression
@@ -59,15 +83,14 @@ class Integer : public Expression
 public:
 	Integer( int32_t value );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	int32_t value;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class Identifier : public Expression
@@ -75,15 +98,14 @@ class Identifier : public Expression
 public:
 	Identifier( const std::string &name );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	std::string name;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class BinaryOperator : public Expression
@@ -109,67 +131,70 @@ public:
 	};
 
 	BinaryOperator( Expression *lhs, Code op, Expression *rhs );
+	~BinaryOperator( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Expression *lhs;
 	Expression *rhs;
 	Code op;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class Assignment : public Statement
 {
 public:
 	Assignment( Identifier *lhs, Expression *rhs );
+	~Assignment( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Identifier *lhs;
 	Expression *rhs;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class Block : public Expression
 {
 public:
 	Block( );
+	~Block( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
+	using Base::GenerateInstructions;
+	// same instructions, with the top-level statements split into chunks generated on pool
+	void GenerateInstructions( instruction::List &list, const symbol::Table &symTable, pool::ThreadPool &pool ) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	StatementList statements;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class ExpressionStatement : public Statement
 {
 public:
 	ExpressionStatement( Expression *expression );
+	~ExpressionStatement( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Expression *expression;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class IntegerDeclaration : public Statement
@@ -178,17 +203,17 @@ public:
 	IntegerDeclaration( Identifier *id );
 
 	IntegerDeclaration( Identifier *id, Expression *assignmentExpr );
+	~IntegerDeclaration( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Identifier *id;
 	Expression *assignmentExpr;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class BooleanDeclaration : public Statement
@@ -197,52 +222,52 @@ public:
 	BooleanDeclaration( Identifier *id );
 
 	BooleanDeclaration( Identifier *id, Expression *assignmentExpr );
+	~BooleanDeclaration( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Identifier *id;
 	Expression *assignmentExpr;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class IfThenElse : public Statement
 {
 public:
 	IfThenElse( Expression *testExpr, Block *successBlock, Block *failureBlock );
+	~IfThenElse( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Expression *testExpr;
 	Block *successBlock;
 	Block *failureBlock;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 class WhileLoop : public Statement
 {
 public:
 	WhileLoop( Expression *testExpr, Block *successBlock );
+	~WhileLoop( );
 
-	std::string ToString( ) const;
-	void GenerateInstructions(
-		instruction::List &list,
-		const symbol::Table &symTable,
-		instruction::Temporary temporary = instruction::Temporary::Zero
-	) const;
 	symbol::Type GetResultType( const symbol::Table &symTable ) const;
 
 	Expression *testExpr;
 	Block *successBlock;
+
+protected:
+	void Print( Printer &printer ) const;
+	void Generate( Generator &generator, instruction::Temporary temporary ) const;
+	void Digest( Hasher &hasher ) const;
 };
 
 }
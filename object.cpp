@@ -0,0 +1,468 @@
+#include "object.hpp"
+
+namespace object
+{
+
+enum RelocationType : uint8_t
+{
+	R_MIPS_26 = 4,
+	R_MIPS_HI16 = 5,
+	R_MIPS_LO16 = 6,
+	R_MIPS_GPREL16 = 7
+};
+
+static const uint8_t temporary_register[] = { 8, 9, 10, 11, 12, 13, 14, 15, 24, 25 };
+
+// the gp value the GPREL16 addends assume, 0x7ff0 into .sdata so they reach
+// 64 KB of it; the linker adds it back for the section symbols they refer to
+static const uint32_t SmallDataBias = 0x7FF0;
+
+static void Put16( std::vector<uint8_t> &bytes, uint16_t value )
+{
+	bytes.push_back( static_cast<uint8_t>( value >> 8 ) );
+	bytes.push_back( static_cast<uint8_t>( value ) );
+}
+
+static void Put32( std::vector<uint8_t> &bytes, uint32_t value )
+{
+	Put16( bytes, static_cast<uint16_t>( value >> 16 ) );
+	Put16( bytes, static_cast<uint16_t>( value ) );
+}
+
+static void Align( std::vector<uint8_t> &bytes, size_t alignment )
+{
+	while( bytes.size( ) % alignment != 0 )
+		bytes.push_back( 0 );
+}
+
+static uint32_t AddString( std::vector<uint8_t> &table, const std::string &string )
+{
+	uint32_t offset = static_cast<uint32_t>( table.size( ) );
+	table.insert( table.end( ), string.begin( ), string.end( ) );
+	table.push_back( 0 );
+	return offset;
+}
+
+Encoder::Encoder( bool delaySlots ) :
+	delaySlots( delaySlots ),
+	noreorder( false ),
+	atUsed( false ),
+	current( -1 ),
+	usedRegisters( 0 )
+{ }
+
+bool Encoder::Encode( const instruction::List &list, std::vector<uint8_t> &object, std::string &error )
+{
+	for( const instruction::Base *inst : list )
+	{
+		atUsed = false;
+		inst->Encode( *this );
+		if( !this->error.empty( ) )
+			break;
+	}
+
+	for( auto &pair : pending )
+		if( this->error.empty( ) && !pair.second.empty( ) )
+			Unsupported( "undefined label " + instruction::LabelToString( pair.first ) );
+
+	for( const DataFixup &fixup : dataFixups )
+	{
+		auto it = symbols.find( fixup.symbol );
+		if( it == symbols.end( ) )
+		{
+			Unsupported( "undefined symbol " + fixup.symbol );
+			break;
+		}
+
+		// REL relocations keep the addend (the offset in the section) in the instruction
+		uint32_t offset = it->second.offset;
+		if( fixup.type == R_MIPS_HI16 )
+			Patch( fixup.offset, 0xFFFF, ( offset + 0x8000 ) >> 16 );
+		else if( fixup.type == R_MIPS_GPREL16 )
+		{
+			// a signed 16-bit offset from the gp value .reginfo gives
+			if( offset >= SmallDataBias + 0x8000 )
+			{
+				Unsupported( "%gp_rel offset of " + fixup.symbol + " out of range" );
+				break;
+			}
+
+			Patch( fixup.offset, 0xFFFF, offset - SmallDataBias );
+		}
+		else
+			Patch( fixup.offset, 0xFFFF, offset );
+
+		relocations.push_back( { fixup.offset, static_cast<uint32_t>( 2 + it->second.section ), fixup.type } );
+	}
+
+	if( !this->error.empty( ) )
+	{
+		error = this->error;
+		return false;
+	}
+
+	Write( object );
+	return true;
+}
+
+uint8_t Encoder::Register( const instruction::Variable &variable )
+{
+	switch( variable.GetType( ) )
+	{
+		case instruction::Variable::Type::Register:
+		{
+			int32_t temporary = static_cast<int32_t>( variable.GetTemporary( ) );
+			if( temporary < 0 || temporary >= static_cast<int32_t>( sizeof( temporary_register ) ) )
+			{
+				Unsupported( "invalid register operand" );
+				return Zero;
+			}
+
+			uint8_t reg = temporary_register[temporary];
+			usedRegisters |= 1u << reg;
+			return reg;
+		}
+
+		case instruction::Variable::Type::Constant:
+			if( variable.GetInteger( ) == 0 )
+				return Zero;
+
+			// like the assembler, other constants go through $at
+			if( atUsed )
+			{
+				Unsupported( "more than one constant operand" );
+				return Zero;
+			}
+
+			atUsed = true;
+			LoadImmediate( AssemblerTemporary, variable.GetInteger( ) );
+			return AssemblerTemporary;
+
+		default:
+			Unsupported( "operand " + variable.ToString( ) + " isn't a register" );
+			return Zero;
+	}
+}
+
+void Encoder::Emit( uint32_t word )
+{
+	Put32( text, word );
+}
+
+void Encoder::EmitRegister( uint32_t function, uint8_t rs, uint8_t rt, uint8_t rd )
+{
+	Emit( ( static_cast<uint32_t>( rs ) << 21 ) | ( static_cast<uint32_t>( rt ) << 16 ) | ( static_cast<uint32_t>( rd ) << 11 ) | function );
+}
+
+void Encoder::EmitImmediate( uint32_t opcode, uint8_t rs, uint8_t rt, int32_t immediate )
+{
+	Emit( ( opcode << 26 ) | ( static_cast<uint32_t>( rs ) << 21 ) | ( static_cast<uint32_t>( rt ) << 16 ) | ( static_cast<uint32_t>( immediate ) & 0xFFFF ) );
+}
+
+// same expansion sizes as instruction::Constant::GetSize
+void Encoder::LoadImmediate( uint8_t reg, int32_t value )
+{
+	if( value >= -32768 && value <= 32767 )
+		EmitImmediate( 0x09, Zero, reg, value );
+	else if( value >= 0 && value <= 65535 )
+		EmitImmediate( 0x0D, Zero, reg, value );
+	else
+	{
+		EmitImmediate( 0x0F, Zero, reg, static_cast<int32_t>( static_cast<uint32_t>( value ) >> 16 ) );
+		EmitImmediate( 0x0D, reg, reg, value & 0xFFFF );
+	}
+}
+
+void Encoder::LoadAddress( uint8_t reg, const std::string &symbol )
+{
+	dataFixups.push_back( { static_cast<uint32_t>( text.size( ) ), R_MIPS_HI16, symbol } );
+	EmitImmediate( 0x0F, Zero, reg, 0 );
+	dataFixups.push_back( { static_cast<uint32_t>( text.size( ) ), R_MIPS_LO16, symbol } );
+	EmitImmediate( 0x09, reg, reg, 0 );
+}
+
+void Encoder::AdjustStack( int32_t bytes )
+{
+	EmitImmediate( 0x09, StackPointer, StackPointer, bytes );
+	usedRegisters |= 1u << StackPointer;
+}
+
+void Encoder::Memory( uint32_t opcode, uint8_t rt, const instruction::Variable &address )
+{
+	if( address.GetType( ) == instruction::Variable::Type::Memory )
+	{
+		dataFixups.push_back( { static_cast<uint32_t>( text.size( ) ), R_MIPS_GPREL16, address.GetAddress( ) } );
+		EmitImmediate( opcode, GlobalPointer, rt, 0 );
+		usedRegisters |= 1u << GlobalPointer;
+	}
+	else
+		EmitImmediate( opcode, Register( address ), rt, 0 );
+}
+
+void Encoder::Jump( uint32_t label )
+{
+	LabelFixup fixup = { static_cast<uint32_t>( text.size( ) ), true };
+	Emit( 0x02u << 26 );
+
+	// J is absolute, so it's relocated against .text with the target as addend
+	relocations.push_back( { fixup.offset, 1, R_MIPS_26 } );
+
+	auto it = labels.find( label );
+	if( it != labels.end( ) )
+		Resolve( fixup, it->second );
+	else
+		pending[label].push_back( fixup );
+
+	if( !delaySlots )
+		Emit( 0 );
+}
+
+void Encoder::Branch( uint32_t opcode, uint8_t rs, uint8_t rt, uint32_t label )
+{
+	LabelFixup fixup = { static_cast<uint32_t>( text.size( ) ), false };
+	EmitImmediate( opcode, rs, rt, 0 );
+
+	auto it = labels.find( label );
+	if( it != labels.end( ) )
+		Resolve( fixup, it->second );
+	else
+		pending[label].push_back( fixup );
+
+	if( !delaySlots )
+		Emit( 0 );
+}
+
+void Encoder::Label( uint32_t label )
+{
+	uint32_t target = static_cast<uint32_t>( text.size( ) );
+	labels[label] = target;
+
+	auto it = pending.find( label );
+	if( it == pending.end( ) )
+		return;
+
+	for( const LabelFixup &fixup : it->second )
+		Resolve( fixup, target );
+
+	pending.erase( it );
+}
+
+void Encoder::Directive( const std::string &directive )
+{
+	if( directive == ".set noreorder\n" )
+		noreorder = true;
+	else if( directive != ".set reorder\n" )
+		Unsupported( "directive " + directive );
+}
+
+void Encoder::Section( const std::string &name )
+{
+	if( name == ".text" )
+	{
+		current = -1;
+		return;
+	}
+
+	for( size_t i = 0; i < data.size( ); ++i )
+	{
+		if( data[i].name == name )
+		{
+			current = static_cast<int32_t>( i );
+			return;
+		}
+	}
+
+	data.push_back( { name, { } } );
+	current = static_cast<int32_t>( data.size( ) - 1 );
+}
+
+void Encoder::Word( const std::string &label, int32_t value )
+{
+	if( current < 0 )
+	{
+		Unsupported( "data word in .text" );
+		return;
+	}
+
+	DataSection &section = data[current];
+	symbols[label] = { static_cast<size_t>( current ), static_cast<uint32_t>( section.bytes.size( ) ) };
+	symbolOrder.push_back( label );
+	Put32( section.bytes, static_cast<uint32_t>( value ) );
+}
+
+void Encoder::Unsupported( const std::string &what )
+{
+	if( error.empty( ) )
+		error = what;
+}
+
+void Encoder::Patch( uint32_t offset, uint32_t mask, uint32_t value )
+{
+	uint32_t word = ( static_cast<uint32_t>( text[offset] ) << 24 ) | ( static_cast<uint32_t>( text[offset + 1] ) << 16 ) |
+		( static_cast<uint32_t>( text[offset + 2] ) << 8 ) | text[offset + 3];
+	word = ( word & ~mask ) | ( value & mask );
+	text[offset] = static_cast<uint8_t>( word >> 24 );
+	text[offset + 1] = static_cast<uint8_t>( word >> 16 );
+	text[offset + 2] = static_cast<uint8_t>( word >> 8 );
+	text[offset + 3] = static_cast<uint8_t>( word );
+}
+
+// branches reach 32K words either way from their delay slot, jumps the 256 MB
+// region, the assembler doesn't relax either so neither do we
+void Encoder::Resolve( const LabelFixup &fixup, uint32_t target )
+{
+	if( fixup.jump )
+	{
+		if( target >= 0x10000000 )
+			Unsupported( "jump at " + std::to_string( fixup.offset ) + " out of range" );
+		else
+			Patch( fixup.offset, 0x03FFFFFF, target >> 2 );
+
+		return;
+	}
+
+	int32_t words = ( static_cast<int32_t>( target ) - static_cast<int32_t>( fixup.offset + 4 ) ) / 4;
+	if( words < -32768 || words > 32767 )
+		Unsupported( "branch at " + std::to_string( fixup.offset ) + " out of range" );
+	else
+		Patch( fixup.offset, 0xFFFF, static_cast<uint32_t>( words ) );
+}
+
+void Encoder::Write( std::vector<uint8_t> &object )
+{
+	enum
+	{
+		SHT_PROGBITS = 1,
+		SHT_SYMTAB = 2,
+		SHT_STRTAB = 3,
+		SHT_REL = 9,
+		SHT_MIPS_REGINFO = 0x70000006
+	};
+
+	enum
+	{
+		SHF_WRITE = 0x1,
+		SHF_ALLOC = 0x2,
+		SHF_EXECINSTR = 0x4,
+		SHF_INFO_LINK = 0x40,
+		SHF_MIPS_GPREL = 0x10000000
+	};
+
+	struct SectionHeader
+	{
+		uint32_t name, type, flags, offset, size, link, info, alignment, entrySize;
+	};
+
+	// section indices: null, .text, data sections, .reginfo, .rel.text, .symtab, .strtab, .shstrtab
+	uint32_t reginfoIndex = static_cast<uint32_t>( 2 + data.size( ) );
+	uint32_t relIndex = reginfoIndex + 1;
+	uint32_t symtabIndex = relIndex + 1;
+	uint32_t strtabIndex = symtabIndex + 1;
+	uint32_t shstrtabIndex = strtabIndex + 1;
+
+	std::vector<uint8_t> shstrtab( 1, 0 );
+	std::vector<uint8_t> strtab( 1, 0 );
+	std::vector<SectionHeader> headers( 1, SectionHeader( ) );
+
+	object.assign( 52, 0 );
+
+	headers.push_back( { AddString( shstrtab, ".text" ), SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR,
+		static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( text.size( ) ), 0, 0, 4, 0 } );
+	object.insert( object.end( ), text.begin( ), text.end( ) );
+
+	for( const DataSection &section : data )
+	{
+		uint32_t flags = SHF_ALLOC | SHF_WRITE | ( section.name == ".sdata" ? SHF_MIPS_GPREL : 0 );
+		headers.push_back( { AddString( shstrtab, section.name ), SHT_PROGBITS, flags,
+			static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( section.bytes.size( ) ), 0, 0, 4, 0 } );
+		object.insert( object.end( ), section.bytes.begin( ), section.bytes.end( ) );
+	}
+
+	// registers used and the gp value the GPREL16 addends assume
+	headers.push_back( { AddString( shstrtab, ".reginfo" ), SHT_MIPS_REGINFO, SHF_ALLOC,
+		static_cast<uint32_t>( object.size( ) ), 24, 0, 0, 4, 24 } );
+	Put32( object, usedRegisters );
+	for( int32_t i = 0; i < 4; ++i )
+		Put32( object, 0 );
+
+	Put32( object, SmallDataBias );
+
+	headers.push_back( { AddString( shstrtab, ".rel.text" ), SHT_REL, SHF_INFO_LINK,
+		static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( relocations.size( ) * 8 ), symtabIndex, 1, 4, 8 } );
+	for( const Relocation &relocation : relocations )
+	{
+		Put32( object, relocation.offset );
+		Put32( object, ( relocation.symbol << 8 ) | relocation.type );
+	}
+
+	// null, .text and data section symbols, then the variables (all local)
+	std::vector<uint8_t> symtab( 16, 0 );
+	auto symbol = [&symtab]( uint32_t name, uint32_t value, uint32_t size, uint8_t info, uint16_t section )
+	{
+		Put32( symtab, name );
+		Put32( symtab, value );
+		Put32( symtab, size );
+		symtab.push_back( info );
+		symtab.push_back( 0 );
+		Put16( symtab, section );
+	};
+
+	symbol( 0, 0, 0, 3, 1 );
+	for( size_t i = 0; i < data.size( ); ++i )
+		symbol( 0, 0, 0, 3, static_cast<uint16_t>( 2 + i ) );
+
+	for( const std::string &name : symbolOrder )
+	{
+		const Symbol &sym = symbols[name];
+		symbol( AddString( strtab, name ), sym.offset, 4, 1, static_cast<uint16_t>( 2 + sym.section ) );
+	}
+
+	headers.push_back( { AddString( shstrtab, ".symtab" ), SHT_SYMTAB, 0,
+		static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( symtab.size( ) ), strtabIndex,
+		static_cast<uint32_t>( symtab.size( ) / 16 ), 4, 16 } );
+	object.insert( object.end( ), symtab.begin( ), symtab.end( ) );
+
+	headers.push_back( { AddString( shstrtab, ".strtab" ), SHT_STRTAB, 0,
+		static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( strtab.size( ) ), 0, 0, 1, 0 } );
+	object.insert( object.end( ), strtab.begin( ), strtab.end( ) );
+
+	uint32_t shstrtabName = AddString( shstrtab, ".shstrtab" );
+	headers.push_back( { shstrtabName, SHT_STRTAB, 0,
+		static_cast<uint32_t>( object.size( ) ), static_cast<uint32_t>( shstrtab.size( ) ), 0, 0, 1, 0 } );
+	object.insert( object.end( ), shstrtab.begin( ), shstrtab.end( ) );
+
+	Align( object, 4 );
+	uint32_t sectionHeaders = static_cast<uint32_t>( object.size( ) );
+	for( const SectionHeader &header : headers )
+	{
+		Put32( object, header.name );
+		Put32( object, header.type );
+		Put32( object, header.flags );
+		Put32( object, 0 );
+		Put32( object, header.offset );
+		Put32( object, header.size );
+		Put32( object, header.link );
+		Put32( object, header.info );
+		Put32( object, header.alignment );
+		Put32( object, header.entrySize );
+	}
+
+	// ELF header: 32-bit, big endian, relocatable, MIPS, o32 ABI, MIPS32
+	std::vector<uint8_t> header = { 0x7F, 'E', 'L', 'F', 1, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	Put16( header, 1 );
+	Put16( header, 8 );
+	Put32( header, 1 );
+	Put32( header, 0 );
+	Put32( header, 0 );
+	Put32( header, sectionHeaders );
+	Put32( header, 0x50001000 | ( noreorder ? 1 : 0 ) );
+	Put16( header, 52 );
+	Put16( header, 0 );
+	Put16( header, 0 );
+	Put16( header, 40 );
+	Put16( header, static_cast<uint16_t>( headers.size( ) ) );
+	Put16( header, static_cast<uint16_t>( shstrtabIndex ) );
+	std::copy( header.begin( ), header.end( ), object.begin( ) );
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "instruction.hpp"
+
+namespace object
+{
+
+// encodes an instruction list to big endian MIPS32 machine code in a single
+// pass (label fixups are backpatched as labels get defined) and writes it as
+// a relocatable ELF32 object with .text, the data sections, .reginfo, a
+// symbol table and .rel.text
+class Encoder
+{
+public:
+	// delaySlots tells if the list fills its own delay slots (.set noreorder),
+	// otherwise a NOP goes after every branch and jump like the assembler does
+	Encoder( bool delaySlots );
+
+	bool Encode( const instruction::List &list, std::vector<uint8_t> &object, std::string &error );
+
+	// used by instruction::Base::Encode
+	uint8_t Register( const instruction::Variable &variable );
+	void Emit( uint32_t word );
+	void EmitRegister( uint32_t function, uint8_t rs, uint8_t rt, uint8_t rd );
+	void EmitImmediate( uint32_t opcode, uint8_t rs, uint8_t rt, int32_t immediate );
+	void LoadImmediate( uint8_t reg, int32_t value );
+	void LoadAddress( uint8_t reg, const std::string &symbol );
+	void AdjustStack( int32_t bytes );
+	void Memory( uint32_t opcode, uint8_t rt, const instruction::Variable &address );
+	void Jump( uint32_t label );
+	void Branch( uint32_t opcode, uint8_t rs, uint8_t rt, uint32_t label );
+	void Label( uint32_t label );
+	void Directive( const std::string &directive );
+	void Section( const std::string &name );
+	void Word( const std::string &label, int32_t value );
+	void Unsupported( const std::string &what );
+
+	static const uint8_t Zero = 0;
+	static const uint8_t AssemblerTemporary = 1;
+	static const uint8_t GlobalPointer = 28;
+	static const uint8_t StackPointer = 29;
+
+private:
+	struct DataSection
+	{
+		std::string name;
+		std::vector<uint8_t> bytes;
+	};
+
+	struct Symbol
+	{
+		size_t section;
+		uint32_t offset;
+	};
+
+	// relocation against a variable, resolved once every symbol is known
+	struct DataFixup
+	{
+		uint32_t offset;
+		uint8_t type;
+		std::string symbol;
+	};
+
+	struct LabelFixup
+	{
+		uint32_t offset;
+		bool jump;
+	};
+
+	struct Relocation
+	{
+		uint32_t offset;
+		uint32_t symbol;
+		uint8_t type;
+	};
+
+	void Patch( uint32_t offset, uint32_t mask, uint32_t value );
+	void Resolve( const LabelFixup &fixup, uint32_t target );
+	void Write( std::vector<uint8_t> &object );
+
+	bool delaySlots;
+	bool noreorder;
+	bool atUsed;
+	std::string error;
+
+	std::vector<uint8_t> text;
+	std::vector<DataSection> data;
+	int32_t current;
+	uint32_t usedRegisters;
+
+	std::unordered_map<uint32_t, uint32_t> labels;
+	std::unordered_map<uint32_t, std::vector<LabelFixup>> pending;
+	std::unordered_map<std::string, Symbol> symbols;
+	std::vector<std::string> symbolOrder;
+	std::vector<DataFixup> dataFixups;
+	std::vector<Relocation> relocations;
+};
+
+}
@@ -0,0 +1,351 @@
+#include "optimizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include "globals.hpp"
+#include "flow.hpp"
+#include "scheduler.hpp"
+
+namespace optimizer
+{
+
+static const char *names[] = { "fold", "gprel", "thread-jumps", "schedule", "noreorder" };
+
+const char *GetName( Pass pass )
+{
+	return names[static_cast<uint32_t>( pass )];
+}
+
+bool IsTreePass( Pass pass )
+{
+	return pass == Pass::Fold;
+}
+
+bool HasInstructionPasses( const std::vector<Pass> &pipeline )
+{
+	return std::any_of( pipeline.begin( ), pipeline.end( ), []( Pass pass ) { return !IsTreePass( pass ); } );
+}
+
+bool GetLevel( const std::string &level, std::vector<Pass> &pipeline )
+{
+	if( level == "0" )
+		pipeline = { };
+	else if( level == "1" )
+		pipeline = { Pass::ThreadJumps };
+	else if( level == "2" )
+		pipeline = { Pass::Fold, Pass::GlobalPointer, Pass::ThreadJumps, Pass::Schedule };
+	else
+		return false;
+
+	return true;
+}
+
+bool ParsePasses( const std::string &names, std::vector<Pass> &pipeline )
+{
+	std::vector<Pass> passes;
+	std::istringstream stream( names );
+	std::string name;
+	while( std::getline( stream, name, ',' ) )
+	{
+		Pass pass = Pass::Fold;
+		while( pass != Pass::DelaySlots && name != GetName( pass ) )
+			pass = static_cast<Pass>( static_cast<uint32_t>( pass ) + 1 );
+
+		if( pass == Pass::DelaySlots || std::find( passes.begin( ), passes.end( ), pass ) != passes.end( ) )
+			return false;
+
+		passes.push_back( pass );
+	}
+
+	pipeline = passes;
+	return true;
+}
+
+// the value of a Boolean or Integer literal
+static bool GetConstant( const node::Expression *expr, int32_t &value )
+{
+	if( const node::Integer *integer = dynamic_cast<const node::Integer *>( expr ) )
+		value = integer->value;
+	else if( const node::Boolean *boolean = dynamic_cast<const node::Boolean *>( expr ) )
+		value = boolean->value ? 1 : 0;
+	else
+		return false;
+
+	return true;
+}
+
+// the literal for an operator over literals, with the results of the
+// simulator (wrapping arithmetic), nullptr for divisions it doesn't define
+static node::Expression *Fold( const node::BinaryOperator *binop )
+{
+	int32_t left, right;
+	if( !GetConstant( binop->lhs, left ) || !GetConstant( binop->rhs, right ) )
+		return nullptr;
+
+	uint32_t a = static_cast<uint32_t>( left );
+	uint32_t b = static_cast<uint32_t>( right );
+	bool divisible = right != 0 && !( left == std::numeric_limits<int32_t>::min( ) && right == -1 );
+	switch( binop->op )
+	{
+		case node::BinaryOperator::Addition:
+			return new node::Integer( static_cast<int32_t>( a + b ) );
+
+		case node::BinaryOperator::Subtraction:
+			return new node::Integer( static_cast<int32_t>( a - b ) );
+
+		case node::BinaryOperator::Multiplication:
+			return new node::Integer( static_cast<int32_t>( a * b ) );
+
+		case node::BinaryOperator::Division:
+			return divisible ? new node::Integer( left / right ) : nullptr;
+
+		case node::BinaryOperator::Modulo:
+			return divisible ? new node::Integer( left % right ) : nullptr;
+
+		case node::BinaryOperator::Equal:
+			return new node::Boolean( left == right );
+
+		case node::BinaryOperator::NotEqual:
+			return new node::Boolean( left != right );
+
+		case node::BinaryOperator::LessThan:
+			return new node::Boolean( left < right );
+
+		case node::BinaryOperator::LessEqual:
+			return new node::Boolean( left <= right );
+
+		case node::BinaryOperator::GreaterThan:
+			return new node::Boolean( left > right );
+
+		case node::BinaryOperator::GreaterEqual:
+			return new node::Boolean( left >= right );
+
+		case node::BinaryOperator::And:
+			return new node::Boolean( left != 0 && right != 0 );
+
+		case node::BinaryOperator::Or:
+			return new node::Boolean( left != 0 || right != 0 );
+	}
+
+	return nullptr;
+}
+
+// post-order on a stack, an operator is replaced once its operands have been folded
+static uint32_t FoldExpression( node::Expression **root )
+{
+	uint32_t folded = 0;
+	std::vector<std::pair<node::Expression **, bool>> stack( 1, { root, false } );
+	while( !stack.empty( ) )
+	{
+		node::Expression **slot = stack.back( ).first;
+		node::BinaryOperator *binop = dynamic_cast<node::BinaryOperator *>( *slot );
+		if( binop != nullptr && !stack.back( ).second )
+		{
+			stack.back( ).second = true;
+			stack.push_back( { &binop->rhs, false } );
+			stack.push_back( { &binop->lhs, false } );
+			continue;
+		}
+
+		stack.pop_back( );
+		node::Expression *literal = binop != nullptr ? Fold( binop ) : nullptr;
+		if( literal != nullptr )
+		{
+			*slot = literal;
+			delete binop;
+			folded++;
+		}
+	}
+
+	return folded;
+}
+
+static uint32_t FoldConstants( node::Block *program )
+{
+	uint32_t folded = 0;
+	std::vector<node::Block *> blocks( 1, program );
+	while( !blocks.empty( ) )
+	{
+		node::Block *block = blocks.back( );
+		blocks.pop_back( );
+		for( node::Statement *stmt : block->statements )
+		{
+			if( node::Assignment *assignment = dynamic_cast<node::Assignment *>( stmt ) )
+				folded += FoldExpression( &assignment->rhs );
+			else if( node::ExpressionStatement *expression = dynamic_cast<node::ExpressionStatement *>( stmt ) )
+				folded += FoldExpression( &expression->expression );
+			else if( node::IntegerDeclaration *declaration = dynamic_cast<node::IntegerDeclaration *>( stmt ) )
+				folded += declaration->assignmentExpr != nullptr ? FoldExpression( &declaration->assignmentExpr ) : 0;
+			else if( node::BooleanDeclaration *declaration = dynamic_cast<node::BooleanDeclaration *>( stmt ) )
+				folded += declaration->assignmentExpr != nullptr ? FoldExpression( &declaration->assignmentExpr ) : 0;
+			else if( node::IfThenElse *ifthenelse = dynamic_cast<node::IfThenElse *>( stmt ) )
+			{
+				folded += FoldExpression( &ifthenelse->testExpr );
+				blocks.push_back( ifthenelse->successBlock );
+				if( ifthenelse->failureBlock != nullptr )
+					blocks.push_back( ifthenelse->failureBlock );
+			}
+			else if( node::WhileLoop *whileloop = dynamic_cast<node::WhileLoop *>( stmt ) )
+			{
+				folded += FoldExpression( &whileloop->testExpr );
+				blocks.push_back( whileloop->successBlock );
+			}
+		}
+	}
+
+	return folded;
+}
+
+struct Counts
+{
+	uint32_t instructions = 0;
+	int32_t loads = 0;
+	int32_t stores = 0;
+	int32_t branches = 0;
+};
+
+static Counts Count( const instruction::List &list )
+{
+	Counts counts;
+	for( const instruction::Base *inst : list )
+	{
+		counts.instructions++;
+		switch( inst->GetType( ) )
+		{
+			case instruction::Type::Load:
+				counts.loads++;
+				break;
+
+			case instruction::Type::Save:
+				counts.stores++;
+				break;
+
+			case instruction::Type::Jump:
+			case instruction::Type::Branch:
+				counts.branches++;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return counts;
+}
+
+Statistics Run( Pass pass, node::Block *program, instruction::List &list )
+{
+	Statistics stats;
+	stats.pass = pass;
+	Counts before;
+	if( !IsTreePass( pass ) )
+		before = Count( list );
+
+	std::ostringstream details;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+	switch( pass )
+	{
+		case Pass::Fold:
+			details << "Constants folded: " << ( program != nullptr ? FoldConstants( program ) : 0 );
+			break;
+
+		case Pass::GlobalPointer:
+		{
+			globals::GlobalPointerStatistics result = globals::UseGlobalPointer( list );
+			details << "Global pointer relative accesses: " << result.folded;
+			break;
+		}
+
+		case Pass::ThreadJumps:
+		{
+			flow::BranchStatistics result = flow::SimplifyBranches( list );
+			details << "Jumps threaded: " << result.threaded << ", labels merged: " << result.merged <<
+				", unreachable removed: " << result.unreachable << ", jumps removed: " << result.removed;
+			break;
+		}
+
+		case Pass::Schedule:
+		{
+			scheduler::ScheduleStatistics result = scheduler::ScheduleBlocks( list );
+			details << "Estimated block cycles: " << result.before << " -> " << result.after;
+			break;
+		}
+
+		case Pass::DelaySlots:
+		{
+			scheduler::DelaySlotStatistics result = scheduler::FillDelaySlots( list );
+			details << "Delay slots filled: " << result.filled << "/" << result.slots;
+			break;
+		}
+	}
+
+	stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+	stats.details = details.str( );
+	if( !IsTreePass( pass ) )
+	{
+		Counts after = Count( list );
+		stats.before = before.instructions;
+		stats.after = after.instructions;
+		stats.loads = before.loads - after.loads;
+		stats.stores = before.stores - after.stores;
+		stats.branches = before.branches - after.branches;
+	}
+
+	return stats;
+}
+
+std::string ToString( const Statistics &stats )
+{
+	std::ostringstream text;
+	text << "Pass " << GetName( stats.pass ) << ": " << std::fixed << std::setprecision( 3 ) << stats.seconds * 1000.0 << " ms";
+	if( !IsTreePass( stats.pass ) )
+	{
+		text << ", instructions " << stats.before << " -> " << stats.after << ", removed loads: " << stats.loads <<
+			", stores: " << stats.stores << ", branches: " << stats.branches;
+	}
+
+	return text.str( );
+}
+
+bool Verify( const instruction::List &list, std::string &error )
+{
+	uint32_t count = list.GetLabelCount( );
+	std::vector<bool> defined( count, false );
+	for( const instruction::Base *inst : list )
+	{
+		if( inst->GetType( ) != instruction::Type::Label )
+			continue;
+
+		uint32_t label = static_cast<const instruction::Label *>( inst )->GetLabel( );
+		if( label >= count || defined[label] )
+		{
+			error = ( label >= count ? "unknown label " : "label defined twice " ) + instruction::LabelToString( label );
+			return false;
+		}
+
+		defined[label] = true;
+	}
+
+	for( const instruction::Base *inst : list )
+	{
+		uint32_t label = 0;
+		if( inst->GetType( ) == instruction::Type::Jump )
+			label = static_cast<const instruction::Jump *>( inst )->GetLabel( );
+		else if( inst->GetType( ) == instruction::Type::Branch )
+			label = static_cast<const instruction::Branch *>( inst )->GetLabel( );
+		else
+			continue;
+
+		if( label >= count || !defined[label] )
+		{
+			error = "jump to undefined label " + instruction::LabelToString( label );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "node.hpp"
+#include "instruction.hpp"
+
+namespace optimizer
+{
+
+// the named passes: tree passes change the node:: program before code
+// generation, the others the instruction list
+enum class Pass
+{
+	// "fold", evaluates the operators whose operands are literals
+	Fold,
+	// "gprel", see globals::UseGlobalPointer
+	GlobalPointer,
+	// "thread-jumps", see flow::SimplifyBranches
+	ThreadJumps,
+	// "schedule", see scheduler::ScheduleBlocks
+	Schedule,
+	// "--noreorder", see scheduler::FillDelaySlots; always last, not in a pipeline
+	DelaySlots
+};
+
+const char *GetName( Pass pass );
+bool IsTreePass( Pass pass );
+bool HasInstructionPasses( const std::vector<Pass> &pipeline );
+
+// the pipelines of "0" (nothing), "1" and "2", false for other levels
+bool GetLevel( const std::string &level, std::vector<Pass> &pipeline );
+// comma separated names in the order they run, false on unknown or repeated ones
+bool ParsePasses( const std::string &names, std::vector<Pass> &pipeline );
+
+struct Statistics
+{
+	Pass pass = Pass::Fold;
+	double seconds = 0.0;
+	// instructions before and after an instruction pass
+	uint32_t before = 0;
+	uint32_t after = 0;
+	// loads, stores and branches (jumps included) removed, negative when added
+	int32_t loads = 0;
+	int32_t stores = 0;
+	int32_t branches = 0;
+	// the line the pass reports on its own
+	std::string details;
+};
+
+// a tree pass on program (nothing without one), any other on list
+Statistics Run( Pass pass, node::Block *program, instruction::List &list );
+// "Pass name: time, instructions, removed loads/stores/branches"
+std::string ToString( const Statistics &stats );
+
+// the invariants every pass keeps: labels below the count handed out by the
+// list and defined once, every jump and branch to a defined one; false with
+// the first problem otherwise
+bool Verify( const instruction::List &list, std::string &error );
+
+}
@@ -6,22 +6,34 @@
 #include <iostream>
 #include "node.hpp"
 #include "symbol.hpp"
+#include "compiler.hpp"
 #include "common.hpp"
 
-#define VERIFY_TYPES( left, right, leftstr, rightstr ) \
+// the stacks start small and double as needed, nesting depth is only limited
+// by memory instead of Bison's default of 10000
+#define YYMAXDEPTH 0x40000000
+
+// type errors abort the parse like syntax errors, the message is kept in the
+// compiler; owner is the node the rule built from its values, which Bison
+// doesn't free when an action aborts, the rest of the stack has %destructor
+#define VERIFY_TYPES( owner, left, right, leftstr, rightstr ) \
 	if( left == symbol::Type::None ) \
 	{ \
 		std::string err = "inexistant variable "; \
 		err += leftstr; \
 		err += "\n"; \
-		yyerror( programBlock, symTable, err.c_str( ) ); \
+		yyerror( compiler, err.c_str( ) ); \
+		delete owner; \
+		YYABORT; \
 	} \
 	if( right == symbol::Type::None ) \
 	{ \
 		std::string err = "inexistant variable "; \
 		err += rightstr; \
 		err += "\n"; \
-		yyerror( programBlock, symTable, err.c_str( ) ); \
+		yyerror( compiler, err.c_str( ) ); \
+		delete owner; \
+		YYABORT; \
 	} \
 	if( left != right ) \
 	{ \
@@ -34,29 +46,45 @@
 		err += "\n"; \
 		err += rightstr; \
 		err += "\n"; \
-		yyerror( programBlock, symTable, err.c_str( ) ); \
+		yyerror( compiler, err.c_str( ) ); \
+		delete owner; \
+		YYABORT; \
 	}
 
-#define VERIFY_NODES( left, right ) VERIFY_TYPES( left->GetResultType( symTable ), right->GetResultType( symTable ), left->ToString( ), right->ToString( ) )
-#define VERIFY_BOOLEAN( expr ) VERIFY_TYPES( expr->GetResultType( symTable ), symbol::Type::Boolean, expr->ToString( ), "boolean" )
-#define VERIFY_INTEGER( expr ) VERIFY_TYPES( expr->GetResultType( symTable ), symbol::Type::Integer, expr->ToString( ), "integer" )
-
-#define ADD_BOOLEAN( id ) symTable.Add( id->name, symbol::Type::Boolean );
-#define ADD_INTEGER( id ) symTable.Add( id->name, symbol::Type::Integer );
+#define VERIFY_NODES( owner, left, right ) VERIFY_TYPES( owner, left->GetResultType( compiler.GetSymbols( ) ), right->GetResultType( compiler.GetSymbols( ) ), left->ToString( ), right->ToString( ) )
+#define VERIFY_BOOLEAN( owner, expr ) VERIFY_TYPES( owner, expr->GetResultType( compiler.GetSymbols( ) ), symbol::Type::Boolean, expr->ToString( ), "boolean" )
+#define VERIFY_INTEGER( owner, expr ) VERIFY_TYPES( owner, expr->GetResultType( compiler.GetSymbols( ) ), symbol::Type::Integer, expr->ToString( ), "integer" )
 
-extern int32_t yylex( );
+#define ADD_BOOLEAN( id ) compiler.GetSymbols( ).Add( id->name, symbol::Type::Boolean );
+#define ADD_INTEGER( id ) compiler.GetSymbols( ).Add( id->name, symbol::Type::Integer );
 
-void yyerror( node::Block **programBlock, symbol::Table &symTable, const char *s )
+void yyerror( compiler::Compiler &compiler, const char *s )
 {
-	printf( "Error: %s\n", s );
-	exit( 1 );
+	compiler.Error( s );
 }
 %}
 
+%code requires {
+#include "node.hpp"
+
+namespace compiler
+{
+
+class Compiler;
+
+}
+}
+
+%code provides {
+// defined in tokens.l, reads from the compiler's scanner
+int32_t yylex( YYSTYPE *value, compiler::Compiler &compiler );
+}
+
+%define api.pure full
 %define parse.error verbose
 %define parse.lac full
 
-%parse-param {node::Block **programBlock} {symbol::Table &symTable}
+%param {compiler::Compiler &compiler}
 
 %union {
 	node::Base *node;
@@ -84,9 +112,13 @@ void yyerror( node::Block **programBlock, symbol::Table &symTable, const char *s
 
 %type <ident> ident ident_wrapper
 %type <expr> numeric expr bool boolexpr common arithmetic comparison logic
-%type <block> program stmts block
+%type <block> top_stmts stmts block
 %type <stmt> stmt var_decl assignment while_loop if_then_else
 
+// values popped by a syntax error or an abort; the program is handed to the
+// compiler instead
+%destructor { delete $$; } <block> <expr> <stmt> <ident> <string>
+
 %left TEQUAL
 %left TAND TOR
 %left TCEQ TCNE TCLT TCLE TCGT TCGE
@@ -107,12 +139,18 @@ add identifier/type pairs to symbol table on variable declaration (and verify ex
 */
 
 program :
-	stmts { *programBlock = $$; }
+	top_stmts { compiler.SetProgram( $1 ); }
+	;
+
+// the compiler may generate and free each top-level statement right away
+top_stmts :
+	stmt { $$ = new node::Block( ); compiler.AddStatement( $$, $1 ); } |
+	top_stmts stmt { $$ = $1; compiler.AddStatement( $$, $2 ); }
 	;
 
 stmts :
 	stmt { $$ = new node::Block( ); $$->statements.push_back( $1 ); } |
-	stmts stmt { $1->statements.push_back( $2 ); }
+	stmts stmt { $$ = $1; $$->statements.push_back( $2 ); }
 	;
 
 stmt :
@@ -130,22 +168,22 @@ block :
 
 var_decl :
 	TINT ident { ADD_INTEGER( $2 ); $$ = new node::IntegerDeclaration( $2 ); } |
-	TINT ident TEQUAL expr { ADD_INTEGER( $2 ); VERIFY_INTEGER( $4 ); $$ = new node::IntegerDeclaration( $2, $4 ); } |
+	TINT ident TEQUAL expr { ADD_INTEGER( $2 ); $$ = new node::IntegerDeclaration( $2, $4 ); VERIFY_INTEGER( $$, $4 ); } |
 	TBOOL ident { ADD_BOOLEAN( $2 ); $$ = new node::BooleanDeclaration( $2 ); } |
-	TBOOL ident TEQUAL expr { ADD_BOOLEAN( $2 ); VERIFY_BOOLEAN( $4 ); $$ = new node::BooleanDeclaration( $2, $4 ); }
+	TBOOL ident TEQUAL expr { ADD_BOOLEAN( $2 ); $$ = new node::BooleanDeclaration( $2, $4 ); VERIFY_BOOLEAN( $$, $4 ); }
 	;
 
 assignment :
-	ident TEQUAL expr { VERIFY_NODES( $1, $3 ); $$ = new node::Assignment( $1, $3 ); }
+	ident TEQUAL expr { $$ = new node::Assignment( $1, $3 ); VERIFY_NODES( $$, $1, $3 ); }
 	;
 
 if_then_else :
-	TIF TLPAREN boolexpr TRPAREN block TELSE block { VERIFY_BOOLEAN( $3 ); $$ = new node::IfThenElse( $3, $5, $7 ); } |
-	TIF TLPAREN boolexpr TRPAREN block { VERIFY_BOOLEAN( $3 ); $$ = new node::IfThenElse( $3, $5, nullptr ); } %prec TEND
+	TIF TLPAREN boolexpr TRPAREN block TELSE block { $$ = new node::IfThenElse( $3, $5, $7 ); VERIFY_BOOLEAN( $$, $3 ); } |
+	TIF TLPAREN boolexpr TRPAREN block { $$ = new node::IfThenElse( $3, $5, nullptr ); VERIFY_BOOLEAN( $$, $3 ); } %prec TEND
 	;
 
 while_loop :
-	TWHILE TLPAREN boolexpr TRPAREN block { VERIFY_BOOLEAN( $3 ); $$ = new node::WhileLoop( $3, $5 ); }
+	TWHILE TLPAREN boolexpr TRPAREN block { $$ = new node::WhileLoop( $3, $5 ); VERIFY_BOOLEAN( $$, $3 ); }
 	;
 
 ident :
@@ -189,27 +227,27 @@ expr :
 	;
 
 arithmetic :
-	common TMOD common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Modulo, $3 ); } |
-	common TMUL common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Multiplication, $3 ); } |
-	common TDIV common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Division, $3 ); } |
-	common TADD common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Addition, $3 ); } |
-	common TSUB common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Subtraction, $3 ); } |
+	common TMOD common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Modulo, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TMUL common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Multiplication, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TDIV common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Division, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TADD common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Addition, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TSUB common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Subtraction, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
 	TLPAREN arithmetic TRPAREN { $$ = $2; }
 	;
 
 comparison :
-	common TCEQ common { VERIFY_NODES( $1, $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Equal, $3 ); } |
-	common TCNE common { VERIFY_NODES( $1, $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::NotEqual, $3 ); } |
-	common TCLT common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::LessThan, $3 ); } |
-	common TCLE common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::LessEqual, $3 ); } |
-	common TCGT common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::GreaterThan, $3 ); } |
-	common TCGE common { VERIFY_INTEGER( $1 ); VERIFY_INTEGER( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::GreaterEqual, $3 ); } |
+	common TCEQ common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Equal, $3 ); VERIFY_NODES( $$, $1, $3 ); } |
+	common TCNE common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::NotEqual, $3 ); VERIFY_NODES( $$, $1, $3 ); } |
+	common TCLT common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::LessThan, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TCLE common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::LessEqual, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TCGT common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::GreaterThan, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
+	common TCGE common { $$ = new node::BinaryOperator( $1, node::BinaryOperator::GreaterEqual, $3 ); VERIFY_INTEGER( $$, $1 ); VERIFY_INTEGER( $$, $3 ); } |
 	TLPAREN comparison TRPAREN { $$ = $2; }
 	;
 
 logic :
-	boolexpr TAND boolexpr { VERIFY_BOOLEAN( $1 ); VERIFY_BOOLEAN( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::And, $3 ); } |
-	boolexpr TOR boolexpr { VERIFY_BOOLEAN( $1 ); VERIFY_BOOLEAN( $3 ); $$ = new node::BinaryOperator( $1, node::BinaryOperator::Or, $3 ); } |
+	boolexpr TAND boolexpr { $$ = new node::BinaryOperator( $1, node::BinaryOperator::And, $3 ); VERIFY_BOOLEAN( $$, $1 ); VERIFY_BOOLEAN( $$, $3 ); } |
+	boolexpr TOR boolexpr { $$ = new node::BinaryOperator( $1, node::BinaryOperator::Or, $3 ); VERIFY_BOOLEAN( $$, $1 ); VERIFY_BOOLEAN( $$, $3 ); } |
 	TLPAREN logic TRPAREN { $$ = $2; }
 	;
 
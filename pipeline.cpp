@@ -0,0 +1,100 @@
+#include "pipeline.hpp"
+#include "lexer.hpp"
+#include "pratt.hpp"
+#include "ring.hpp"
+#include "node.hpp"
+#include "symbol.hpp"
+#include "instruction.hpp"
+#include <functional>
+#include <thread>
+
+namespace pipeline
+{
+
+// enough to keep every stage busy without holding much of a large input
+static const size_t tokenCapacity = 4096;
+static const size_t statementCapacity = 256;
+static const size_t chunkCapacity = 256;
+
+static void Lex( const char *data, size_t size, ring::Queue<lexer::Token> &tokens )
+{
+	lexer::Scanner scanner( data, size );
+	lexer::Token token;
+	do
+	{
+		token = scanner.Next( );
+	}
+	while( tokens.Push( token ) && token.kind != lexer::Kind::End );
+}
+
+static void Generate( ring::Queue<node::Statement *> &statements, ring::Queue<instruction::List *> &chunks, const symbol::Table &symTable )
+{
+	// every chunk numbers its labels from zero, appending it here moves them
+	// after the ones of the statements before it
+	instruction::List numbering;
+	while( node::Statement *statement = statements.Pop( ) )
+	{
+		instruction::List *chunk = new instruction::List( );
+		statement->GenerateInstructions( *chunk, symTable );
+		delete statement;
+
+		numbering.Append( *chunk );
+		chunk->splice( chunk->end( ), numbering );
+		chunks.Push( chunk );
+	}
+
+	chunks.Push( nullptr );
+}
+
+static void Emit( ring::Queue<instruction::List *> &chunks, std::string &text )
+{
+	while( instruction::List *chunk = chunks.Pop( ) )
+	{
+		for( instruction::Base *inst : *chunk )
+		{
+			text += inst->ToString( );
+			delete inst;
+		}
+
+		delete chunk;
+	}
+}
+
+bool Compile( const char *data, size_t size, std::string &assembly, std::string &error )
+{
+	ring::Queue<lexer::Token> tokens( tokenCapacity );
+	ring::Queue<node::Statement *> statements( statementCapacity );
+	ring::Queue<instruction::List *> chunks( chunkCapacity );
+
+	// codegen never looks up symbols, so it can run while the parser adds them
+	symbol::Table symTable;
+	std::string text;
+
+	std::thread lexer( Lex, data, size, std::ref( tokens ) );
+	std::thread generator( Generate, std::ref( statements ), std::ref( chunks ), std::cref( symTable ) );
+	std::thread emitter( Emit, std::ref( chunks ), std::ref( text ) );
+
+	bool parsed = pratt::ParseStatements( data, size, tokens, statements, symTable, error );
+
+	lexer.join( );
+	generator.join( );
+	emitter.join( );
+
+	if( !parsed )
+		return false;
+
+	// the variables are only known at the end, and .data comes first
+	assembly.clear( );
+	if( !symTable.Empty( ) )
+	{
+		assembly += instruction::Section( ".data" ).ToString( );
+		for( const std::string &name : symTable.GetNames( ) )
+			assembly += instruction::Word( name ).ToString( );
+	}
+
+	assembly += instruction::Section( ".text" ).ToString( );
+	assembly += text;
+	return true;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace pipeline
+{
+
+// compiles one source to assembly with the stages on their own threads: the
+// hand-written scanner feeds tokens to the Pratt parser, which hands every
+// top-level statement to codegen as soon as it's parsed, and the generated
+// instructions are formatted while the rest is still being parsed; the stages
+// are connected by bounded ring::Queue buffers, so a fast stage waits for the
+// next one instead of running ahead. The output is the same as the serial
+// compile without passes, false with the error on syntax or type errors
+bool Compile( const char *data, size_t size, std::string &assembly, std::string &error );
+
+}
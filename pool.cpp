@@ -0,0 +1,134 @@
+#include "pool.hpp"
+#include <algorithm>
+
+namespace pool
+{
+
+// pool and deque of the worker running on this thread
+static thread_local ThreadPool *current_pool = nullptr;
+static thread_local uint32_t current_index = 0;
+
+ThreadPool::ThreadPool( uint32_t threads ) :
+	stopping( false ),
+	queued( 0 ),
+	pending( 0 ),
+	next( 0 ),
+	steals( 0 )
+{
+	if( threads == 0 )
+		threads = std::max( std::thread::hardware_concurrency( ), 1u );
+
+	for( uint32_t i = 0; i < threads; ++i )
+		queues.emplace_back( new Queue );
+
+	for( uint32_t i = 0; i < threads; ++i )
+		this->threads.emplace_back( &ThreadPool::Work, this, i );
+}
+
+ThreadPool::~ThreadPool( )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		stopping = true;
+	}
+
+	wake.notify_all( );
+	for( std::thread &thread : threads )
+		thread.join( );
+}
+
+void ThreadPool::Submit( std::function<void( )> task )
+{
+	uint32_t index = current_pool == this ? current_index : next++ % static_cast<uint32_t>( queues.size( ) );
+	pending++;
+	{
+		std::lock_guard<std::mutex> lock( queues[index]->mutex );
+		queues[index]->tasks.push_back( std::move( task ) );
+	}
+
+	// the increment happens under the lock the sleepers check it with, so no wakeup is lost
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		queued++;
+	}
+
+	wake.notify_one( );
+}
+
+void ThreadPool::Wait( )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	done.wait( lock, [this]( ) { return pending == 0; } );
+}
+
+uint32_t ThreadPool::GetSize( ) const
+{
+	return static_cast<uint32_t>( threads.size( ) );
+}
+
+uint64_t ThreadPool::GetSteals( ) const
+{
+	return steals;
+}
+
+bool ThreadPool::Pop( uint32_t index, std::function<void( )> &task )
+{
+	{
+		Queue &own = *queues[index];
+		std::lock_guard<std::mutex> lock( own.mutex );
+		if( !own.tasks.empty( ) )
+		{
+			task = std::move( own.tasks.back( ) );
+			own.tasks.pop_back( );
+			queued--;
+			return true;
+		}
+	}
+
+	for( size_t i = 1; i < queues.size( ); ++i )
+	{
+		Queue &victim = *queues[( index + i ) % queues.size( )];
+		std::lock_guard<std::mutex> lock( victim.mutex );
+		if( !victim.tasks.empty( ) )
+		{
+			task = std::move( victim.tasks.front( ) );
+			victim.tasks.pop_front( );
+			queued--;
+			steals++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::Work( uint32_t index )
+{
+	current_pool = this;
+	current_index = index;
+
+	std::function<void( )> task;
+	while( true )
+	{
+		if( Pop( index, task ) )
+		{
+			task( );
+			task = nullptr;
+
+			if( --pending == 0 )
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				done.notify_all( );
+			}
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( mutex );
+		wake.wait( lock, [this]( ) { return stopping || queued != 0; } );
+		if( stopping && queued == 0 )
+			return;
+	}
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pool
+{
+
+// fixed set of worker threads, each with its own task deque: a worker pops
+// the newest task of its own deque and, when that's empty, steals the oldest
+// task of another one
+class ThreadPool
+{
+public:
+	// 0 threads means one per hardware thread
+	explicit ThreadPool( uint32_t threads = 0 );
+	~ThreadPool( );
+
+	ThreadPool( const ThreadPool & ) = delete;
+	ThreadPool &operator=( const ThreadPool & ) = delete;
+
+	// tasks submitted from a worker go to its own deque, others are spread round robin
+	void Submit( std::function<void( )> task );
+	// blocks until every submitted task has finished
+	void Wait( );
+
+	uint32_t GetSize( ) const;
+	uint64_t GetSteals( ) const;
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void( )>> tasks;
+	};
+
+	bool Pop( uint32_t index, std::function<void( )> &task );
+	void Work( uint32_t index );
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	bool stopping;
+
+	// tasks in the deques and tasks not finished yet
+	std::atomic<size_t> queued;
+	std::atomic<size_t> pending;
+	std::atomic<uint32_t> next;
+	std::atomic<uint64_t> steals;
+};
+
+}
@@ -0,0 +1,909 @@
+#include "pratt.hpp"
+#include <vector>
+#include "lexer.hpp"
+#include "common.hpp"
+
+namespace pratt
+{
+
+// token names as the Bison parser reports them
+static const char *kind_names[] = {
+	"end of file", "TIDENTIFIER", "TINTEGER",
+	"TTRUE", "TFALSE", "TINT", "TBOOL", "TIF", "TELSE", "TWHILE", "TAND", "TOR",
+	"TEQUAL", "TCEQ", "TCNE", "TCLT", "TCLE", "TCGT", "TCGE",
+	"TLPAREN", "TRPAREN", "TLBRACE", "TRBRACE", "TSEMICOL",
+	"TADD", "TSUB", "TMUL", "TDIV", "TMOD",
+	"unknown token"
+};
+
+struct Operator
+{
+	// 0 for tokens that aren't binary operators (and for open parentheses on
+	// the parser's stack), all of them are left associative
+	int32_t precedence;
+	node::BinaryOperator::Code code;
+};
+
+// same precedences as the %left declarations in parser.y
+static Operator GetOperator( lexer::Kind kind )
+{
+	switch( kind )
+	{
+		case lexer::Kind::And:
+			return { 1, node::BinaryOperator::And };
+
+		case lexer::Kind::Or:
+			return { 1, node::BinaryOperator::Or };
+
+		case lexer::Kind::Equal:
+			return { 2, node::BinaryOperator::Equal };
+
+		case lexer::Kind::NotEqual:
+			return { 2, node::BinaryOperator::NotEqual };
+
+		case lexer::Kind::Less:
+			return { 2, node::BinaryOperator::LessThan };
+
+		case lexer::Kind::LessEqual:
+			return { 2, node::BinaryOperator::LessEqual };
+
+		case lexer::Kind::Greater:
+			return { 2, node::BinaryOperator::GreaterThan };
+
+		case lexer::Kind::GreaterEqual:
+			return { 2, node::BinaryOperator::GreaterEqual };
+
+		case lexer::Kind::Add:
+			return { 3, node::BinaryOperator::Addition };
+
+		case lexer::Kind::Subtract:
+			return { 3, node::BinaryOperator::Subtraction };
+
+		case lexer::Kind::Multiply:
+			return { 4, node::BinaryOperator::Multiplication };
+
+		case lexer::Kind::Divide:
+			return { 4, node::BinaryOperator::Division };
+
+		case lexer::Kind::Modulo:
+			return { 5, node::BinaryOperator::Modulo };
+
+		default:
+			return { 0, node::BinaryOperator::Addition };
+	}
+}
+
+// what the parser builds, node:: objects or the arrays of a flat::Tree;
+// a handle that is false stands for a failed parse, and the parts already
+// built for it are handed to Discard
+struct NodeBuilder
+{
+	typedef node::Expression *Expression;
+	typedef node::Identifier *Identifier;
+	typedef node::Statement *Statement;
+	typedef node::Block *Block;
+	// a block whose statements are still being parsed
+	typedef node::Block *Open;
+
+	Identifier MakeIdentifier( const char *name, size_t length )
+	{
+		return new node::Identifier( std::string( name, length ) );
+	}
+
+	const std::string &GetName( Identifier id ) const
+	{
+		return id->name;
+	}
+
+	Expression MakeInteger( int32_t value )
+	{
+		return new node::Integer( value );
+	}
+
+	Expression MakeBoolean( bool value )
+	{
+		return new node::Boolean( value );
+	}
+
+	Expression MakeOperator( Expression lhs, node::BinaryOperator::Code code, Expression rhs )
+	{
+		return new node::BinaryOperator( lhs, code, rhs );
+	}
+
+	Statement MakeAssignment( Identifier id, Expression value )
+	{
+		return new node::Assignment( id, value );
+	}
+
+	Statement MakeDeclaration( symbol::Type type, Identifier id, Expression value )
+	{
+		if( type == symbol::Type::Integer )
+			return value != nullptr ? new node::IntegerDeclaration( id, value ) : new node::IntegerDeclaration( id );
+		else
+			return value != nullptr ? new node::BooleanDeclaration( id, value ) : new node::BooleanDeclaration( id );
+	}
+
+	Statement MakeIfThenElse( Expression test, Block success, Block failure )
+	{
+		return new node::IfThenElse( test, success, failure );
+	}
+
+	Statement MakeWhileLoop( Expression test, Block success )
+	{
+		return new node::WhileLoop( test, success );
+	}
+
+	Open BeginBlock( )
+	{
+		return new node::Block( );
+	}
+
+	void Append( Open block, Statement statement )
+	{
+		block->statements.push_back( statement );
+	}
+
+	Block EndBlock( Open block )
+	{
+		return block;
+	}
+
+	// any handle, an open block with its statements
+	void Discard( node::Base *node )
+	{
+		delete node;
+	}
+
+	std::string ToString( Expression expression ) const
+	{
+		return expression->ToString( );
+	}
+};
+
+struct FlatBuilder
+{
+	typedef flat::Index Expression;
+	typedef flat::Index Identifier;
+	typedef flat::Index Statement;
+	typedef flat::Index Block;
+	typedef size_t Open;
+
+	explicit FlatBuilder( flat::Tree &tree ) :
+		tree( tree )
+	{ }
+
+	Identifier MakeIdentifier( const char *name, size_t length )
+	{
+		return tree.Add( flat::Kind::Identifier, tree.AddSymbol( std::string( name, length ) ) );
+	}
+
+	const std::string &GetName( Identifier id ) const
+	{
+		return tree.symbols[tree.first[id]];
+	}
+
+	Expression MakeInteger( int32_t value )
+	{
+		return tree.Add( flat::Kind::Integer, static_cast<uint32_t>( value ) );
+	}
+
+	Expression MakeBoolean( bool value )
+	{
+		return tree.Add( flat::Kind::Boolean, value ? 1 : 0 );
+	}
+
+	Expression MakeOperator( Expression lhs, node::BinaryOperator::Code code, Expression rhs )
+	{
+		return tree.Add( flat::Kind::BinaryOperator, lhs, rhs, static_cast<uint32_t>( code ) );
+	}
+
+	Statement MakeAssignment( Identifier id, Expression value )
+	{
+		return tree.Add( flat::Kind::Assignment, id, value );
+	}
+
+	Statement MakeDeclaration( symbol::Type type, Identifier id, Expression value )
+	{
+		return tree.Add( type == symbol::Type::Integer ? flat::Kind::IntegerDeclaration : flat::Kind::BooleanDeclaration, id, value );
+	}
+
+	Statement MakeIfThenElse( Expression test, Block success, Block failure )
+	{
+		return tree.Add( flat::Kind::IfThenElse, test, success, failure );
+	}
+
+	Statement MakeWhileLoop( Expression test, Block success )
+	{
+		return tree.Add( flat::Kind::WhileLoop, test, success );
+	}
+
+	Open BeginBlock( )
+	{
+		return tree.BeginBlock( );
+	}
+
+	void Append( Open, Statement statement )
+	{
+		tree.Append( statement );
+	}
+
+	Block EndBlock( Open block )
+	{
+		return tree.EndBlock( block );
+	}
+
+	// the tree of a failed parse is dropped as a whole
+	void Discard( size_t )
+	{ }
+
+	std::string ToString( Expression expression ) const
+	{
+		return tree.ToString( expression );
+	}
+
+	flat::Tree &tree;
+};
+
+template <typename Builder>
+class Parser
+{
+public:
+	typedef typename Builder::Expression Expression;
+	typedef typename Builder::Identifier Identifier;
+	typedef typename Builder::Statement Statement;
+	typedef typename Builder::Block Block;
+
+	// tokens comes from the lexer thread in the pipelined mode, otherwise they're scanned here
+	Parser( Builder builder, const char *data, size_t size, symbol::Table &symTable, ring::Queue<lexer::Token> *tokens = nullptr );
+	// for a single statement, outer knows what was declared before it
+	Parser( Builder builder, const char *data, size_t size, symbol::Table &symTable, const Scope &outer );
+
+	Block ParseProgram( );
+	// the pipelined and incremental modes build node:: trees only
+	bool ParseStatements( ring::Queue<node::Statement *> &statements );
+	pratt::Statement ParseTopStatement( );
+	const std::string &GetError( ) const;
+
+private:
+	struct Typed
+	{
+		Expression expression;
+		symbol::Type type;
+	};
+
+	// a block being parsed and what it belongs to, innermost last: an if or a
+	// while waits for its block (an if with an else for the second one), the
+	// block above it waits for its statements, up to "}" or just one
+	struct Frame
+	{
+		enum Kind
+		{
+			If,
+			Else,
+			While,
+			Braces,
+			Single
+		};
+
+		Kind kind;
+		Expression test;
+		// of an Else
+		Block success;
+		// of Braces
+		typename Builder::Open block;
+	};
+
+	void Advance( );
+	bool Expect( lexer::Kind kind );
+	void Unexpected( const char *expecting = nullptr );
+	bool Verify( symbol::Type left, symbol::Type right, Expression leftNode, Expression rightNode );
+	symbol::Type Lookup( const std::string &name ) const;
+
+	void OpenBlock( Frame frame );
+	Statement AbandonStatement( );
+	Statement ParseStatement( );
+	Statement ParseDeclaration( );
+	Statement ParseAssignment( );
+	Expression ParseCondition( );
+	Identifier ParseIdentifier( );
+	bool Reduce( int32_t precedence );
+	Typed AbandonExpression( );
+	Typed ParseExpression( );
+	Typed ParsePrimary( );
+
+	Builder builder;
+	lexer::Scanner scanner;
+	ring::Queue<lexer::Token> *tokens;
+	lexer::Token token;
+	symbol::Table &symTable;
+	const Scope *outer;
+	std::string error;
+	// the stacks of the statement and expression being parsed, so nesting
+	// takes memory instead of native stack
+	std::vector<Frame> frames;
+	std::vector<Typed> operands;
+	std::vector<Operator> operators;
+};
+
+template <typename Builder>
+Parser<Builder>::Parser( Builder builder, const char *data, size_t size, symbol::Table &symTable, ring::Queue<lexer::Token> *tokens ) :
+	builder( builder ),
+	scanner( data, size ),
+	tokens( tokens ),
+	symTable( symTable ),
+	outer( nullptr )
+{
+	Advance( );
+}
+
+template <typename Builder>
+Parser<Builder>::Parser( Builder builder, const char *data, size_t size, symbol::Table &symTable, const Scope &outer ) :
+	builder( builder ),
+	scanner( data, size ),
+	tokens( nullptr ),
+	symTable( symTable ),
+	outer( &outer )
+{
+	Advance( );
+}
+
+template <typename Builder>
+typename Parser<Builder>::Block Parser<Builder>::ParseProgram( )
+{
+	typename Builder::Open block = builder.BeginBlock( );
+	do
+	{
+		Statement statement = ParseStatement( );
+		if( !statement )
+		{
+			builder.Discard( block );
+			return Block( );
+		}
+
+		builder.Append( block, statement );
+	}
+	while( token.kind != lexer::Kind::End );
+
+	return builder.EndBlock( block );
+}
+
+template <typename Builder>
+bool Parser<Builder>::ParseStatements( ring::Queue<node::Statement *> &statements )
+{
+	do
+	{
+		Statement statement = ParseStatement( );
+		if( !statement )
+			return false;
+
+		statements.Push( statement );
+	}
+	while( token.kind != lexer::Kind::End );
+
+	return true;
+}
+
+// the statement runs up to the next token, so consecutive statements cover the whole input
+template <typename Builder>
+pratt::Statement Parser<Builder>::ParseTopStatement( )
+{
+	pratt::Statement result;
+	result.statement = ParseStatement( );
+	result.end = token.offset;
+	if( !result.statement )
+		result.error = error;
+
+	return result;
+}
+
+template <typename Builder>
+const std::string &Parser<Builder>::GetError( ) const
+{
+	return error;
+}
+
+template <typename Builder>
+void Parser<Builder>::Advance( )
+{
+	token = tokens != nullptr ? tokens->Pop( ) : scanner.Next( );
+}
+
+template <typename Builder>
+bool Parser<Builder>::Expect( lexer::Kind kind )
+{
+	if( token.kind != kind )
+	{
+		Unexpected( kind_names[static_cast<int32_t>( kind )] );
+		return false;
+	}
+
+	Advance( );
+	return true;
+}
+
+template <typename Builder>
+void Parser<Builder>::Unexpected( const char *expecting )
+{
+	if( !error.empty( ) )
+		return;
+
+	if( token.kind == lexer::Kind::Unknown )
+	{
+		error = "unknown token " + std::string( scanner.GetText( token ), token.length );
+		return;
+	}
+
+	error = "syntax error, unexpected ";
+	error += kind_names[static_cast<int32_t>( token.kind )];
+	if( expecting != nullptr )
+	{
+		error += ", expecting ";
+		error += expecting;
+	}
+}
+
+// the checks and messages of VERIFY_TYPES in parser.y, a null right node
+// stands for the expected type itself
+template <typename Builder>
+bool Parser<Builder>::Verify( symbol::Type left, symbol::Type right, Expression leftNode, Expression rightNode )
+{
+	if( !error.empty( ) )
+		return false;
+
+	if( left != symbol::Type::None && right != symbol::Type::None && left == right )
+		return true;
+
+	std::string rightString = rightNode ? builder.ToString( rightNode ) : right == symbol::Type::Boolean ? "boolean" : "integer";
+	if( left == symbol::Type::None )
+		error = "inexistant variable " + builder.ToString( leftNode ) + "\n";
+	else if( right == symbol::Type::None )
+		error = "inexistant variable " + rightString + "\n";
+	else
+		error = "type conflict " + std::to_string( static_cast<int32_t>( left ) ) + " " + std::to_string( static_cast<int32_t>( right ) ) +
+			"\n" + builder.ToString( leftNode ) + "\n" + rightString + "\n";
+
+	return false;
+}
+
+// the first declaration of a name wins, and the outer ones come first
+template <typename Builder>
+symbol::Type Parser<Builder>::Lookup( const std::string &name ) const
+{
+	if( outer != nullptr )
+	{
+		symbol::Type type = outer->Get( name );
+		if( type != symbol::Type::None )
+			return type;
+	}
+
+	return symTable.Get( name );
+}
+
+// frame is the if, else or while the block is for
+template <typename Builder>
+void Parser<Builder>::OpenBlock( Frame frame )
+{
+	frames.push_back( frame );
+	if( token.kind != lexer::Kind::LeftBrace )
+	{
+		frames.push_back( { Frame::Single, Expression( ), Block( ), typename Builder::Open( ) } );
+		return;
+	}
+
+	Advance( );
+	frames.push_back( { Frame::Braces, Expression( ), Block( ), builder.BeginBlock( ) } );
+}
+
+// after an error, with whatever the open frames hold
+template <typename Builder>
+typename Parser<Builder>::Statement Parser<Builder>::AbandonStatement( )
+{
+	for( const Frame &frame : frames )
+	{
+		if( frame.kind == Frame::Braces )
+			builder.Discard( frame.block );
+		else if( frame.kind != Frame::Single )
+			builder.Discard( frame.test );
+
+		if( frame.kind == Frame::Else )
+			builder.Discard( frame.success );
+	}
+
+	frames.clear( );
+	return Statement( );
+}
+
+// ifs and whiles nest on frames, every other statement is parsed whole and
+// completes the frames waiting for it, until one needs more statements
+template <typename Builder>
+typename Parser<Builder>::Statement Parser<Builder>::ParseStatement( )
+{
+	frames.clear( );
+	for( ;; )
+	{
+		Statement statement = Statement( );
+		Block block = Block( );
+		if( !frames.empty( ) && frames.back( ).kind == Frame::Braces && token.kind == lexer::Kind::RightBrace )
+		{
+			Advance( );
+			block = builder.EndBlock( frames.back( ).block );
+			frames.pop_back( );
+		}
+		else
+		{
+			switch( token.kind )
+			{
+				case lexer::Kind::Int:
+				case lexer::Kind::Bool:
+					statement = ParseDeclaration( );
+					break;
+
+				case lexer::Kind::Identifier:
+					statement = ParseAssignment( );
+					break;
+
+				case lexer::Kind::If:
+				case lexer::Kind::While:
+				{
+					typename Frame::Kind kind = token.kind == lexer::Kind::If ? Frame::If : Frame::While;
+					Advance( );
+
+					Expression test = ParseCondition( );
+					if( !test )
+						return AbandonStatement( );
+
+					OpenBlock( { kind, test, Block( ), typename Builder::Open( ) } );
+					continue;
+				}
+
+				default:
+					Unexpected( );
+					return AbandonStatement( );
+			}
+
+			if( !statement )
+				return AbandonStatement( );
+
+			if( !Expect( lexer::Kind::Semicolon ) )
+			{
+				builder.Discard( statement );
+				return AbandonStatement( );
+			}
+		}
+
+		// a statement goes into its block, a block into its if or while,
+		// which is a statement again
+		for( ;; )
+		{
+			if( statement )
+			{
+				if( frames.empty( ) )
+					return statement;
+
+				Frame &frame = frames.back( );
+				if( frame.kind == Frame::Braces )
+				{
+					builder.Append( frame.block, statement );
+					break;
+				}
+
+				typename Builder::Open single = builder.BeginBlock( );
+				builder.Append( single, statement );
+				block = builder.EndBlock( single );
+				statement = Statement( );
+				frames.pop_back( );
+				continue;
+			}
+
+			Frame frame = frames.back( );
+			frames.pop_back( );
+
+			// a dangling else goes with the closest if, like the shift in parser.y
+			if( frame.kind == Frame::If && token.kind == lexer::Kind::Else )
+			{
+				Advance( );
+				OpenBlock( { Frame::Else, frame.test, block, typename Builder::Open( ) } );
+				break;
+			}
+
+			if( frame.kind == Frame::While )
+				statement = builder.MakeWhileLoop( frame.test, block );
+			else if( frame.kind == Frame::If )
+				statement = builder.MakeIfThenElse( frame.test, block, Block( ) );
+			else
+				statement = builder.MakeIfThenElse( frame.test, frame.success, block );
+
+			block = Block( );
+		}
+	}
+}
+
+template <typename Builder>
+typename Parser<Builder>::Statement Parser<Builder>::ParseDeclaration( )
+{
+	symbol::Type type = token.kind == lexer::Kind::Int ? symbol::Type::Integer : symbol::Type::Boolean;
+	Advance( );
+
+	Identifier id = ParseIdentifier( );
+	if( !id )
+		return Statement( );
+
+	Typed value = { Expression( ), symbol::Type::None };
+	if( token.kind == lexer::Kind::Assign )
+	{
+		Advance( );
+		value = ParseExpression( );
+		if( !value.expression )
+		{
+			builder.Discard( id );
+			return Statement( );
+		}
+	}
+
+	symTable.Add( builder.GetName( id ), type );
+	if( value.expression && !Verify( value.type, type, value.expression, Expression( ) ) )
+	{
+		builder.Discard( id );
+		builder.Discard( value.expression );
+		return Statement( );
+	}
+
+	return builder.MakeDeclaration( type, id, value.expression );
+}
+
+template <typename Builder>
+typename Parser<Builder>::Statement Parser<Builder>::ParseAssignment( )
+{
+	Identifier id = ParseIdentifier( );
+	if( !id )
+		return Statement( );
+
+	if( !Expect( lexer::Kind::Assign ) )
+	{
+		builder.Discard( id );
+		return Statement( );
+	}
+
+	Typed value = ParseExpression( );
+	if( !value.expression || !Verify( Lookup( builder.GetName( id ) ), value.type, id, value.expression ) )
+	{
+		builder.Discard( id );
+		if( value.expression )
+			builder.Discard( value.expression );
+
+		return Statement( );
+	}
+
+	return builder.MakeAssignment( id, value.expression );
+}
+
+template <typename Builder>
+typename Parser<Builder>::Expression Parser<Builder>::ParseCondition( )
+{
+	if( !Expect( lexer::Kind::LeftParen ) )
+		return Expression( );
+
+	Typed test = ParseExpression( );
+	if( !test.expression )
+		return Expression( );
+
+	if( !Expect( lexer::Kind::RightParen ) || !Verify( test.type, symbol::Type::Boolean, test.expression, Expression( ) ) )
+	{
+		builder.Discard( test.expression );
+		return Expression( );
+	}
+
+	return test.expression;
+}
+
+template <typename Builder>
+typename Parser<Builder>::Identifier Parser<Builder>::ParseIdentifier( )
+{
+	if( token.kind != lexer::Kind::Identifier )
+	{
+		Unexpected( kind_names[static_cast<int32_t>( lexer::Kind::Identifier )] );
+		return Identifier( );
+	}
+
+	Identifier id = builder.MakeIdentifier( scanner.GetText( token ), token.length );
+	Advance( );
+	return id;
+}
+
+// builds the operators on the stack down to the innermost open parenthesis
+// while they bind at least as tightly as precedence, false on type errors
+template <typename Builder>
+bool Parser<Builder>::Reduce( int32_t precedence )
+{
+	while( !operators.empty( ) && operators.back( ).precedence != 0 && operators.back( ).precedence >= precedence )
+	{
+		Operator op = operators.back( );
+		operators.pop_back( );
+		Typed right = operands.back( );
+		operands.pop_back( );
+		Typed left = operands.back( );
+		operands.pop_back( );
+
+		symbol::Type type = symbol::Type::Boolean;
+		bool valid;
+		switch( op.code )
+		{
+			case node::BinaryOperator::Equal:
+			case node::BinaryOperator::NotEqual:
+				valid = Verify( left.type, right.type, left.expression, right.expression );
+				break;
+
+			case node::BinaryOperator::And:
+			case node::BinaryOperator::Or:
+				valid = Verify( left.type, symbol::Type::Boolean, left.expression, Expression( ) ) &&
+					Verify( right.type, symbol::Type::Boolean, right.expression, Expression( ) );
+				break;
+
+			case node::BinaryOperator::LessThan:
+			case node::BinaryOperator::LessEqual:
+			case node::BinaryOperator::GreaterThan:
+			case node::BinaryOperator::GreaterEqual:
+				valid = Verify( left.type, symbol::Type::Integer, left.expression, Expression( ) ) &&
+					Verify( right.type, symbol::Type::Integer, right.expression, Expression( ) );
+				break;
+
+			default:
+				type = symbol::Type::Integer;
+				valid = Verify( left.type, symbol::Type::Integer, left.expression, Expression( ) ) &&
+					Verify( right.type, symbol::Type::Integer, right.expression, Expression( ) );
+				break;
+		}
+
+		if( !valid )
+		{
+			builder.Discard( left.expression );
+			builder.Discard( right.expression );
+			return false;
+		}
+
+		operands.push_back( { builder.MakeOperator( left.expression, op.code, right.expression ), type } );
+	}
+
+	return true;
+}
+
+// after an error, with the operands built so far
+template <typename Builder>
+typename Parser<Builder>::Typed Parser<Builder>::AbandonExpression( )
+{
+	for( const Typed &operand : operands )
+		builder.Discard( operand.expression );
+
+	operands.clear( );
+	operators.clear( );
+	return { Expression( ), symbol::Type::None };
+}
+
+// precedence climbing on explicit stacks: an operator waits for its right
+// operand and is built once an operator that binds no tighter, a closing
+// parenthesis or the end of the expression follows, the same tree and checks
+// in the same order as descending into every operand
+template <typename Builder>
+typename Parser<Builder>::Typed Parser<Builder>::ParseExpression( )
+{
+	operands.clear( );
+	operators.clear( );
+	for( ;; )
+	{
+		while( token.kind == lexer::Kind::LeftParen )
+		{
+			Advance( );
+			operators.push_back( { 0, node::BinaryOperator::Addition } );
+		}
+
+		Typed primary = ParsePrimary( );
+		if( !primary.expression )
+			return AbandonExpression( );
+
+		operands.push_back( primary );
+
+		// up to the operator before the next operand
+		for( ;; )
+		{
+			Operator op = GetOperator( token.kind );
+			if( !Reduce( op.precedence ) )
+				return AbandonExpression( );
+
+			if( op.precedence != 0 )
+			{
+				Advance( );
+				operators.push_back( op );
+				break;
+			}
+
+			if( operators.empty( ) )
+			{
+				Typed expression = operands.back( );
+				operands.pop_back( );
+				return expression;
+			}
+
+			if( !Expect( lexer::Kind::RightParen ) )
+				return AbandonExpression( );
+
+			operators.pop_back( );
+		}
+	}
+}
+
+template <typename Builder>
+typename Parser<Builder>::Typed Parser<Builder>::ParsePrimary( )
+{
+	Typed primary = { Expression( ), symbol::Type::None };
+	switch( token.kind )
+	{
+		case lexer::Kind::Identifier:
+		{
+			Identifier id = ParseIdentifier( );
+			return { id, Lookup( builder.GetName( id ) ) };
+		}
+
+		case lexer::Kind::Integer:
+			primary = { builder.MakeInteger( scanner.GetInteger( token ) ), symbol::Type::Integer };
+			break;
+
+		case lexer::Kind::True:
+		case lexer::Kind::False:
+			primary = { builder.MakeBoolean( token.kind == lexer::Kind::True ), symbol::Type::Boolean };
+			break;
+
+		default:
+			Unexpected( );
+			return primary;
+	}
+
+	Advance( );
+	return primary;
+}
+
+bool Parse( const char *data, size_t size, node::Block **programBlock, symbol::Table &symTable, std::string &error )
+{
+	Parser<NodeBuilder> parser( NodeBuilder( ), data, size, symTable );
+	*programBlock = parser.ParseProgram( );
+	if( *programBlock == nullptr )
+	{
+		error = parser.GetError( );
+		return false;
+	}
+
+	return true;
+}
+
+bool Parse( const char *data, size_t size, flat::Tree &tree, symbol::Table &symTable, std::string &error )
+{
+	Parser<FlatBuilder> parser( FlatBuilder( tree ), data, size, symTable );
+	tree.root = parser.ParseProgram( );
+	if( tree.root == 0 )
+	{
+		error = parser.GetError( );
+		return false;
+	}
+
+	return true;
+}
+
+bool ParseStatements( const char *data, size_t size, ring::Queue<lexer::Token> &tokens, ring::Queue<node::Statement *> &statements, symbol::Table &symTable, std::string &error )
+{
+	Parser<NodeBuilder> parser( NodeBuilder( ), data, size, symTable, &tokens );
+	bool parsed = parser.ParseStatements( statements );
+	if( !parsed )
+		error = parser.GetError( );
+
+	// the lexer may still be waiting to push the rest of a bad input
+	tokens.Close( );
+	statements.Push( nullptr );
+	return parsed;
+}
+
+Statement ParseStatement( const char *data, size_t size, const Scope &outer, symbol::Table &symTable )
+{
+	Parser<NodeBuilder> parser( NodeBuilder( ), data, size, symTable, outer );
+	return parser.ParseTopStatement( );
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "node.hpp"
+#include "symbol.hpp"
+#include "lexer.hpp"
+#include "ring.hpp"
+#include "flat.hpp"
+
+namespace pratt
+{
+
+// hand-written parser for the language of parser.y, without recursion (open
+// blocks and operators wait on explicit stacks, so the nesting is only bound
+// by memory), building the same tree and checking types as it goes (each
+// expression carries its type instead of asking its children),
+// returns false with the error message on the first syntax or type error
+bool Parse( const char *data, size_t size, node::Block **programBlock, symbol::Table &symTable, std::string &error );
+// same, building the arrays of tree instead of node:: objects
+bool Parse( const char *data, size_t size, flat::Tree &tree, symbol::Table &symTable, std::string &error );
+
+// same, for the pipelined mode: the tokens come from another thread (up to
+// Kind::End) and every top-level statement is pushed to statements as soon as
+// it's parsed, followed by nullptr even on errors
+bool ParseStatements( const char *data, size_t size, ring::Queue<lexer::Token> &tokens, ring::Queue<node::Statement *> &statements, symbol::Table &symTable, std::string &error );
+
+// symbols declared outside of the text being parsed
+class Scope
+{
+public:
+	virtual ~Scope( ) { }
+	// None when it isn't declared
+	virtual symbol::Type Get( const std::string &name ) const = 0;
+};
+
+struct Statement
+{
+	// nullptr on errors, with whatever was built for it already freed
+	node::Statement *statement;
+	// offset in data of the token after the statement, or of the token the error was found at
+	size_t end;
+	std::string error;
+};
+
+// parses only the top-level statement at the start of data, for the
+// incremental front end: names are looked up in outer before symTable, and
+// the statement's own declarations are added to symTable
+Statement ParseStatement( const char *data, size_t size, const Scope &outer, symbol::Table &symTable );
+
+}
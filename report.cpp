@@ -0,0 +1,272 @@
+#include "report.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <sys/resource.h>
+
+namespace report
+{
+
+// only counted while a report is enabled, so other allocations just test the flag
+static std::atomic<bool> counting( false );
+static std::atomic<uint64_t> allocations( 0 );
+static std::atomic<uint64_t> allocated( 0 );
+static std::atomic<uint64_t> releases( 0 );
+
+static void *Allocate( size_t size )
+{
+	if( counting.load( std::memory_order_relaxed ) )
+	{
+		allocations.fetch_add( 1, std::memory_order_relaxed );
+		allocated.fetch_add( size, std::memory_order_relaxed );
+	}
+
+	return std::malloc( size == 0 ? 1 : size );
+}
+
+static void Free( void *memory )
+{
+	if( memory != nullptr && counting.load( std::memory_order_relaxed ) )
+		releases.fetch_add( 1, std::memory_order_relaxed );
+
+	std::free( memory );
+}
+
+static double GetTime( clockid_t clock )
+{
+	timespec time;
+	clock_gettime( clock, &time );
+	return static_cast<double>( time.tv_sec ) + static_cast<double>( time.tv_nsec ) / 1e9;
+}
+
+Report::Report( bool enabled, size_t input ) :
+	enabled( enabled ),
+	input( input ),
+	current( -1 ),
+	startWall( 0.0 ),
+	startCpu( 0.0 ),
+	startAllocations( 0 ),
+	startBytes( 0 )
+{
+	if( enabled )
+		counting.store( true, std::memory_order_relaxed );
+}
+
+Report::~Report( )
+{
+	if( enabled )
+		counting.store( false, std::memory_order_relaxed );
+}
+
+bool Report::IsEnabled( ) const
+{
+	return enabled;
+}
+
+void Report::Start( const std::string &phase, bool extra )
+{
+	if( !enabled )
+		return;
+
+	Stop( );
+
+	current = 0;
+	while( current < static_cast<int32_t>( phases.size( ) ) && phases[current].name != phase )
+		current++;
+
+	if( current == static_cast<int32_t>( phases.size( ) ) )
+	{
+		phases.push_back( Phase( ) );
+		phases.back( ).name = phase;
+		phases.back( ).extra = extra;
+	}
+
+	startAllocations = allocations.load( std::memory_order_relaxed );
+	startBytes = allocated.load( std::memory_order_relaxed );
+	startCpu = GetTime( CLOCK_PROCESS_CPUTIME_ID );
+	startWall = GetTime( CLOCK_MONOTONIC );
+}
+
+void Report::Stop( )
+{
+	if( !enabled || current < 0 )
+		return;
+
+	Phase &phase = phases[current];
+	phase.wall += GetTime( CLOCK_MONOTONIC ) - startWall;
+	phase.cpu += GetTime( CLOCK_PROCESS_CPUTIME_ID ) - startCpu;
+	phase.allocations += allocations.load( std::memory_order_relaxed ) - startAllocations;
+	phase.bytes += allocated.load( std::memory_order_relaxed ) - startBytes;
+	current = -1;
+}
+
+void Report::Count( const std::string &name, uint64_t value )
+{
+	if( !enabled )
+		return;
+
+	for( auto &count : counts )
+	{
+		if( count.first == name )
+		{
+			count.second = value;
+			return;
+		}
+	}
+
+	counts.push_back( { name, value } );
+}
+
+void Report::Print( std::ostream &stream ) const
+{
+	Phase total;
+	total.name = "total";
+	bool extra = false;
+	for( const Phase &phase : phases )
+	{
+		extra |= phase.extra;
+		if( phase.extra )
+			continue;
+
+		total.wall += phase.wall;
+		total.cpu += phase.cpu;
+		total.allocations += phase.allocations;
+		total.bytes += phase.bytes;
+	}
+
+	stream << std::left << std::setw( 10 ) << "Phase" << std::right << std::setw( 12 ) << "Wall ms" << std::setw( 12 ) << "CPU ms" <<
+		std::setw( 14 ) << "Allocations" << std::setw( 14 ) << "Allocated KB" << std::setw( 12 ) << "MB/s" << std::endl;
+
+	std::vector<Phase> rows( phases );
+	rows.push_back( total );
+	for( const Phase &phase : rows )
+	{
+		stream << std::left << std::setw( 10 ) << ( phase.extra ? phase.name + "*" : phase.name ) << std::right << std::fixed << std::setprecision( 3 ) <<
+			std::setw( 12 ) << phase.wall * 1000.0 << std::setw( 12 ) << phase.cpu * 1000.0 <<
+			std::setw( 14 ) << phase.allocations << std::setw( 14 ) << phase.bytes / 1024 << std::setprecision( 1 ) <<
+			std::setw( 12 ) << ( phase.wall > 0.0 ? input / phase.wall / 1000000.0 : 0.0 ) << std::endl;
+	}
+
+	if( extra )
+		stream << "* an extra scan for the report, not in the total" << std::endl;
+
+	stream << "Input: " << input << " bytes";
+	for( const auto &count : counts )
+		stream << ", " << count.first << ": " << count.second;
+
+	stream << ", peak RSS: " << GetPeakMemory( ) / 1024 << " KB" << std::endl;
+}
+
+void Report::PrintJson( std::ostream &stream ) const
+{
+	stream << "{\"input\": " << input << ", \"phases\": [";
+	for( size_t i = 0; i < phases.size( ); ++i )
+	{
+		const Phase &phase = phases[i];
+		stream << ( i > 0 ? ", " : "" ) << "{\"name\": \"" << phase.name << "\", \"wall\": " << std::setprecision( 9 ) << phase.wall <<
+			", \"cpu\": " << phase.cpu << ", \"allocations\": " << phase.allocations << ", \"bytes\": " << phase.bytes <<
+			", \"throughput\": " << ( phase.wall > 0.0 ? input / phase.wall : 0.0 ) << ", \"extra\": " << ( phase.extra ? "true" : "false" ) << "}";
+	}
+
+	stream << "], \"counts\": {";
+	for( size_t i = 0; i < counts.size( ); ++i )
+		stream << ( i > 0 ? ", " : "" ) << "\"" << counts[i].first << "\": " << counts[i].second;
+
+	stream << "}, \"peakMemory\": " << GetPeakMemory( ) << "}" << std::endl;
+}
+
+uint64_t CountNodes( const node::Block *program )
+{
+	uint64_t count = 0;
+	std::vector<const node::Base *> stack( 1, program );
+	while( !stack.empty( ) )
+	{
+		const node::Base *node = stack.back( );
+		stack.pop_back( );
+		if( node == nullptr )
+			continue;
+
+		count++;
+		if( const node::BinaryOperator *binop = dynamic_cast<const node::BinaryOperator *>( node ) )
+			stack.insert( stack.end( ), { binop->lhs, binop->rhs } );
+		else if( const node::Assignment *assignment = dynamic_cast<const node::Assignment *>( node ) )
+			stack.insert( stack.end( ), { assignment->lhs, assignment->rhs } );
+		else if( const node::Block *block = dynamic_cast<const node::Block *>( node ) )
+			stack.insert( stack.end( ), block->statements.begin( ), block->statements.end( ) );
+		else if( const node::ExpressionStatement *expression = dynamic_cast<const node::ExpressionStatement *>( node ) )
+			stack.push_back( expression->expression );
+		else if( const node::IntegerDeclaration *declaration = dynamic_cast<const node::IntegerDeclaration *>( node ) )
+			stack.insert( stack.end( ), { declaration->id, declaration->assignmentExpr } );
+		else if( const node::BooleanDeclaration *declaration = dynamic_cast<const node::BooleanDeclaration *>( node ) )
+			stack.insert( stack.end( ), { declaration->id, declaration->assignmentExpr } );
+		else if( const node::IfThenElse *ifthenelse = dynamic_cast<const node::IfThenElse *>( node ) )
+			stack.insert( stack.end( ), { ifthenelse->testExpr, ifthenelse->successBlock, ifthenelse->failureBlock } );
+		else if( const node::WhileLoop *whileloop = dynamic_cast<const node::WhileLoop *>( node ) )
+			stack.insert( stack.end( ), { whileloop->testExpr, whileloop->successBlock } );
+	}
+
+	return count;
+}
+
+int64_t GetLiveAllocations( )
+{
+	return static_cast<int64_t>( allocations.load( std::memory_order_relaxed ) - releases.load( std::memory_order_relaxed ) );
+}
+
+uint64_t GetPeakMemory( )
+{
+	rusage usage;
+	getrusage( RUSAGE_SELF, &usage );
+	return static_cast<uint64_t>( usage.ru_maxrss ) * 1024;
+}
+
+}
+
+// every allocation goes through report::Allocate, failing like the standard
+// ones, and every release through report::Free
+
+void *operator new( size_t size )
+{
+	void *memory = report::Allocate( size );
+	if( memory == nullptr )
+		throw std::bad_alloc( );
+
+	return memory;
+}
+
+void *operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+void *operator new( size_t size, const std::nothrow_t & ) noexcept
+{
+	return report::Allocate( size );
+}
+
+void *operator new[]( size_t size, const std::nothrow_t & ) noexcept
+{
+	return report::Allocate( size );
+}
+
+void operator delete( void *memory ) noexcept
+{
+	report::Free( memory );
+}
+
+void operator delete[]( void *memory ) noexcept
+{
+	report::Free( memory );
+}
+
+void operator delete( void *memory, const std::nothrow_t & ) noexcept
+{
+	report::Free( memory );
+}
+
+void operator delete[]( void *memory, const std::nothrow_t & ) noexcept
+{
+	report::Free( memory );
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "node.hpp"
+
+namespace report
+{
+
+struct Phase
+{
+	std::string name;
+	double wall = 0.0;
+	// of the whole process, so threads started by the phase count
+	double cpu = 0.0;
+	// operator new calls and bytes of every thread while the phase ran
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	// work done only for the report, like scanning the input on its own,
+	// which is left out of the total
+	bool extra = false;
+};
+
+// "--time-report": phases run one after the other, starting one stops the
+// last, and a phase started again adds up; a disabled report does nothing,
+// so the phases can be marked unconditionally
+class Report
+{
+public:
+	Report( bool enabled, size_t input );
+	~Report( );
+
+	Report( const Report & ) = delete;
+	Report &operator=( const Report & ) = delete;
+
+	bool IsEnabled( ) const;
+	void Start( const std::string &phase, bool extra = false );
+	void Stop( );
+	// tokens, nodes, instructions, in the order they're first set
+	void Count( const std::string &name, uint64_t value );
+
+	// a table with the throughput of every phase and the total of those that
+	// aren't extra, then the counts and the peak RSS
+	void Print( std::ostream &stream ) const;
+	void PrintJson( std::ostream &stream ) const;
+
+private:
+	bool enabled;
+	size_t input;
+	std::vector<Phase> phases;
+	std::vector<std::pair<std::string, uint64_t>> counts;
+	// the running phase, -1 for none, and where it started
+	int32_t current;
+	double startWall;
+	double startCpu;
+	uint64_t startAllocations;
+	uint64_t startBytes;
+};
+
+// nodes of the program, without recursing
+uint64_t CountNodes( const node::Block *program );
+// operator new calls minus the deletes of non-null pointers while a report is
+// enabled, so work that frees everything it allocates leaves it unchanged
+int64_t GetLiveAllocations( );
+// largest resident set of the process so far
+uint64_t GetPeakMemory( );
+
+}
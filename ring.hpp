@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ring
+{
+
+// bounded lock-free queue for exactly one producer thread and one consumer
+// thread, Push waits while it's full and Pop while it's empty
+template <typename T>
+class Queue
+{
+public:
+	// rounded up to a power of two
+	explicit Queue( size_t capacity );
+
+	Queue( const Queue & ) = delete;
+	Queue &operator=( const Queue & ) = delete;
+
+	// false without pushing once the consumer closed the queue
+	bool Push( const T &value );
+	T Pop( );
+	// called by the consumer when it stops popping, so the producer doesn't wait forever
+	void Close( );
+
+private:
+	static void Pause( uint32_t &spins );
+
+	std::vector<T> slots;
+	size_t mask;
+	std::atomic<bool> closed;
+
+	// each index on its own cache line, with the last value seen of the other one
+	alignas( 64 ) std::atomic<size_t> head;
+	size_t cachedTail;
+	alignas( 64 ) std::atomic<size_t> tail;
+	size_t cachedHead;
+};
+
+template <typename T>
+Queue<T>::Queue( size_t capacity ) :
+	mask( 0 ),
+	closed( false ),
+	head( 0 ),
+	cachedTail( 0 ),
+	tail( 0 ),
+	cachedHead( 0 )
+{
+	size_t size = 2;
+	while( size < capacity )
+		size *= 2;
+
+	slots.resize( size );
+	mask = size - 1;
+}
+
+template <typename T>
+bool Queue<T>::Push( const T &value )
+{
+	if( closed.load( std::memory_order_relaxed ) )
+		return false;
+
+	size_t position = head.load( std::memory_order_relaxed );
+	uint32_t spins = 0;
+	while( position - cachedTail > mask )
+	{
+		if( closed.load( std::memory_order_relaxed ) )
+			return false;
+
+		cachedTail = tail.load( std::memory_order_acquire );
+		if( position - cachedTail > mask )
+			Pause( spins );
+	}
+
+	slots[position & mask] = value;
+	head.store( position + 1, std::memory_order_release );
+	return true;
+}
+
+template <typename T>
+T Queue<T>::Pop( )
+{
+	size_t position = tail.load( std::memory_order_relaxed );
+	uint32_t spins = 0;
+	while( position == cachedHead )
+	{
+		cachedHead = head.load( std::memory_order_acquire );
+		if( position == cachedHead )
+			Pause( spins );
+	}
+
+	T value = slots[position & mask];
+	tail.store( position + 1, std::memory_order_release );
+	return value;
+}
+
+template <typename T>
+void Queue<T>::Close( )
+{
+	closed.store( true, std::memory_order_relaxed );
+}
+
+template <typename T>
+void Queue<T>::Pause( uint32_t &spins )
+{
+	// spin briefly when the other side is about to catch up, then give the core away
+	if( ++spins > 64 )
+		std::this_thread::yield( );
+}
+
+}
@@ -0,0 +1,302 @@
+#include "scheduler.hpp"
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+namespace scheduler
+{
+
+static bool IsControlTransfer( const instruction::Base *inst )
+{
+	instruction::Type type = inst->GetType( );
+	return type == instruction::Type::Jump || type == instruction::Type::Branch;
+}
+
+static bool IsBarrier( const instruction::Base *inst )
+{
+	return inst->GetType( ) == instruction::Type::Label || IsControlTransfer( inst ) ||
+		inst->GetReadMask( ) == instruction::AllMask || inst->GetWriteMask( ) == instruction::AllMask;
+}
+
+static uint32_t GetLatency( const instruction::Base *inst, const LatencyTable &latencies )
+{
+	switch( inst->GetType( ) )
+	{
+		case instruction::Type::Load:
+			return latencies.load;
+
+		case instruction::Type::Multiply:
+			return latencies.multiply;
+
+		case instruction::Type::Divide:
+			return latencies.divide;
+
+		default:
+			return latencies.other;
+	}
+}
+
+struct Node
+{
+	instruction::Base *inst;
+	uint32_t latency;
+	uint32_t height;
+	uint32_t predecessors;
+	uint32_t ready;
+	// successors and the minimum number of cycles between both issuing
+	std::vector<std::pair<size_t, uint32_t>> successors;
+};
+
+// in-order single issue estimate of the cycles a sequence takes
+static uint32_t EstimateCycles( const std::vector<instruction::Base *> &block, const LatencyTable &latencies )
+{
+	std::vector<uint32_t> available( 32, 0 );
+	uint32_t cycle = 0;
+	for( const instruction::Base *inst : block )
+	{
+		uint32_t start = cycle;
+		uint32_t reads = inst->GetReadMask( );
+		for( uint32_t bit = 0; bit < 32; ++bit )
+			if( ( reads & ( 1u << bit ) ) != 0 )
+				start = std::max( start, available[bit] );
+
+		uint32_t writes = inst->GetWriteMask( );
+		for( uint32_t bit = 0; bit < 32; ++bit )
+			if( ( writes & ( 1u << bit ) ) != 0 )
+				available[bit] = start + GetLatency( inst, latencies );
+
+		cycle = start + std::max<uint32_t>( inst->GetSize( ), 1 );
+	}
+
+	return cycle;
+}
+
+static void ScheduleBlock( std::vector<instruction::Base *> &block, const LatencyTable &latencies )
+{
+	std::vector<Node> nodes( block.size( ) );
+	for( size_t i = 0; i < block.size( ); ++i )
+	{
+		nodes[i].inst = block[i];
+		nodes[i].latency = GetLatency( block[i], latencies );
+		nodes[i].predecessors = 0;
+		nodes[i].ready = 0;
+	}
+
+	// true dependencies wait for the result, anti and output dependencies
+	// (temporaries being reused) only have to keep their order; every resource
+	// only needs edges from its last writer and the readers since, the earlier
+	// ones are ordered before those already
+	std::vector<size_t> writers( 32, SIZE_MAX );
+	std::vector<std::vector<size_t>> readers( 32 );
+	std::vector<std::pair<size_t, uint32_t>> edges;
+	for( size_t k = 0; k < nodes.size( ); ++k )
+	{
+		uint32_t kreads = nodes[k].inst->GetReadMask( );
+		uint32_t kwrites = nodes[k].inst->GetWriteMask( );
+		edges.clear( );
+		for( uint32_t bit = 0; bit < 32; ++bit )
+		{
+			size_t writer = writers[bit];
+			if( ( kreads & ( 1u << bit ) ) != 0 && writer != SIZE_MAX )
+				edges.push_back( std::make_pair( writer, nodes[writer].latency ) );
+
+			if( ( kwrites & ( 1u << bit ) ) == 0 )
+				continue;
+
+			if( writer != SIZE_MAX )
+				edges.push_back( std::make_pair( writer, 1u ) );
+
+			for( size_t reader : readers[bit] )
+				edges.push_back( std::make_pair( reader, 1u ) );
+		}
+
+		// one edge per predecessor, with the longest latency
+		std::sort( edges.begin( ), edges.end( ), []( const std::pair<size_t, uint32_t> &a, const std::pair<size_t, uint32_t> &b )
+		{
+			return a.first < b.first || ( a.first == b.first && a.second > b.second );
+		} );
+
+		for( size_t e = 0; e < edges.size( ); ++e )
+		{
+			if( e > 0 && edges[e].first == edges[e - 1].first )
+				continue;
+
+			nodes[edges[e].first].successors.push_back( std::make_pair( k, edges[e].second ) );
+			++nodes[k].predecessors;
+		}
+
+		for( uint32_t bit = 0; bit < 32; ++bit )
+		{
+			if( ( kwrites & ( 1u << bit ) ) != 0 )
+			{
+				writers[bit] = k;
+				readers[bit].clear( );
+			}
+
+			if( ( kreads & ( 1u << bit ) ) != 0 )
+				readers[bit].push_back( k );
+		}
+	}
+
+	// priority is the longest latency path to the end of the block
+	for( size_t i = nodes.size( ); i-- > 0; )
+	{
+		nodes[i].height = nodes[i].latency;
+		for( auto &edge : nodes[i].successors )
+			nodes[i].height = std::max( nodes[i].height, edge.second + nodes[edge.first].height );
+	}
+
+	// prefer whatever can issue soonest, then the critical path, then source
+	// order: the nodes whose operands are ready by the current cycle wait in
+	// available, the others in pending by the cycle they're ready
+	typedef std::pair<uint32_t, size_t> Entry;
+	auto priority = [&nodes]( size_t a, size_t b )
+	{
+		return nodes[a].height < nodes[b].height || ( nodes[a].height == nodes[b].height && a > b );
+	};
+
+	std::priority_queue<size_t, std::vector<size_t>, decltype( priority )> available( priority );
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pending;
+	for( size_t i = 0; i < nodes.size( ); ++i )
+		if( nodes[i].predecessors == 0 )
+			pending.push( Entry( nodes[i].ready, i ) );
+
+	uint32_t cycle = 0;
+	for( size_t n = 0; n < nodes.size( ); ++n )
+	{
+		if( available.empty( ) && pending.top( ).first > cycle )
+			cycle = pending.top( ).first;
+
+		while( !pending.empty( ) && pending.top( ).first <= cycle )
+		{
+			available.push( pending.top( ).second );
+			pending.pop( );
+		}
+
+		size_t index = available.top( );
+		available.pop( );
+
+		Node &node = nodes[index];
+		uint32_t start = cycle;
+		cycle = start + std::max<uint32_t>( node.inst->GetSize( ), 1 );
+		block[n] = node.inst;
+
+		for( auto &edge : node.successors )
+		{
+			Node &successor = nodes[edge.first];
+			successor.ready = std::max( successor.ready, start + edge.second );
+			if( --successor.predecessors == 0 )
+				pending.push( Entry( successor.ready, edge.first ) );
+		}
+	}
+}
+
+ScheduleStatistics ScheduleBlocks( instruction::List &list, const LatencyTable &latencies )
+{
+	ScheduleStatistics stats;
+
+	instruction::List::iterator it = list.begin( );
+	while( it != list.end( ) )
+	{
+		if( IsBarrier( *it ) )
+		{
+			++it;
+			continue;
+		}
+
+		instruction::List::iterator first = it;
+		std::vector<instruction::Base *> block;
+		for( ; it != list.end( ) && !IsBarrier( *it ); ++it )
+			block.push_back( *it );
+
+		stats.before += EstimateCycles( block, latencies );
+		ScheduleBlock( block, latencies );
+		stats.after += EstimateCycles( block, latencies );
+
+		for( instruction::Base *inst : block )
+			*first++ = inst;
+	}
+
+	return stats;
+}
+
+// only single word instructions can go in a delay slot, macros would be split
+static bool FitsDelaySlot( const instruction::Base *inst )
+{
+	return !IsBarrier( inst ) && inst->GetSize( ) == 1;
+}
+
+// looks for an instruction before the branch (in the same basic block) that
+// can be moved after it without changing what the branch or anything in
+// between sees
+static instruction::List::iterator FindPredecessor( instruction::List &list, instruction::List::iterator branch )
+{
+	uint32_t reads = ( *branch )->GetReadMask( );
+	uint32_t writes = ( *branch )->GetWriteMask( );
+
+	instruction::List::iterator it = branch;
+	while( it != list.begin( ) )
+	{
+		--it;
+
+		// instructions already sitting in a delay slot have to stay there
+		instruction::Base *inst = *it;
+		if( IsBarrier( inst ) || ( it != list.begin( ) && IsControlTransfer( *std::prev( it ) ) ) )
+			break;
+
+		uint32_t instreads = inst->GetReadMask( );
+		uint32_t instwrites = inst->GetWriteMask( );
+		if( FitsDelaySlot( inst ) && ( instwrites & ( reads | writes ) ) == 0 && ( instreads & writes ) == 0 )
+			return it;
+
+		reads |= instreads;
+		writes |= instwrites;
+	}
+
+	return list.end( );
+}
+
+DelaySlotStatistics FillDelaySlots( instruction::List &list )
+{
+	DelaySlotStatistics stats;
+
+	list.push_front( new instruction::Custom( ".set noreorder\n" ) );
+
+	for( instruction::List::iterator it = list.begin( ); it != list.end( ); ++it )
+	{
+		if( !IsControlTransfer( *it ) )
+			continue;
+
+		++stats.slots;
+
+		instruction::List::iterator slot = std::next( it );
+		instruction::List::iterator candidate = FindPredecessor( list, it );
+		if( candidate != list.end( ) )
+		{
+			list.splice( slot, list, candidate );
+			++stats.filled;
+			++it;
+			continue;
+		}
+
+		// the fall-through instruction already sits in the slot, it's harmless on
+		// the taken path if it only writes temporaries and doesn't touch memory
+		if( ( *it )->GetType( ) == instruction::Type::Branch && slot != list.end( ) && FitsDelaySlot( *slot ) &&
+			( ( *slot )->GetWriteMask( ) & ( instruction::MemoryMask | instruction::HiLoMask ) ) == 0 )
+		{
+			++stats.filled;
+			++it;
+			continue;
+		}
+
+		list.insert( slot, new instruction::Nop( ) );
+		++it;
+	}
+
+	return stats;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include "instruction.hpp"
+
+namespace scheduler
+{
+
+// cycles between an instruction issuing and its result being usable
+struct LatencyTable
+{
+	uint32_t load = 2;
+	uint32_t multiply = 5;
+	uint32_t divide = 35;
+	uint32_t other = 1;
+};
+
+// estimated cycles of every basic block before and after scheduling
+struct ScheduleStatistics
+{
+	uint32_t before = 0;
+	uint32_t after = 0;
+};
+
+struct DelaySlotStatistics
+{
+	uint32_t slots = 0;
+	uint32_t filled = 0;
+};
+
+// reorders the instructions of every basic block with a list scheduler over
+// the dependency DAG (including register reuse between temporaries) so that
+// independent instructions hide load, multiply and divide latencies
+ScheduleStatistics ScheduleBlocks( instruction::List &list, const LatencyTable &latencies = LatencyTable( ) );
+
+// switches the list to ".set noreorder" and fills every branch and jump delay
+// slot, either with an independent instruction from before the branch or, for
+// conditional branches, with the fall-through instruction when it only writes
+// temporaries (those are never live across labels), otherwise with a NOP
+DelaySlotStatistics FillDelaySlots( instruction::List &list );
+
+}
@@ -0,0 +1,333 @@
+#include "server.hpp"
+#include "pool.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server
+{
+
+// larger requests are rejected instead of allocated
+static const uint32_t max_length = 1u << 30;
+
+static bool ReadAll( int32_t socket, void *data, size_t size )
+{
+	char *bytes = static_cast<char *>( data );
+	while( size > 0 )
+	{
+		ssize_t count = read( socket, bytes, size );
+		if( count < 0 && errno == EINTR )
+			continue;
+
+		if( count <= 0 )
+			return false;
+
+		bytes += count;
+		size -= static_cast<size_t>( count );
+	}
+
+	return true;
+}
+
+static bool WriteAll( int32_t socket, const void *data, size_t size )
+{
+	const char *bytes = static_cast<const char *>( data );
+	while( size > 0 )
+	{
+		ssize_t count = write( socket, bytes, size );
+		if( count < 0 && errno == EINTR )
+			continue;
+
+		if( count <= 0 )
+			return false;
+
+		bytes += count;
+		size -= static_cast<size_t>( count );
+	}
+
+	return true;
+}
+
+static bool ReadString( int32_t socket, std::string &string )
+{
+	uint32_t length;
+	if( !ReadAll( socket, &length, sizeof( length ) ) || length > max_length )
+		return false;
+
+	string.resize( length );
+	return length == 0 || ReadAll( socket, &string[0], length );
+}
+
+static bool WriteString( int32_t socket, const char *data, size_t size )
+{
+	uint32_t length = static_cast<uint32_t>( size );
+	return WriteAll( socket, &length, sizeof( length ) ) && WriteAll( socket, data, size );
+}
+
+static bool Connect( const std::string &path, int32_t &socket, std::string &error )
+{
+	sockaddr_un address;
+	std::memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	if( path.size( ) >= sizeof( address.sun_path ) )
+	{
+		error = "socket path too long";
+		return false;
+	}
+
+	std::memcpy( address.sun_path, path.c_str( ), path.size( ) + 1 );
+	socket = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( socket < 0 || connect( socket, reinterpret_cast<sockaddr *>( &address ), sizeof( address ) ) != 0 )
+	{
+		error = "can't connect to " + path + ": " + std::strerror( errno );
+		if( socket >= 0 )
+			close( socket );
+
+		return false;
+	}
+
+	return true;
+}
+
+// serves the requests of a connection until the client closes it
+static void Handle( int32_t socket )
+{
+	static thread_local compiler::Compiler compiler;
+	compiler.SetMemoize( true );
+
+	std::string options;
+	std::string source;
+	std::string output;
+	while( ReadString( socket, options ) && ReadString( socket, source ) )
+	{
+		compiler.Reset( );
+
+		batch::Settings settings;
+		bool compiled = ParseOptions( options, settings, output ) &&
+			batch::CompileSource( compiler, source.data( ), source.size( ), settings, output );
+		if( !compiled && !compiler.GetError( ).empty( ) )
+			output = compiler.GetError( );
+
+		uint8_t status = compiled ? 0 : 1;
+		if( !WriteAll( socket, &status, sizeof( status ) ) || !WriteString( socket, output.data( ), output.size( ) ) )
+			break;
+	}
+}
+
+bool ParseOptions( const std::string &options, batch::Settings &settings, std::string &error )
+{
+	std::istringstream stream( options );
+	std::string option;
+	bool flatAst = false;
+	bool gprel = false;
+	bool simplify = false;
+	bool schedule = false;
+	while( stream >> option )
+	{
+		if( option == "--gprel" )
+			gprel = true;
+		else if( option == "--thread-jumps" )
+			simplify = true;
+		else if( option == "--schedule" )
+			schedule = true;
+		else if( option.compare( 0, 2, "-O" ) == 0 )
+		{
+			if( !optimizer::GetLevel( option.substr( 2 ), settings.passes.pipeline ) )
+			{
+				error = "invalid optimization level " + option;
+				return false;
+			}
+		}
+		else if( option.compare( 0, 9, "--passes=" ) == 0 )
+		{
+			if( !optimizer::ParsePasses( option.substr( 9 ), settings.passes.pipeline ) )
+			{
+				error = "invalid passes " + option.substr( 9 );
+				return false;
+			}
+		}
+		else if( option == "--pass-stats" )
+		{
+			// only local compilations print them
+		}
+		else if( option == "--noreorder" )
+			settings.passes.noreorder = true;
+		else if( option == "--lexer=flex" )
+			settings.frontend = compiler::Frontend::Flex;
+		else if( option == "--lexer=simd" )
+			settings.frontend = compiler::Frontend::Simd;
+		else if( option == "--parser=bison" )
+			settings.frontend = compiler::Frontend::Flex;
+		else if( option == "--parser=pratt" )
+			settings.frontend = compiler::Frontend::Pratt;
+		else if( option == "--ast=nodes" )
+			flatAst = false;
+		else if( option == "--ast=flat" )
+			flatAst = true;
+		else if( option == "--elf" )
+			settings.elf = true;
+		else if( option.compare( 0, 18, "--codegen-threads=" ) == 0 || option == "--pipeline" || option == "--stream" )
+		{
+			// the requests already run in parallel, each compiles on its own thread
+		}
+		else if( option.compare( 0, 8, "--cache=" ) == 0 || option.compare( 0, 13, "--cache-size=" ) == 0 )
+		{
+			// the client's cache directory, the server compiles every request
+		}
+		else
+		{
+			error = "unsupported option " + option;
+			return false;
+		}
+	}
+
+	if( flatAst )
+		settings.frontend = compiler::Frontend::Flat;
+
+	// after "-O" and "--passes=", wherever they were
+	if( gprel )
+		settings.passes.Add( optimizer::Pass::GlobalPointer );
+
+	if( simplify )
+		settings.passes.Add( optimizer::Pass::ThreadJumps );
+
+	if( schedule )
+		settings.passes.Add( optimizer::Pass::Schedule );
+
+	return true;
+}
+
+// only a socket left behind by a server that's gone is removed, a live
+// server's socket or any other file stays where it is
+static bool RemoveStale( const sockaddr_un &address, std::string &error )
+{
+	std::string path = address.sun_path;
+	struct stat status;
+	if( lstat( path.c_str( ), &status ) != 0 )
+	{
+		if( errno == ENOENT )
+			return true;
+
+		error = "can't stat " + path + ": " + std::strerror( errno );
+		return false;
+	}
+
+	if( !S_ISSOCK( status.st_mode ) )
+	{
+		error = path + " exists and isn't a socket";
+		return false;
+	}
+
+	int32_t probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( probe < 0 )
+	{
+		error = "can't create a socket: " + std::string( std::strerror( errno ) );
+		return false;
+	}
+
+	bool refused = connect( probe, reinterpret_cast<const sockaddr *>( &address ), sizeof( address ) ) != 0 && errno == ECONNREFUSED;
+	close( probe );
+	if( !refused )
+	{
+		error = "a server is already listening on " + path;
+		return false;
+	}
+
+	if( unlink( path.c_str( ) ) != 0 )
+	{
+		error = "can't remove " + path + ": " + std::strerror( errno );
+		return false;
+	}
+
+	return true;
+}
+
+int32_t Serve( const std::string &path, uint32_t jobs )
+{
+	// a client going away must not kill the server
+	signal( SIGPIPE, SIG_IGN );
+
+	sockaddr_un address;
+	std::memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	if( path.size( ) >= sizeof( address.sun_path ) )
+	{
+		std::cerr << "Error: socket path too long" << std::endl;
+		return 1;
+	}
+
+	std::memcpy( address.sun_path, path.c_str( ), path.size( ) + 1 );
+
+	std::string error;
+	if( !RemoveStale( address, error ) )
+	{
+		std::cerr << "Error: " << error << std::endl;
+		return 1;
+	}
+
+	int32_t listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( listener < 0 || bind( listener, reinterpret_cast<sockaddr *>( &address ), sizeof( address ) ) != 0 || listen( listener, 128 ) != 0 )
+	{
+		std::cerr << "Error: can't listen on " << path << ": " << std::strerror( errno ) << std::endl;
+		return 1;
+	}
+
+	// a connection keeps its worker until it's closed
+	pool::ThreadPool threads( jobs );
+	std::cerr << "Listening on " << path << " with " << threads.GetSize( ) << " threads" << std::endl;
+	while( true )
+	{
+		int32_t client = accept( listener, nullptr, nullptr );
+		if( client < 0 )
+		{
+			if( errno == EINTR || errno == ECONNABORTED )
+				continue;
+
+			std::cerr << "Error: accept failed: " << std::strerror( errno ) << std::endl;
+			break;
+		}
+
+		threads.Submit( [client]( )
+		{
+			Handle( client );
+			close( client );
+		} );
+	}
+
+	close( listener );
+	return 1;
+}
+
+bool Request( const std::string &path, const std::string &options, const char *data, size_t size, std::string &output )
+{
+	if( size > max_length )
+	{
+		output = "source too large";
+		return false;
+	}
+
+	int32_t socket;
+	if( !Connect( path, socket, output ) )
+		return false;
+
+	uint8_t status = 1;
+	bool received = WriteString( socket, options.data( ), options.size( ) ) && WriteString( socket, data, size ) &&
+		ReadAll( socket, &status, sizeof( status ) ) && ReadString( socket, output );
+	close( socket );
+
+	if( !received )
+	{
+		output = "connection to " + path + " lost";
+		return false;
+	}
+
+	return status == 0;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "batch.hpp"
+
+namespace server
+{
+
+// requests are "options length, options, source length, source" and replies
+// "status, length, output or error message", lengths are 32-bit in host order
+// (the socket is local) and the options are the compile flags of the command
+// line separated by spaces
+
+// compile flags (front end, passes and "--elf") into settings
+bool ParseOptions( const std::string &options, batch::Settings &settings, std::string &error );
+
+// listens on a Unix socket and compiles requests on a thread pool until killed,
+// every worker keeps its compiler (and the allocated tables) between requests
+int32_t Serve( const std::string &path, uint32_t jobs );
+
+// sends one request, false with the error message as output when the
+// compilation failed or the server couldn't be reached
+bool Request( const std::string &path, const std::string &options, const char *data, size_t size, std::string &output );
+
+}
@@ -0,0 +1,347 @@
+#include "simulator.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace simulator
+{
+
+// same base address SPIM and MARS use for the data segment
+static const int32_t data_base = 0x10010000;
+
+bool ParseCostModel( const std::string &spec, CostModel &model )
+{
+	std::istringstream stream( spec );
+	std::string entry;
+	while( std::getline( stream, entry, ',' ) )
+	{
+		size_t equal = entry.find( '=' );
+		if( equal == std::string::npos )
+			return false;
+
+		std::string key = entry.substr( 0, equal );
+		std::istringstream number( entry.substr( equal + 1 ) );
+		uint32_t value = 0;
+		if( !( number >> value ) || !number.eof( ) )
+			return false;
+
+		if( key == "load" )
+			model.latencies.load = value;
+		else if( key == "multiply" )
+			model.latencies.multiply = value;
+		else if( key == "divide" )
+			model.latencies.divide = value;
+		else if( key == "other" )
+			model.latencies.other = value;
+		else if( key == "delayslot" )
+			model.delaySlot = value;
+		else if( key == "taken" )
+			model.takenBranch = value;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+Machine::Machine( const instruction::List &list, bool delaySlots, const CostModel &model ) :
+	delaySlots( delaySlots ),
+	model( model ),
+	hi( 0 ),
+	lo( 0 ),
+	jumping( false ),
+	target( 0 ),
+	available( 32, 0 )
+{
+	std::fill( registers, registers + 10, 0 );
+
+	for( const instruction::Base *inst : list )
+	{
+		switch( inst->GetType( ) )
+		{
+			case instruction::Type::Word:
+				symbols[static_cast<const instruction::Word *>( inst )->GetLabel( )] = data_base + static_cast<int32_t>( memory.size( ) * 4 );
+				memory.push_back( 0 );
+				break;
+
+			case instruction::Type::Label:
+				labels[static_cast<const instruction::Label *>( inst )->GetLabel( )] = code.size( );
+				break;
+
+			case instruction::Type::Section:
+				break;
+
+			default:
+				code.push_back( inst );
+				break;
+		}
+	}
+}
+
+Statistics Machine::Run( uint64_t maxSteps )
+{
+	size_t pc = 0;
+	while( pc < code.size( ) && stats.error.empty( ) )
+	{
+		if( stats.instructions >= maxSteps )
+		{
+			Fault( "step limit reached" );
+			break;
+		}
+
+		const instruction::Base *inst = code[pc];
+		Step( inst );
+		if( !jumping )
+		{
+			++pc;
+			continue;
+		}
+
+		// the instruction after a branch runs either way when the list manages its own delay slots
+		if( delaySlots && pc + 1 < code.size( ) )
+		{
+			jumping = false;
+			Step( code[pc + 1] );
+		}
+
+		jumping = false;
+		pc = labels[target];
+		stats.cycles += model.takenBranch;
+		if( inst->GetType( ) == instruction::Type::Branch )
+			++stats.taken;
+	}
+
+	return stats;
+}
+
+bool Machine::GetVariable( const std::string &name, int32_t &value ) const
+{
+	auto it = symbols.find( name );
+	if( it == symbols.end( ) )
+		return false;
+
+	value = memory[( it->second - data_base ) / 4];
+	return true;
+}
+
+void Machine::Step( const instruction::Base *inst )
+{
+	inst->Execute( *this );
+	Account( inst );
+}
+
+void Machine::Account( const instruction::Base *inst )
+{
+	uint32_t size = inst->GetSize( );
+	if( size == 0 )
+		return;
+
+	++stats.instructions;
+	stats.words += size;
+
+	uint32_t latency = model.latencies.other;
+	switch( inst->GetType( ) )
+	{
+		case instruction::Type::Load:
+			++stats.loads;
+			latency = model.latencies.load;
+			break;
+
+		case instruction::Type::Save:
+			++stats.stores;
+			break;
+
+		case instruction::Type::Multiply:
+			++stats.multiplies;
+			latency = model.latencies.multiply;
+			break;
+
+		case instruction::Type::Divide:
+			++stats.divides;
+			latency = model.latencies.divide;
+			break;
+
+		case instruction::Type::Branch:
+			++stats.branches;
+			break;
+
+		case instruction::Type::Jump:
+			++stats.jumps;
+			break;
+
+		default:
+			if( inst->GetReadMask( ) == 0 && inst->GetWriteMask( ) == 0 )
+				++stats.nops;
+			else
+				++stats.alu;
+			break;
+	}
+
+	// stall until every operand is available, then occupy one cycle per word
+	uint64_t start = stats.cycles;
+	uint32_t reads = inst->GetReadMask( );
+	for( uint32_t bit = 0; bit < 32; ++bit )
+		if( ( reads & ( 1u << bit ) ) != 0 )
+			start = std::max( start, available[bit] );
+
+	uint32_t writes = inst->GetWriteMask( );
+	for( uint32_t bit = 0; bit < 32; ++bit )
+		if( ( writes & ( 1u << bit ) ) != 0 )
+			available[bit] = start + latency;
+
+	stats.cycles = start + size;
+
+	instruction::Type type = inst->GetType( );
+	if( !delaySlots && ( type == instruction::Type::Branch || type == instruction::Type::Jump ) )
+		stats.cycles += model.delaySlot;
+}
+
+void Machine::Fault( const std::string &error )
+{
+	if( stats.error.empty( ) )
+		stats.error = error;
+}
+
+int32_t *Machine::Register( const instruction::Variable &variable )
+{
+	int32_t temporary = static_cast<int32_t>( variable.GetTemporary( ) );
+	if( temporary < 0 || temporary >= static_cast<int32_t>( sizeof( registers ) / sizeof( registers[0] ) ) )
+	{
+		Fault( "invalid register operand" );
+		return nullptr;
+	}
+
+	return &registers[temporary];
+}
+
+int32_t Machine::Read( const instruction::Variable &variable )
+{
+	switch( variable.GetType( ) )
+	{
+		case instruction::Variable::Type::Constant:
+			return variable.GetInteger( );
+
+		case instruction::Variable::Type::Register:
+		{
+			int32_t *reg = Register( variable );
+			return reg != nullptr ? *reg : 0;
+		}
+
+		case instruction::Variable::Type::Memory:
+		{
+			auto it = symbols.find( variable.GetAddress( ) );
+			if( it != symbols.end( ) )
+				return it->second;
+
+			Fault( "undefined symbol " + variable.GetAddress( ) );
+			return 0;
+		}
+
+		default:
+			Fault( "invalid operand" );
+			return 0;
+	}
+}
+
+void Machine::Write( const instruction::Variable &variable, int32_t value )
+{
+	if( variable.GetType( ) != instruction::Variable::Type::Register )
+	{
+		Fault( "write to a non register operand" );
+		return;
+	}
+
+	int32_t *reg = Register( variable );
+	if( reg != nullptr )
+		*reg = value;
+}
+
+int32_t Machine::Load( int32_t address )
+{
+	int64_t index = ( static_cast<int64_t>( address ) - data_base ) / 4;
+	if( ( address & 3 ) != 0 || index < 0 || index >= static_cast<int64_t>( memory.size( ) ) )
+	{
+		Fault( "invalid load address " + std::to_string( address ) );
+		return 0;
+	}
+
+	return memory[index];
+}
+
+void Machine::Store( int32_t address, int32_t value )
+{
+	int64_t index = ( static_cast<int64_t>( address ) - data_base ) / 4;
+	if( ( address & 3 ) != 0 || index < 0 || index >= static_cast<int64_t>( memory.size( ) ) )
+	{
+		Fault( "invalid store address " + std::to_string( address ) );
+		return;
+	}
+
+	memory[index] = value;
+}
+
+void Machine::Push( int32_t value )
+{
+	stack.push_back( value );
+}
+
+int32_t Machine::Pop( )
+{
+	if( stack.empty( ) )
+	{
+		Fault( "pop from an empty stack" );
+		return 0;
+	}
+
+	int32_t value = stack.back( );
+	stack.pop_back( );
+	return value;
+}
+
+void Machine::Divide( int32_t left, int32_t right )
+{
+	// the result is unpredictable on real hardware, but never trap here
+	if( right == 0 )
+	{
+		SetHiLo( 0, 0 );
+		return;
+	}
+
+	if( left == std::numeric_limits<int32_t>::min( ) && right == -1 )
+	{
+		SetHiLo( 0, left );
+		return;
+	}
+
+	SetHiLo( left % right, left / right );
+}
+
+void Machine::SetHiLo( int32_t hi, int32_t lo )
+{
+	this->hi = hi;
+	this->lo = lo;
+}
+
+int32_t Machine::GetHi( ) const
+{
+	return hi;
+}
+
+int32_t Machine::GetLo( ) const
+{
+	return lo;
+}
+
+void Machine::Jump( uint32_t label )
+{
+	if( labels.find( label ) == labels.end( ) )
+	{
+		Fault( "undefined label " + instruction::LabelToString( label ) );
+		return;
+	}
+
+	jumping = true;
+	target = label;
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "instruction.hpp"
+#include "scheduler.hpp"
+
+namespace simulator
+{
+
+// in-order, single issue pipeline: every machine word takes a cycle, results
+// are ready after their latency and each branch or jump pays for its delay
+// slot (unless the list fills them itself) plus a penalty when taken
+struct CostModel
+{
+	scheduler::LatencyTable latencies;
+	uint32_t delaySlot = 1;
+	uint32_t takenBranch = 0;
+};
+
+// parses "load=2,multiply=5,divide=35,other=1,delayslot=1,taken=0" (any subset)
+bool ParseCostModel( const std::string &spec, CostModel &model );
+
+struct Statistics
+{
+	// instructions of the list and machine instructions they assemble to
+	uint64_t instructions = 0;
+	uint64_t words = 0;
+
+	uint64_t alu = 0;
+	uint64_t loads = 0;
+	uint64_t stores = 0;
+	uint64_t multiplies = 0;
+	uint64_t divides = 0;
+	uint64_t branches = 0;
+	uint64_t taken = 0;
+	uint64_t jumps = 0;
+	uint64_t nops = 0;
+
+	uint64_t cycles = 0;
+
+	// empty unless the program faulted or ran out of steps
+	std::string error;
+};
+
+// MIPS32 interpreter for instruction::List, covering every instruction the
+// backend generates (pseudo-instructions are executed as a whole)
+class Machine
+{
+public:
+	// delaySlots tells if the list fills its own delay slots (.set noreorder)
+	Machine( const instruction::List &list, bool delaySlots, const CostModel &model = CostModel( ) );
+
+	Statistics Run( uint64_t maxSteps = 1000000000 );
+	bool GetVariable( const std::string &name, int32_t &value ) const;
+
+	// used by instruction::Base::Execute
+	int32_t Read( const instruction::Variable &variable );
+	void Write( const instruction::Variable &variable, int32_t value );
+	int32_t Load( int32_t address );
+	void Store( int32_t address, int32_t value );
+	void Push( int32_t value );
+	int32_t Pop( );
+	void Divide( int32_t left, int32_t right );
+	void SetHiLo( int32_t hi, int32_t lo );
+	int32_t GetHi( ) const;
+	int32_t GetLo( ) const;
+	void Jump( uint32_t label );
+
+private:
+	void Step( const instruction::Base *inst );
+	void Account( const instruction::Base *inst );
+	void Fault( const std::string &error );
+	// null after a fault for temporaries the machine doesn't have
+	int32_t *Register( const instruction::Variable &variable );
+
+	std::vector<const instruction::Base *> code;
+	std::unordered_map<uint32_t, size_t> labels;
+	std::unordered_map<std::string, int32_t> symbols;
+	std::vector<int32_t> memory;
+	// what Push spilled, apart from the data segment
+	std::vector<int32_t> stack;
+	bool delaySlots;
+	CostModel model;
+
+	int32_t registers[10];
+	int32_t hi;
+	int32_t lo;
+
+	bool jumping;
+	uint32_t target;
+
+	std::vector<uint64_t> available;
+	Statistics stats;
+};
+
+}
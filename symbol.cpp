@@ -1,4 +1,5 @@
 #include "symbol.hpp"
+#include <algorithm>
 
 namespace symbol
 {
@@ -14,6 +15,8 @@ bool Table::Add( const std::string &symbol, Type type )
 		return false;
 
 	table[symbol] = type;
+	indices[symbol] = static_cast<int32_t>( names.size( ) );
+	names.push_back( symbol );
 	return true;
 }
 
@@ -24,9 +27,21 @@ bool Table::Remove( const std::string &symbol )
 		return false;
 
 	table.erase( it );
+	names.erase( std::find( names.begin( ), names.end( ), symbol ) );
+	indices.clear( );
+	for( size_t i = 0; i < names.size( ); ++i )
+		indices[names[i]] = static_cast<int32_t>( i );
+
 	return true;
 }
 
+void Table::Clear( )
+{
+	table.clear( );
+	names.clear( );
+	indices.clear( );
+}
+
 bool Table::Exists( const std::string &symbol ) const
 {
 	return table.find( symbol ) != table.end( );
@@ -46,6 +61,20 @@ const std::unordered_map<std::string, Type> &Table::GetAll( ) const
 	return table;
 }
 
+const std::vector<std::string> &Table::GetNames( ) const
+{
+	return names;
+}
+
+int32_t Table::GetIndex( const std::string &symbol ) const
+{
+	auto it = indices.find( symbol );
+	if( it == indices.end( ) )
+		return -1;
+
+	return ( *it ).second;
+}
+
 std::string Table::ToString( ) const
 {
 	return "";
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace symbol
 {
@@ -20,13 +21,21 @@ public:
 	bool Empty( ) const;
 	bool Add( const std::string &symbol, Type type );
 	bool Remove( const std::string &symbol );
+	// removes every symbol, keeping the allocated buckets
+	void Clear( );
 	bool Exists( const std::string &symbol ) const;
 	Type Get( const std::string &symbol ) const;
 	const std::unordered_map<std::string, Type> &GetAll( ) const;
+	// symbol names in declaration order
+	const std::vector<std::string> &GetNames( ) const;
+	// position of the symbol in declaration order, -1 if it doesn't exist
+	int32_t GetIndex( const std::string &symbol ) const;
 	std::string ToString( ) const;
 
 private:
 	std::unordered_map<std::string, Type> table;
+	std::vector<std::string> names;
+	std::unordered_map<std::string, int32_t> indices;
 };
 
 }